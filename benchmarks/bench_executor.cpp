@@ -0,0 +1,47 @@
+#include <benchmark/benchmark.h>
+
+#include "athread/athread.h"
+#include "topologies.h"
+
+using namespace at;
+
+namespace
+{
+constexpr std::size_t small_graph = 16;
+
+// Runs a small fan-out graph `range(0)` times through the Executor, the cost per run is the overhead of
+// restarting the graph: resetting the node states and creating the workers.
+void BM_ExecutorRepeat(benchmark::State& state)
+{
+    const auto runs = static_cast<std::size_t>(state.range(0));
+    ThreadGraph graph(bench::hardware_threads(), false);
+    bench::build_topology(graph, bench::Topology::FanOut, small_graph, []() {});
+    Executor executor;
+
+    for (auto _ : state) executor.start(graph, runs).get();
+
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(runs));
+}
+BENCHMARK(BM_ExecutorRepeat)->RangeMultiplier(10)->Range(1, 1000)->UseRealTime()->Unit(benchmark::kMicrosecond);
+
+// The same runs driven by start() and wait() on the calling thread, the baseline of the executor.
+void BM_GraphRestart(benchmark::State& state)
+{
+    const auto runs = static_cast<std::size_t>(state.range(0));
+    ThreadGraph graph(bench::hardware_threads(), false);
+    bench::build_topology(graph, bench::Topology::FanOut, small_graph, []() {});
+
+    for (auto _ : state)
+    {
+        for (std::size_t i = 0; i < runs; i++)
+        {
+            graph.start();
+            graph.wait();
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(runs));
+}
+BENCHMARK(BM_GraphRestart)->RangeMultiplier(10)->Range(1, 1000)->UseRealTime()->Unit(benchmark::kMicrosecond);
+
+}  // namespace
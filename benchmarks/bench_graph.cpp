@@ -0,0 +1,84 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <string>
+
+#include "athread/athread.h"
+#include "topologies.h"
+
+using namespace at;
+
+namespace
+{
+
+// One start() and wait() of a graph of empty nodes, the cost is the scheduling itself.
+void BM_GraphSchedule(benchmark::State& state, bench::Topology topology)
+{
+    ThreadGraph graph(bench::hardware_threads(), false);
+    bench::build_topology(graph, topology, static_cast<std::size_t>(state.range(0)), []() {});
+
+    for (auto _ : state)
+    {
+        graph.start();
+        graph.wait();
+    }
+
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(graph.task_size()));
+    state.counters["nodes"] = static_cast<double>(graph.task_size());
+}
+
+// Builds a graph with depend(), as an application does on startup.
+void BM_GraphBuild(benchmark::State& state, bench::Topology topology)
+{
+    for (auto _ : state)
+    {
+        ThreadGraph graph(1, false);
+        bench::build_topology(graph, topology, static_cast<std::size_t>(state.range(0)), []() {});
+        benchmark::DoNotOptimize(graph.task_size());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Rebuilds the same graph from a snapshot saved once.
+void BM_GraphRestore(benchmark::State& state, bench::Topology topology)
+{
+    std::string path = std::string("bench_graph_") + bench::topology_name(topology) + ".atg";
+    {
+        ThreadGraph graph(1, false);
+        bench::build_topology(graph, topology, static_cast<std::size_t>(state.range(0)), []() {});
+        GraphSnapshot::save(graph, path);
+    }
+    GraphSnapshot snapshot(path);
+
+    for (auto _ : state)
+    {
+        ThreadGraph graph(1, false);
+        snapshot.restore(graph, [](std::uint32_t, std::string_view) { return []() {}; });
+        benchmark::DoNotOptimize(graph.task_size());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    snapshot.close();
+    std::remove(path.c_str());
+}
+
+void build_sizes(benchmark::internal::Benchmark* bench)
+{
+    bench->RangeMultiplier(10)->Range(1000, 100000)->Unit(benchmark::kMicrosecond);
+}
+
+void graph_sizes(benchmark::internal::Benchmark* bench)
+{
+    bench->RangeMultiplier(10)->Range(10, 1000000)->UseRealTime()->Unit(benchmark::kMicrosecond);
+}
+
+BENCHMARK_CAPTURE(BM_GraphSchedule, chain, bench::Topology::Chain)->Apply(graph_sizes);
+BENCHMARK_CAPTURE(BM_GraphSchedule, fanout, bench::Topology::FanOut)->Apply(graph_sizes);
+BENCHMARK_CAPTURE(BM_GraphSchedule, tree, bench::Topology::Tree)->Apply(graph_sizes);
+BENCHMARK_CAPTURE(BM_GraphSchedule, random, bench::Topology::Random)->Apply(graph_sizes);
+BENCHMARK_CAPTURE(BM_GraphSchedule, wavefront, bench::Topology::Wavefront)->Apply(graph_sizes);
+BENCHMARK_CAPTURE(BM_GraphBuild, random, bench::Topology::Random)->Apply(build_sizes);
+BENCHMARK_CAPTURE(BM_GraphRestore, random, bench::Topology::Random)->Apply(build_sizes);
+BENCHMARK_CAPTURE(BM_GraphBuild, wavefront, bench::Topology::Wavefront)->Apply(build_sizes);
+BENCHMARK_CAPTURE(BM_GraphRestore, wavefront, bench::Topology::Wavefront)->Apply(build_sizes);
+
+}  // namespace
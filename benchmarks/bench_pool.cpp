@@ -0,0 +1,65 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "athread/athread.h"
+#include "topologies.h"
+
+using namespace at;
+
+namespace
+{
+constexpr long tasks_per_producer = 10000;
+
+// Every producer pushes its share of empty tasks, the iteration ends when the workers ran them all.
+void BM_PoolThroughput(benchmark::State& state)
+{
+    const auto producers = static_cast<unsigned>(state.range(0));
+    const std::uint32_t workers = bench::hardware_threads();
+    ThreadPool pool(workers, workers);
+    std::atomic<long> remaining{0};
+
+    for (auto _ : state)
+    {
+        remaining = tasks_per_producer * producers;
+        std::vector<std::thread> threads;
+        for (unsigned p = 0; p < producers; p++)
+        {
+            threads.emplace_back(
+                [&]()
+                {
+                    for (long i = 0; i < tasks_per_producer; i++)
+                        pool.push([&remaining]() { remaining.fetch_sub(1, std::memory_order_relaxed); });
+                });
+        }
+        for (auto& thread : threads) thread.join();
+        while (remaining.load() != 0) std::this_thread::yield();
+    }
+
+    state.SetItemsProcessed(state.iterations() * tasks_per_producer * producers);
+    state.counters["workers"] = workers;
+    pool.terminate(true);
+}
+BENCHMARK(BM_PoolThroughput)->RangeMultiplier(2)->Range(1, 2 * bench::hardware_threads())->UseRealTime();
+
+// Round trip of one empty task: push, wake a parked worker, run, observe the completion.
+void BM_PoolEmptyTaskLatency(benchmark::State& state)
+{
+    ThreadPool pool(1, 1);
+    std::atomic_bool done{false};
+
+    for (auto _ : state)
+    {
+        done = false;
+        pool.push([&done]() { done.store(true, std::memory_order_release); });
+        while (!done.load(std::memory_order_acquire)) std::this_thread::yield();
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    pool.terminate(true);
+}
+BENCHMARK(BM_PoolEmptyTaskLatency)->UseRealTime();
+
+}  // namespace
@@ -0,0 +1,428 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <numeric>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "athread/athread.h"
+#include "topologies.h"
+
+using namespace at;
+
+// Compute-bound versions of the graph_image_processing, graph_data_analysis and graph_document_processing
+// samples. The DAGs mix fine grained nodes (image bands, text chunks) with coarse ones (sorts, merges), so they
+// show how the scheduler copes with mixed granularities. Every node is labelled with its stage, and the profile
+// of each run gives the throughput of every stage: the items it processed per second of node time.
+
+namespace
+{
+
+class StageMeter
+{
+public:
+    // Adds a node of `stage` processing `items` per run to the graph.
+    template <class Fn>
+    Task push(ThreadGraph& graph, const char* stage, std::uint64_t items, Fn&& fn)
+    {
+        _stages[stage].items += items;
+        return graph.push(std::forward<Fn>(fn)).set_label(stage);
+    }
+
+    void record(const GraphProfile& profile)
+    {
+        for (const auto& node : profile.nodes)
+            if (node.label) _stages[node.label].time += node.wall_time();
+        _parallelism += profile.parallelism();
+        _speedup += profile.speedup();
+        _runs++;
+    }
+
+    void report(benchmark::State& state) const
+    {
+        for (const auto& stage : _stages)
+        {
+            double seconds = std::chrono::duration<double>(stage.second.time).count();
+            if (seconds > 0)
+                state.counters[stage.first + "/s"] = double(stage.second.items) * double(_runs) / seconds;
+        }
+        if (_runs)
+        {
+            state.counters["parallelism"] = _parallelism / double(_runs);
+            state.counters["speedup"] = _speedup / double(_runs);
+        }
+    }
+
+private:
+    struct Stage
+    {
+        std::uint64_t items{0};
+        std::chrono::nanoseconds time{0};
+    };
+
+    std::map<std::string, Stage> _stages;
+    double _parallelism{0};
+    double _speedup{0};
+    std::int64_t _runs{0};
+};
+
+void run(benchmark::State& state, ThreadGraph& graph, StageMeter& meter)
+{
+    graph.set_profiling(true);
+    for (auto _ : state)
+    {
+        graph.start();
+        graph.wait();
+        meter.record(graph.profile());
+    }
+    meter.report(state);
+}
+
+// ---------------------------------------------------------------------------------------------------------------
+// Images: generate, blur and sharpen by horizontal bands, histogram, catalog.
+
+constexpr int image_side = 512;
+constexpr int image_bands = 8;
+constexpr int band_rows = image_side / image_bands;
+
+using Pixels = std::vector<float>;
+
+template <int Radius>
+void convolve_rows(const Pixels& in, Pixels& out, const std::array<float, (2 * Radius + 1) * (2 * Radius + 1)>& k,
+                   int first_row, int last_row)
+{
+    constexpr int width = 2 * Radius + 1;
+    for (int y = first_row; y < last_row; y++)
+    {
+        for (int x = 0; x < image_side; x++)
+        {
+            float sum = 0;
+            for (int dy = -Radius; dy <= Radius; dy++)
+            {
+                int sy = std::clamp(y + dy, 0, image_side - 1);
+                for (int dx = -Radius; dx <= Radius; dx++)
+                {
+                    int sx = std::clamp(x + dx, 0, image_side - 1);
+                    sum += in[sy * image_side + sx] * k[(dy + Radius) * width + dx + Radius];
+                }
+            }
+            out[y * image_side + x] = sum;
+        }
+    }
+}
+
+std::array<float, 25> gaussian_kernel()
+{
+    std::array<float, 25> k{};
+    float total = 0;
+    for (int y = -2; y <= 2; y++)
+        for (int x = -2; x <= 2; x++) total += k[(y + 2) * 5 + x + 2] = std::exp(-(x * x + y * y) / 2.0f);
+    for (auto& v : k) v /= total;
+    return k;
+}
+
+void BM_WorkloadImages(benchmark::State& state)
+{
+    const auto images = static_cast<std::size_t>(state.range(0));
+    const std::uint64_t band_pixels = std::uint64_t(band_rows) * image_side;
+    const auto blur = gaussian_kernel();
+    const std::array<float, 9> sharpen{0, -1, 0, -1, 5, -1, 0, -1, 0};
+
+    std::vector<Pixels> source(images, Pixels(image_side * image_side));
+    std::vector<Pixels> blurred(images, Pixels(image_side * image_side));
+    std::vector<Pixels> sharpened(images, Pixels(image_side * image_side));
+    std::vector<std::array<std::uint32_t, 256>> histograms(images);
+    std::uint64_t catalog = 0;
+
+    ThreadGraph graph(bench::hardware_threads(), false);
+    StageMeter meter;
+    std::vector<Task> histogram_tasks;
+    for (std::size_t i = 0; i < images; i++)
+    {
+        Task generate = meter.push(graph, "generate", band_pixels * image_bands,
+                                   [&source, i]()
+                                   {
+                                       std::mt19937 random(static_cast<std::uint32_t>(i));
+                                       std::uniform_real_distribution<float> noise(0.0f, 32.0f);
+                                       for (int y = 0; y < image_side; y++)
+                                           for (int x = 0; x < image_side; x++)
+                                               source[i][y * image_side + x] = float((x ^ y) & 0xff) * 0.8f +
+                                                                               noise(random);
+                                   });
+
+        std::vector<Task> blur_bands;
+        for (int b = 0; b < image_bands; b++)
+        {
+            blur_bands.push_back(meter.push(graph, "blur", band_pixels,
+                                            [&, i, b]()
+                                            {
+                                                convolve_rows<2>(source[i], blurred[i], blur, b * band_rows,
+                                                                 (b + 1) * band_rows);
+                                            })
+                                     .depend(generate));
+        }
+
+        Task histogram = meter.push(graph, "histogram", band_pixels * image_bands,
+                                    [&histograms, &sharpened, i]()
+                                    {
+                                        histograms[i].fill(0);
+                                        for (float v : sharpened[i])
+                                            histograms[i][static_cast<std::size_t>(std::clamp(v, 0.0f, 255.0f))]++;
+                                    });
+        for (int b = 0; b < image_bands; b++)
+        {
+            // A band of the sharpened image reads one row of the neighbouring blurred bands.
+            Task band = meter.push(graph, "sharpen", band_pixels,
+                                   [&, i, b]()
+                                   {
+                                       convolve_rows<1>(blurred[i], sharpened[i], sharpen, b * band_rows,
+                                                        (b + 1) * band_rows);
+                                   });
+            for (int n = std::max(0, b - 1); n <= std::min(image_bands - 1, b + 1); n++) band.depend(blur_bands[n]);
+            histogram.depend(band);
+        }
+        histogram_tasks.push_back(histogram);
+    }
+    meter.push(graph, "catalog", images,
+               [&histograms, &catalog]()
+               {
+                   catalog = 0;
+                   for (const auto& h : histograms)
+                       for (std::size_t v = 0; v < h.size(); v++) catalog += h[v] * v;
+               })
+        .depend(histogram_tasks);
+
+    run(state, graph, meter);
+    benchmark::DoNotOptimize(catalog);
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(images));
+}
+BENCHMARK(BM_WorkloadImages)->Arg(4)->Arg(16)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// ---------------------------------------------------------------------------------------------------------------
+// Data analysis: generate, clean, aggregate, then statistics, quantiles, histogram and correlations, report.
+
+constexpr std::size_t dataset_size = 1 << 18;
+
+void BM_WorkloadDataAnalysis(benchmark::State& state)
+{
+    const auto datasets = static_cast<std::size_t>(state.range(0));
+    std::vector<std::vector<double>> raw(datasets, std::vector<double>(dataset_size));
+    std::vector<std::vector<double>> cleaned(datasets);
+    std::vector<double> merged;
+    double mean = 0, deviation = 0, median = 0, p99 = 0, correlation = 0;
+    std::array<std::uint64_t, 64> histogram{};
+
+    ThreadGraph graph(bench::hardware_threads(), false);
+    StageMeter meter;
+    std::vector<Task> clean_tasks;
+    for (std::size_t i = 0; i < datasets; i++)
+    {
+        Task generate = meter.push(graph, "generate", dataset_size,
+                                   [&raw, i]()
+                                   {
+                                       std::mt19937_64 random(i);
+                                       std::normal_distribution<double> dist(100.0 + double(i) * 10.0, 20.0);
+                                       for (auto& v : raw[i]) v = dist(random);
+                                   });
+        clean_tasks.push_back(meter.push(graph, "clean", dataset_size,
+                                         [&raw, &cleaned, i]()
+                                         {
+                                             cleaned[i].clear();
+                                             for (double v : raw[i])
+                                                 if (v >= 50.0 && v <= 200.0) cleaned[i].push_back(v);
+                                         })
+                                  .depend(generate));
+    }
+
+    Task aggregate = meter.push(graph, "aggregate", datasets * dataset_size,
+                                [&]()
+                                {
+                                    merged.clear();
+                                    for (const auto& d : cleaned) merged.insert(merged.end(), d.begin(), d.end());
+                                })
+                         .depend(clean_tasks);
+
+    Task stats = meter.push(graph, "statistics", datasets * dataset_size,
+                            [&]()
+                            {
+                                double sum = std::accumulate(merged.begin(), merged.end(), 0.0);
+                                mean = sum / double(merged.size());
+                                double squares = 0;
+                                for (double v : merged) squares += (v - mean) * (v - mean);
+                                deviation = std::sqrt(squares / double(merged.size()));
+                            })
+                     .depend(aggregate);
+    Task quantiles = meter.push(graph, "quantiles", datasets * dataset_size,
+                                [&]()
+                                {
+                                    std::vector<double> sorted = merged;
+                                    std::sort(sorted.begin(), sorted.end());
+                                    median = sorted[sorted.size() / 2];
+                                    p99 = sorted[sorted.size() * 99 / 100];
+                                })
+                         .depend(aggregate);
+    Task bins = meter.push(graph, "histogram", datasets * dataset_size,
+                           [&]()
+                           {
+                               histogram.fill(0);
+                               for (double v : merged)
+                                   histogram[std::min<std::size_t>(63, static_cast<std::size_t>((v - 50.0) / 2.5))]++;
+                           })
+                    .depend(aggregate);
+
+    std::vector<Task> report_inputs{stats, quantiles, bins};
+    for (std::size_t i = 0; i + 1 < datasets; i++)
+    {
+        report_inputs.push_back(meter.push(graph, "correlation", 2 * dataset_size,
+                                           [&raw, &correlation, i]()
+                                           {
+                                               const auto& a = raw[i];
+                                               const auto& b = raw[i + 1];
+                                               double ma = std::accumulate(a.begin(), a.end(), 0.0) / double(a.size());
+                                               double mb = std::accumulate(b.begin(), b.end(), 0.0) / double(b.size());
+                                               double ab = 0, aa = 0, bb = 0;
+                                               for (std::size_t k = 0; k < a.size(); k++)
+                                               {
+                                                   ab += (a[k] - ma) * (b[k] - mb);
+                                                   aa += (a[k] - ma) * (a[k] - ma);
+                                                   bb += (b[k] - mb) * (b[k] - mb);
+                                               }
+                                               benchmark::DoNotOptimize(correlation = ab / std::sqrt(aa * bb));
+                                           })
+                                    .depend(clean_tasks[i])
+                                    .depend(clean_tasks[i + 1]));
+    }
+    meter.push(graph, "report", 1, [&]() { benchmark::DoNotOptimize(mean + deviation + median + p99); })
+        .depend(report_inputs);
+
+    run(state, graph, meter);
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(datasets * dataset_size));
+}
+BENCHMARK(BM_WorkloadDataAnalysis)->Arg(4)->Arg(16)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// ---------------------------------------------------------------------------------------------------------------
+// Documents: generate text, tokenize and count words by chunks, merge the counts, rank the top words.
+
+constexpr std::size_t document_chunks = 8;
+constexpr std::size_t chunk_bytes = 32 * 1024;
+
+using WordCounts = std::unordered_map<std::string_view, std::uint32_t>;
+
+std::vector<std::string> vocabulary()
+{
+    std::vector<std::string> words;
+    std::mt19937 random(7);
+    std::uniform_int_distribution<int> length(2, 10);
+    std::uniform_int_distribution<int> letter('a', 'z');
+    for (int i = 0; i < 4096; i++)
+    {
+        std::string word(static_cast<std::size_t>(length(random)), ' ');
+        for (auto& c : word) c = static_cast<char>(letter(random));
+        if (i % 3 == 0) word[0] = static_cast<char>(std::toupper(word[0]));
+        words.push_back(word);
+    }
+    return words;
+}
+
+void BM_WorkloadDocuments(benchmark::State& state)
+{
+    const auto documents = static_cast<std::size_t>(state.range(0));
+    const std::vector<std::string> words = vocabulary();
+    std::vector<std::string> chunks(documents * document_chunks);
+    std::vector<std::vector<std::string>> tokens(chunks.size());
+    std::vector<WordCounts> chunk_counts(chunks.size());
+    std::vector<WordCounts> document_counts(documents);
+    std::vector<std::pair<std::string_view, std::uint32_t>> top;
+
+    ThreadGraph graph(bench::hardware_threads(), false);
+    StageMeter meter;
+    std::vector<Task> document_tasks;
+    for (std::size_t d = 0; d < documents; d++)
+    {
+        Task merge = meter.push(graph, "merge", document_chunks * chunk_bytes,
+                                [&, d]()
+                                {
+                                    document_counts[d].clear();
+                                    for (std::size_t c = 0; c < document_chunks; c++)
+                                        for (const auto& entry : chunk_counts[d * document_chunks + c])
+                                            document_counts[d][entry.first] += entry.second;
+                                });
+        for (std::size_t c = 0; c < document_chunks; c++)
+        {
+            const std::size_t index = d * document_chunks + c;
+            Task generate = meter.push(graph, "generate", chunk_bytes,
+                                       [&, index]()
+                                       {
+                                           // Zipf-like: low ranks are drawn much more often.
+                                           std::mt19937 random(static_cast<std::uint32_t>(index));
+                                           std::uniform_real_distribution<double> u(0.0, 1.0);
+                                           std::string& text = chunks[index];
+                                           text.clear();
+                                           while (text.size() < chunk_bytes)
+                                           {
+                                               auto rank = static_cast<std::size_t>(std::pow(double(words.size()),
+                                                                                             u(random))) - 1;
+                                               text += words[rank];
+                                               text += (rank % 11 == 0) ? ". " : " ";
+                                           }
+                                       });
+            Task tokenize = meter.push(graph, "tokenize", chunk_bytes,
+                                       [&, index]()
+                                       {
+                                           auto& out = tokens[index];
+                                           out.clear();
+                                           std::string word;
+                                           for (char c : chunks[index])
+                                           {
+                                               if (std::isalnum(static_cast<unsigned char>(c)))
+                                               {
+                                                   word += static_cast<char>(std::tolower(c));
+                                               }
+                                               else if (!word.empty())
+                                               {
+                                                   out.push_back(word);
+                                                   word.clear();
+                                               }
+                                           }
+                                           if (!word.empty()) out.push_back(word);
+                                       })
+                                .depend(generate);
+            Task count = meter.push(graph, "count", chunk_bytes,
+                                    [&, index]()
+                                    {
+                                        chunk_counts[index].clear();
+                                        for (const auto& token : tokens[index]) chunk_counts[index][token]++;
+                                    })
+                             .depend(tokenize);
+            merge.depend(count);
+        }
+        document_tasks.push_back(merge);
+    }
+    meter.push(graph, "rank", documents * document_chunks * chunk_bytes,
+               [&]()
+               {
+                   WordCounts total;
+                   for (const auto& counts : document_counts)
+                       for (const auto& entry : counts) total[entry.first] += entry.second;
+                   top.assign(total.begin(), total.end());
+                   auto by_count = [](const auto& a, const auto& b) { return a.second > b.second; };
+                   std::size_t n = std::min<std::size_t>(100, top.size());
+                   std::partial_sort(top.begin(), top.begin() + static_cast<std::ptrdiff_t>(n), top.end(), by_count);
+                   top.resize(n);
+               })
+        .depend(document_tasks);
+
+    run(state, graph, meter);
+    state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(chunks.size() * chunk_bytes));
+}
+BENCHMARK(BM_WorkloadDocuments)->Arg(4)->Arg(16)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+}  // namespace
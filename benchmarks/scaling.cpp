@@ -0,0 +1,309 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "athread/athread.h"
+#include "topologies.h"
+
+using namespace at;
+
+// Sweeps thread counts and task granularities for the pool and the graph, prints the speedup and efficiency
+// curves, and compares the throughput of every cell with a baseline written by an earlier run.
+//
+// Usage: athread_scaling [--threads 1,2,4] [--grains 100,1000,...] [--budget-ms 50] [--repeat 3]
+//                        [--out result.json] [--baseline baseline.json] [--threshold 0.10]
+// Grains are in nanoseconds. Exits with 1 when a cell is slower than its baseline by more than the threshold.
+
+namespace
+{
+
+struct Options
+{
+    std::vector<std::uint32_t> threads;
+    std::vector<std::uint64_t> grains{100, 1000, 10000, 100000, 1000000, 10000000};
+    std::uint64_t budget_ns{50000000};  // Work per cell, split into tasks of one grain.
+    int repeat{3};
+    std::string out;
+    std::string baseline;
+    double threshold{0.10};
+};
+
+struct Cell
+{
+    std::string scheduler;
+    std::uint64_t grain_ns;
+    std::uint32_t threads;
+    std::uint64_t tasks;
+    double seconds;
+    double speedup{1.0};
+    double efficiency{1.0};
+
+    std::string key() const { return scheduler + "/" + std::to_string(grain_ns) + "/" + std::to_string(threads); }
+    double tasks_per_second() const { return seconds > 0 ? double(tasks) / seconds : 0.0; }
+};
+
+volatile std::uint64_t sink;
+double iterations_per_ns = 1.0;
+
+std::uint64_t work(std::uint64_t iterations)
+{
+    std::uint64_t x = iterations;
+    for (std::uint64_t i = 0; i < iterations; i++) x = x * 6364136223846793005ull + 1442695040888963407ull;
+    return x;
+}
+
+// Busy work of a fixed number of instructions. A sleeping task, or one spinning on the clock, would also look
+// parallel when the threads outnumber the cores.
+void spin(std::uint64_t ns) { sink = work(static_cast<std::uint64_t>(double(ns) * iterations_per_ns)); }
+
+void calibrate()
+{
+    constexpr std::uint64_t iterations = 50000000;
+    auto begin = std::chrono::steady_clock::now();
+    sink = work(iterations);
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - begin;
+    iterations_per_ns = double(iterations) / elapsed.count();
+}
+
+std::uint64_t task_count(const Options& options, std::uint64_t grain, std::uint32_t max_threads)
+{
+    // Enough tasks to keep every worker busy, at most a million.
+    std::uint64_t tasks = options.budget_ns / grain;
+    return std::min<std::uint64_t>(std::max<std::uint64_t>(tasks, 8 * max_threads), 1000000);
+}
+
+double run_pool(std::uint32_t threads, std::uint64_t grain, std::uint64_t tasks)
+{
+    ThreadPool pool(threads, threads, std::chrono::seconds(60), true);
+    std::atomic<std::uint64_t> remaining{tasks};
+    for (std::uint64_t i = 0; i < tasks; i++)
+        pool.push(
+            [&remaining, grain]()
+            {
+                spin(grain);
+                remaining.fetch_sub(1, std::memory_order_relaxed);
+            });
+
+    auto begin = std::chrono::steady_clock::now();
+    pool.start();
+    while (remaining.load() != 0) std::this_thread::yield();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    pool.terminate(true);
+    return elapsed.count();
+}
+
+double run_graph(ThreadGraph& graph, std::uint32_t threads)
+{
+    graph.set_thread_count(threads);
+    auto begin = std::chrono::steady_clock::now();
+    graph.start();
+    graph.wait();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    return elapsed.count();
+}
+
+std::vector<Cell> sweep(const Options& options)
+{
+    std::vector<Cell> cells;
+    const std::uint32_t max_threads = *std::max_element(options.threads.begin(), options.threads.end());
+    for (std::uint64_t grain : options.grains)
+    {
+        const std::uint64_t tasks = task_count(options, grain, max_threads);
+
+        ThreadGraph graph(1, false);
+        bench::build_topology(graph, bench::Topology::FanOut, static_cast<std::size_t>(tasks),
+                              [grain]() { spin(grain); });
+
+        for (const char* scheduler : {"pool", "graph"})
+        {
+            double one_thread = 0;
+            for (std::uint32_t threads : options.threads)
+            {
+                // The best of the repetitions, the others were disturbed by something else.
+                double best = 0;
+                for (int r = 0; r < options.repeat; r++)
+                {
+                    double seconds = std::strcmp(scheduler, "pool") == 0 ? run_pool(threads, grain, tasks)
+                                                                          : run_graph(graph, threads);
+                    if (r == 0 || seconds < best) best = seconds;
+                }
+
+                Cell cell{scheduler, grain, threads, tasks, best};
+                if (threads == 1) one_thread = best;
+                if (one_thread > 0)
+                {
+                    cell.speedup = one_thread / best;
+                    cell.efficiency = cell.speedup / threads;
+                }
+                cells.push_back(cell);
+            }
+        }
+    }
+    return cells;
+}
+
+void write_json(std::ostream& out, const std::vector<Cell>& cells)
+{
+    out << "{\n  \"context\": {\"hardware_threads\": " << bench::hardware_threads() << ", \"version\": \""
+        << ATHREAD_VERSION_STRING << "\"},\n  \"results\": [\n";
+    for (std::size_t i = 0; i < cells.size(); i++)
+    {
+        const Cell& c = cells[i];
+        out << "    {\"scheduler\": \"" << c.scheduler << "\", \"grain_ns\": " << c.grain_ns
+            << ", \"threads\": " << c.threads << ", \"tasks\": " << c.tasks << ", \"seconds\": " << std::setprecision(9)
+            << c.seconds << ", \"tasks_per_second\": " << c.tasks_per_second() << ", \"speedup\": " << c.speedup
+            << ", \"efficiency\": " << c.efficiency << "}" << (i + 1 < cells.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+// Reads the `results` of a file written by write_json(). Only the flat objects of the array are parsed.
+std::map<std::string, double> read_baseline(const std::string& path)
+{
+    std::ifstream in(path);
+    if (!in) throw std::runtime_error("cannot read the baseline " + path);
+    std::stringstream text;
+    text << in.rdbuf();
+    std::string json = text.str();
+
+    std::map<std::string, double> throughput;
+    std::size_t pos = json.find("\"results\"");
+    if (pos == std::string::npos) throw std::runtime_error(path + " has no results");
+    while ((pos = json.find('{', pos)) != std::string::npos)
+    {
+        std::size_t end = json.find('}', pos);
+        if (end == std::string::npos) break;
+        std::map<std::string, std::string> fields;
+        std::istringstream object(json.substr(pos + 1, end - pos - 1));
+        for (std::string field; std::getline(object, field, ',');)
+        {
+            std::size_t colon = field.find(':');
+            if (colon == std::string::npos) continue;
+            auto trim = [](std::string s)
+            {
+                s.erase(std::remove_if(s.begin(), s.end(), [](char c) { return std::isspace(c) || c == '"'; }),
+                        s.end());
+                return s;
+            };
+            fields[trim(field.substr(0, colon))] = trim(field.substr(colon + 1));
+        }
+        if (fields.count("scheduler") && fields.count("tasks_per_second"))
+        {
+            std::string key = fields["scheduler"] + "/" + fields["grain_ns"] + "/" + fields["threads"];
+            throughput[key] = std::atof(fields["tasks_per_second"].c_str());
+        }
+        pos = end;
+    }
+    return throughput;
+}
+
+template <class Value>
+std::vector<Value> parse_list(const char* text)
+{
+    std::vector<Value> values;
+    std::istringstream in(text);
+    for (std::string item; std::getline(in, item, ',');)
+        if (!item.empty()) values.push_back(static_cast<Value>(std::stoull(item)));
+    return values;
+}
+
+Options parse_options(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) throw std::invalid_argument("missing value after " + arg);
+        const char* value = argv[++i];
+        if (arg == "--threads") options.threads = parse_list<std::uint32_t>(value);
+        else if (arg == "--grains") options.grains = parse_list<std::uint64_t>(value);
+        else if (arg == "--budget-ms") options.budget_ns = std::stoull(value) * 1000000;
+        else if (arg == "--repeat") options.repeat = std::max(1, std::atoi(value));
+        else if (arg == "--out") options.out = value;
+        else if (arg == "--baseline") options.baseline = value;
+        else if (arg == "--threshold") options.threshold = std::atof(value);
+        else throw std::invalid_argument("unknown option " + arg);
+    }
+
+    if (options.threads.empty())
+    {
+        // Powers of two up to the core count, and the core count itself.
+        const std::uint32_t cores = bench::hardware_threads();
+        for (std::uint32_t n = 1; n < cores; n *= 2) options.threads.push_back(n);
+        options.threads.push_back(cores);
+    }
+    if (std::find(options.threads.begin(), options.threads.end(), 1u) == options.threads.end())
+        options.threads.insert(options.threads.begin(), 1);  // Speedups are relative to one thread.
+    std::sort(options.threads.begin(), options.threads.end());
+    options.threads.erase(std::remove(options.threads.begin(), options.threads.end(), 0u), options.threads.end());
+    options.grains.erase(std::remove(options.grains.begin(), options.grains.end(), 0u), options.grains.end());
+    if (options.grains.empty()) throw std::invalid_argument("no task granularity to measure");
+    return options;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+try
+{
+    const Options options = parse_options(argc, argv);
+    std::map<std::string, double> baseline;
+    if (!options.baseline.empty()) baseline = read_baseline(options.baseline);
+
+    calibrate();
+    const std::vector<Cell> cells = sweep(options);
+
+    int regressions = 0;
+    std::cout << std::left << std::setw(7) << "sched" << std::right << std::setw(10) << "grain ns" << std::setw(8)
+              << "threads" << std::setw(9) << "tasks" << std::setw(12) << "seconds" << std::setw(9) << "speedup"
+              << std::setw(11) << "efficiency" << std::setw(10) << "vs base" << "\n";
+    for (const Cell& cell : cells)
+    {
+        std::cout << std::left << std::setw(7) << cell.scheduler << std::right << std::setw(10) << cell.grain_ns
+                  << std::setw(8) << cell.threads << std::setw(9) << cell.tasks << std::fixed << std::setprecision(6)
+                  << std::setw(12) << cell.seconds << std::setprecision(2) << std::setw(9) << cell.speedup
+                  << std::setw(11) << cell.efficiency;
+        auto base = baseline.find(cell.key());
+        if (base != baseline.end() && base->second > 0)
+        {
+            double change = cell.tasks_per_second() / base->second - 1.0;
+            bool regressed = change < -options.threshold;
+            regressions += regressed ? 1 : 0;
+            std::cout << std::showpos << std::setw(9) << change * 100 << "%" << std::noshowpos
+                      << (regressed ? "  REGRESSION" : "");
+        }
+        std::cout << std::defaultfloat << "\n";
+    }
+
+    if (!options.out.empty())
+    {
+        std::ofstream out(options.out, std::ios::trunc);
+        write_json(out, cells);
+        if (!out) throw std::runtime_error("cannot write " + options.out);
+    }
+
+    if (regressions)
+    {
+        std::cout << regressions << " cell(s) slower than the baseline by more than " << options.threshold * 100
+                  << "%\n";
+        return 1;
+    }
+    return 0;
+}
+catch (const std::exception& e)
+{
+    std::cerr << "athread_scaling: " << e.what() << std::endl;
+    return 2;
+}
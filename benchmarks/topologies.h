@@ -0,0 +1,95 @@
+#ifndef BENCHMARKS_TOPOLOGIES_H__
+#define BENCHMARKS_TOPOLOGIES_H__
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "athread/athread.h"
+
+namespace bench
+{
+
+enum class Topology
+{
+    Chain,     // Each node depends on the previous one, no parallelism.
+    FanOut,    // One root and every other node depending on it.
+    Tree,      // Binary tree, node i depends on node (i - 1) / 2.
+    Random,    // Each node depends on up to two earlier nodes picked with a fixed seed.
+    Wavefront  // Square grid, a cell depends on the cells above and on its left.
+};
+
+inline const char* topology_name(Topology topology)
+{
+    switch (topology)
+    {
+        case Topology::Chain: return "chain";
+        case Topology::FanOut: return "fanout";
+        case Topology::Tree: return "tree";
+        case Topology::Random: return "random";
+        case Topology::Wavefront: return "wavefront";
+    }
+    return "unknown";
+}
+
+/**
+ * @brief Adds `nodes` nodes running `work` to `graph`, linked as `topology`. Wavefront grids are rounded down to
+ * a square.
+ */
+template <class Fn>
+std::vector<at::Task> build_topology(at::ThreadGraph& graph, Topology topology, std::size_t nodes, Fn work)
+{
+    std::vector<at::Task> tasks;
+    if (topology == Topology::Wavefront)
+    {
+        const std::size_t side = std::max<std::size_t>(1, static_cast<std::size_t>(std::sqrt(double(nodes))));
+        tasks.reserve(side * side);
+        for (std::size_t row = 0; row < side; row++)
+        {
+            for (std::size_t col = 0; col < side; col++)
+            {
+                at::Task cell = graph.push(work);
+                if (row > 0) cell.depend(tasks[(row - 1) * side + col]);
+                if (col > 0) cell.depend(tasks[row * side + col - 1]);
+                tasks.push_back(cell);
+            }
+        }
+        return tasks;
+    }
+
+    std::mt19937_64 random(42);
+    tasks.reserve(nodes);
+    for (std::size_t i = 0; i < nodes; i++)
+    {
+        at::Task node = graph.push(work);
+        if (i > 0)
+        {
+            switch (topology)
+            {
+                case Topology::Chain: node.depend(tasks[i - 1]); break;
+                case Topology::FanOut: node.depend(tasks[0]); break;
+                case Topology::Tree: node.depend(tasks[(i - 1) / 2]); break;
+                case Topology::Random:
+                {
+                    std::size_t a = random() % i;
+                    std::size_t b = random() % i;
+                    node.depend(tasks[a]);
+                    if (b != a) node.depend(tasks[b]);
+                    break;
+                }
+                default: break;
+            }
+        }
+        tasks.push_back(node);
+    }
+    return tasks;
+}
+
+inline std::uint32_t hardware_threads() { return std::max(1u, std::thread::hardware_concurrency()); }
+
+}  // namespace bench
+
+#endif  // BENCHMARKS_TOPOLOGIES_H__
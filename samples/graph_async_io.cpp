@@ -0,0 +1,86 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "athread/athread.h"
+
+using namespace at;
+using namespace std;
+
+// Document pipeline where loading and storing go through asynchronous I/O nodes.
+// The workers only run the processing steps, the reads and writes are in flight on the I/O context.
+int main()
+{
+    IoContext io;
+    AT_COUT("I/O backend: " << (io.backend() == IoBackend::Uring ? "io_uring" : "threads") << endl);
+
+    const int documentCount = 4;
+    vector<string> paths;
+    vector<int> files;
+    vector<string> contents;
+    for (int i = 0; i < documentCount; i++)
+    {
+        paths.push_back("athread_document_" + to_string(i) + ".txt");
+        files.push_back(::open(paths.back().c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644));
+        if (files.back() < 0)
+        {
+            perror("open");
+            return 1;
+        }
+        contents.push_back("This is content of document " + to_string(i) +
+                           " containing some example text for processing and some more text to analyze.");
+    }
+
+    vector<vector<char>> buffers(documentCount);
+    vector<unordered_map<string, int>> frequencies(documentCount);
+
+    ThreadGraph graph(2);
+    vector<Task> countTasks;
+    for (int i = 0; i < documentCount; i++)
+    {
+        buffers[i].resize(contents[i].size());
+
+        // Step 1: store the document
+        auto storeTask = graph.emplace<IoWriteNode>(io, files[i], contents[i].data(), contents[i].size(), 0);
+
+        // Step 2: load it back, the worker is released as soon as the read is submitted
+        auto onLoaded = [i](long bytes) { AT_COUT("Document " << i << " loaded " << bytes << " bytes" << endl); };
+        auto loadTask = graph.emplace<IoReadNode>(io, files[i], buffers[i].data(), buffers[i].size(), 0, onLoaded);
+        loadTask.depend(storeTask);
+
+        // Step 3: count words
+        auto countTask = graph.push(
+            [i, &buffers, &frequencies]()
+            {
+                istringstream stream(string(buffers[i].begin(), buffers[i].end()));
+                string word;
+                while (stream >> word) frequencies[i][word]++;
+            });
+        countTask.depend(loadTask);
+        countTasks.push_back(countTask);
+    }
+
+    auto reportTask = graph.push(
+        [&frequencies]()
+        {
+            for (size_t i = 0; i < frequencies.size(); i++)
+                AT_COUT("Document " << i << " has " << frequencies[i].size() << " distinct words" << endl);
+        });
+    reportTask.depend(countTasks);
+
+    graph.start();
+    graph.wait();
+
+    for (int i = 0; i < documentCount; i++)
+    {
+        ::close(files[i]);
+        ::unlink(paths[i].c_str());
+    }
+    return 0;
+}
@@ -1,5 +1,5 @@
 #include "athread/athread.h"
-#include <atomic>
+#include <functional>
 #include <iostream>
 #include <numeric>
 #include <vector>
@@ -11,16 +11,18 @@ int main()
 {
     ThreadGraph graph;
     std::vector<std::vector<int>> matrix = {{1, 2, 3}, {4, 5, 6}, {7, 8, 9}};
-    std::atomic<int> totalSum{0};
+
+    // Each worker accumulates into its own slot, no shared counter to contend on
+    WorkerLocal<int> partialSums(0);
 
     // Push tasks to compute the sum of each row
     for (const auto& row : matrix)
     {
         graph.push(
-            [&row, &totalSum]()
+            [&row, &partialSums]()
             {
                 int rowSum = std::accumulate(row.begin(), row.end(), 0);
-                totalSum += rowSum;
+                partialSums.local() += rowSum;
             });
     }
 
@@ -28,6 +30,6 @@ int main()
     graph.start();
     graph.wait();
 
-    cout << "Total sum of matrix: " << totalSum.load() << endl;
+    cout << "Total sum of matrix: " << partialSums.combine(std::plus<int>()) << endl;
     return 0;
 }
@@ -0,0 +1,57 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include "athread/athread.h"
+
+using namespace at;
+using namespace std;
+
+// Runs a fan-out/fan-in graph with tracing and profiling enabled, writes its timeline and a profile report.
+// Open trace.json in chrome://tracing, or either file in https://ui.perfetto.dev.
+int main()
+{
+    ThreadGraph graph(4, false);
+    map<uint64_t, string> names;
+
+    auto load = graph.push([]() { this_thread::sleep_for(chrono::milliseconds(2)); });
+    load.set_label("load");
+    vector<Task> parts;
+    for (int i = 0; i < 8; i++)
+    {
+        auto part = graph.push([i]() { this_thread::sleep_for(chrono::milliseconds(1 + i % 3)); });
+        part.set_label("part " + to_string(i)).depend(load);
+        parts.push_back(part);
+    }
+    auto merge = graph.push([]() { this_thread::sleep_for(chrono::milliseconds(1)); });
+    merge.set_label("merge").depend(parts);
+
+    for (const auto& task : parts) names[task.uid()] = task.label();
+    names[load.uid()] = load.label();
+    names[merge.uid()] = merge.label();
+
+    Trace::enable();
+    graph.set_profiling(true);
+    graph.start();
+    graph.wait();
+    Trace::disable();
+
+    vector<TraceEvent> events;
+    Trace::drain(events);
+
+    TraceExportOptions options;
+    options.process_name = "graph_trace";
+    options.task_name = [&names](uint64_t id) { return names.count(id) ? names[id] : string(); };
+
+    ofstream json("trace.json");
+    write_chrome_trace(json, events, options);
+    ofstream perfetto("trace.perfetto-trace", ios::binary);
+    write_perfetto_trace(perfetto, events, options);
+
+    AT_COUT(events.size() << " events written to trace.json and trace.perfetto-trace" << endl);
+    graph.profile().write_report(cout);
+    return 0;
+}
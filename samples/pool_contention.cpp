@@ -0,0 +1,63 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "athread/athread.h"
+
+using namespace at;
+using namespace std;
+
+// Stresses the shared state of the pool and the graph with many tiny tasks pushed from several threads.
+// Usage: pool_contention [producers] [workers] [tasks per producer]
+int main(int argc, char** argv)
+{
+    const unsigned hardware = std::max(1u, thread::hardware_concurrency());
+    const unsigned producers = argc > 1 ? static_cast<unsigned>(atoi(argv[1])) : hardware;
+    const unsigned workers = argc > 2 ? static_cast<unsigned>(atoi(argv[2])) : hardware;
+    const long tasks = argc > 3 ? atol(argv[3]) : 200000;
+    const long total = tasks * producers;
+
+    {
+        ThreadPool pool(workers, workers);
+        atomic<long> remaining{total};
+
+        auto begin = chrono::steady_clock::now();
+        vector<thread> threads;
+        for (unsigned p = 0; p < producers; p++)
+        {
+            threads.emplace_back(
+                [&]()
+                {
+                    for (long i = 0; i < tasks; i++) pool.push([&remaining]() { remaining.fetch_sub(1); });
+                });
+        }
+        for (auto& t : threads) t.join();
+        while (remaining.load() != 0) this_thread::yield();
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - begin;
+
+        AT_COUT("pool : " << producers << " producers, " << workers << " workers, " << total << " tasks in "
+                          << elapsed.count() << " s (" << static_cast<long>(total / elapsed.count()) << " tasks/s)"
+                          << endl);
+        pool.terminate(true);
+    }
+
+    {
+        const long nodes = total / 10;
+        ThreadGraph graph(workers, false);
+        atomic<long> done{0};
+        for (long i = 0; i < nodes; i++) graph.push([&done]() { done.fetch_add(1); });
+
+        auto begin = chrono::steady_clock::now();
+        graph.start();
+        graph.wait();
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - begin;
+
+        AT_COUT("graph: " << workers << " workers, " << nodes << " independent nodes in " << elapsed.count() << " s ("
+                          << static_cast<long>(nodes / elapsed.count()) << " nodes/s)" << endl);
+    }
+
+    return 0;
+}
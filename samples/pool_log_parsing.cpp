@@ -0,0 +1,59 @@
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "athread/athread.h"
+
+using namespace at;
+using namespace std;
+
+// Counts log levels of a log file by mapping it and parsing record-aligned chunks in parallel.
+int main()
+{
+    const string path = "athread_sample.log";
+    {
+        ofstream log(path);
+        const char* levels[] = {"INFO", "WARN", "ERROR"};
+        for (int i = 0; i < 200000; i++)
+            log << "2026-01-01T00:00:00Z " << levels[i % 7 == 0 ? 2 : i % 3 == 0 ? 1 : 0] << " request " << i
+                << " served\n";
+    }
+
+    MappedFile file(path);
+    ThreadPool pool(4, 4);
+    std::atomic<long> info{0}, warn{0}, error{0};
+
+    auto begin = chrono::steady_clock::now();
+    parallel_for(pool, file, 1 << 20, RecordFormat::Newline,
+                 [&](string_view chunk)
+                 {
+                     long i = 0, w = 0, e = 0;
+                     for_each_record(chunk, RecordFormat::Newline,
+                                     [&](string_view line)
+                                     {
+                                         string_view level = line.substr(21, 5);
+                                         if (level.substr(0, 4) == "INFO")
+                                             i++;
+                                         else if (level.substr(0, 4) == "WARN")
+                                             w++;
+                                         else if (level == "ERROR")
+                                             e++;
+                                     });
+                     info += i;
+                     warn += w;
+                     error += e;
+                 });
+    auto elapsed = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - begin);
+
+    AT_COUT("Parsed " << file.size() << " bytes in " << elapsed.count() << " us" << endl);
+    AT_COUT("INFO: " << info << ", WARN: " << warn << ", ERROR: " << error << endl);
+
+    file.close();
+    ::unlink(path.c_str());
+    return 0;
+}
@@ -0,0 +1,254 @@
+#include "affinity.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <tuple>
+
+#include "diagnostics.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace at;
+
+namespace
+{
+
+// Parses a sysfs cpu list such as "0-3,8,10-11".
+std::vector<int> parse_cpu_list(const std::string& text)
+{
+    std::vector<int> result;
+    std::stringstream stream(text);
+    std::string range;
+    while (std::getline(stream, range, ','))
+    {
+        if (range.empty() || range == "\n") continue;
+        std::size_t dash = range.find('-');
+        try
+        {
+            int first = std::stoi(range.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; cpu++) result.push_back(cpu);
+        }
+        catch (const std::exception&)
+        {
+            return {};
+        }
+    }
+    return result;
+}
+
+std::string read_first_line(const std::string& path)
+{
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+int read_int(const std::string& path, int fallback)
+{
+    std::string line = read_first_line(path);
+    try
+    {
+        return line.empty() ? fallback : std::stoi(line);
+    }
+    catch (const std::exception&)
+    {
+        return fallback;
+    }
+}
+
+std::vector<CpuInfo> discover_cpus()
+{
+    std::vector<CpuInfo> cpus;
+
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    bool has_mask = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+    std::map<int, int> cpu_nodes;
+    for (int node : parse_cpu_list(read_first_line("/sys/devices/system/node/online")))
+    {
+        auto node_cpus =
+            parse_cpu_list(read_first_line("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"));
+        for (int cpu : node_cpus) cpu_nodes[cpu] = node;
+    }
+
+    for (int cpu : parse_cpu_list(read_first_line("/sys/devices/system/cpu/online")))
+    {
+        if (has_mask && (cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowed))) continue;
+
+        std::string topology = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+        auto node = cpu_nodes.find(cpu);
+        cpus.push_back(CpuInfo{cpu, read_int(topology + "physical_package_id", 0), read_int(topology + "core_id", cpu),
+                               node == cpu_nodes.end() ? 0 : node->second});
+    }
+#endif
+
+    if (cpus.empty())
+    {
+        int count = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        for (int cpu = 0; cpu < count; cpu++) cpus.push_back(CpuInfo{cpu, 0, cpu, 0});
+    }
+    return cpus;
+}
+
+// CPUs ordered so that neighbours share a core, then a socket, then a node.
+std::vector<CpuInfo> sorted_cpus(const CpuTopology& topology)
+{
+    std::vector<CpuInfo> cpus = topology.cpus();
+    std::sort(cpus.begin(), cpus.end(),
+              [](const CpuInfo& a, const CpuInfo& b) {
+                  return std::tie(a.node, a.package, a.core, a.cpu) < std::tie(b.node, b.package, b.core, b.cpu);
+              });
+    return cpus;
+}
+
+std::vector<int> compact_order(const CpuTopology& topology)
+{
+    std::vector<int> order;
+    for (const auto& info : sorted_cpus(topology)) order.push_back(info.cpu);
+    return order;
+}
+
+std::vector<int> scatter_order(const CpuTopology& topology)
+{
+    // Within a node, the first hardware thread of every core comes before the siblings.
+    std::map<std::pair<int, int>, int> sibling_rank;
+    std::vector<std::tuple<int, int, int, int, int>> keyed;  // node, sibling rank, package, core, cpu
+    for (const auto& info : sorted_cpus(topology))
+    {
+        int rank = sibling_rank[std::make_pair(info.package, info.core)]++;
+        keyed.emplace_back(info.node, rank, info.package, info.core, info.cpu);
+    }
+    std::sort(keyed.begin(), keyed.end());
+
+    std::map<int, std::vector<int>> per_node;
+    for (const auto& key : keyed) per_node[std::get<0>(key)].push_back(std::get<4>(key));
+
+    // Round robin over the nodes.
+    std::vector<int> order;
+    for (std::size_t index = 0; order.size() < keyed.size(); index++)
+    {
+        for (const auto& node : per_node)
+            if (index < node.second.size()) order.push_back(node.second[index]);
+    }
+    return order;
+}
+
+}  // namespace
+
+const CpuTopology& CpuTopology::system()
+{
+    static const CpuTopology topology(discover_cpus());
+    return topology;
+}
+
+CpuTopology::CpuTopology(std::vector<CpuInfo> cpus) : _cpus(std::move(cpus))
+{
+    for (const auto& info : _cpus) _node_ids.push_back(info.node);
+    std::sort(_node_ids.begin(), _node_ids.end());
+    _node_ids.erase(std::unique(_node_ids.begin(), _node_ids.end()), _node_ids.end());
+}
+
+int CpuTopology::node_of(int cpu) const
+{
+    for (const auto& info : _cpus)
+        if (info.cpu == cpu) return info.node;
+    return -1;
+}
+
+std::vector<int> CpuTopology::cpus_of_node(int node) const
+{
+    std::vector<int> result;
+    for (const auto& info : _cpus)
+        if (info.node == node) result.push_back(info.cpu);
+    return result;
+}
+
+int CpuTopology::current_node() const
+{
+#ifdef __linux__
+    int cpu = sched_getcpu();
+    return cpu < 0 ? -1 : node_of(cpu);
+#else
+    return -1;
+#endif
+}
+
+AffinityPolicy AffinityPolicy::compact() { return AffinityPolicy(AffinityMode::Compact, {}, -1); }
+
+AffinityPolicy AffinityPolicy::scatter() { return AffinityPolicy(AffinityMode::Scatter, {}, -1); }
+
+AffinityPolicy AffinityPolicy::cpus(std::vector<int> cpu_list)
+{
+    if (cpu_list.empty()) AT_INVALID_ARGUMENT("CPU list must not be empty.");
+    return AffinityPolicy(AffinityMode::Explicit, std::move(cpu_list), -1);
+}
+
+AffinityPolicy AffinityPolicy::numa_node(int node)
+{
+    if (node < 0) AT_INVALID_ARGUMENT("NUMA node must not be negative.");
+    return AffinityPolicy(AffinityMode::NumaNode, {}, node);
+}
+
+std::vector<int> AffinityPolicy::cpus_for(std::uint32_t worker_id, const CpuTopology& topology) const
+{
+    switch (_mode)
+    {
+    case AffinityMode::Compact:
+    {
+        auto order = compact_order(topology);
+        return {order[worker_id % order.size()]};
+    }
+    case AffinityMode::Scatter:
+    {
+        auto order = scatter_order(topology);
+        return {order[worker_id % order.size()]};
+    }
+    case AffinityMode::Explicit: return {_cpu_list[worker_id % _cpu_list.size()]};
+    case AffinityMode::NumaNode: return topology.cpus_of_node(_node);
+    case AffinityMode::None: break;
+    }
+    return {};
+}
+
+int AffinityPolicy::node_for(std::uint32_t worker_id, const CpuTopology& topology) const
+{
+    if (_mode == AffinityMode::None) return -1;
+    if (_mode == AffinityMode::NumaNode) return _node;
+
+    auto cpus = cpus_for(worker_id, topology);
+    return cpus.empty() ? -1 : topology.node_of(cpus.front());
+}
+
+bool at::apply_affinity(std::thread& thread, const std::vector<int>& cpus)
+{
+    return apply_affinity(thread.native_handle(), cpus);
+}
+
+bool at::apply_affinity(std::thread::native_handle_type handle, const std::vector<int>& cpus)
+{
+#ifdef __linux__
+    if (cpus.empty()) return false;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus)
+    {
+        if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+        CPU_SET(cpu, &set);
+    }
+    return pthread_setaffinity_np(handle, sizeof(set), &set) == 0;
+#else
+    (void)handle, (void)cpus;
+    return false;
+#endif
+}
@@ -0,0 +1,173 @@
+//////////////////////////////////////////////////////////////////////////
+// Copyright 2026 Le Xuan Tuan Anh
+//
+// https://github.com/z-pc/athread
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef AFFINITY_H__
+#define AFFINITY_H__
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace at
+{
+
+/**
+ * @struct CpuInfo
+ * @brief Location of one logical CPU.
+ */
+struct CpuInfo
+{
+    int cpu;      ///< Logical CPU number.
+    int package;  ///< Physical package (socket).
+    int core;     ///< Core id inside the package.
+    int node;     ///< NUMA node.
+};
+
+/**
+ * @class CpuTopology
+ * @brief Logical CPUs usable by the process, with their socket, core and NUMA node.
+ *
+ * On Linux the topology is read from sysfs and restricted to the CPUs of the process affinity mask.
+ * Elsewhere every CPU reported by `std::thread::hardware_concurrency()` is assumed to sit on node 0.
+ */
+class CpuTopology
+{
+public:
+    /**
+     * @brief Returns the topology of the machine, discovered once.
+     */
+    static const CpuTopology& system();
+
+    /**
+     * @brief Builds a topology from an explicit CPU list, mostly useful for testing policies.
+     */
+    explicit CpuTopology(std::vector<CpuInfo> cpus);
+
+    const std::vector<CpuInfo>& cpus() const { return _cpus; }
+
+    /**
+     * @brief Returns the number of NUMA nodes that have at least one usable CPU.
+     */
+    std::size_t node_count() const { return _node_ids.size(); }
+
+    /**
+     * @brief Returns the ids of the NUMA nodes that have at least one usable CPU, in ascending order.
+     */
+    const std::vector<int>& node_ids() const { return _node_ids; }
+
+    /**
+     * @brief Returns the NUMA node of a logical CPU, or -1 if the CPU is unknown.
+     */
+    int node_of(int cpu) const;
+
+    /**
+     * @brief Returns the logical CPUs of a NUMA node.
+     */
+    std::vector<int> cpus_of_node(int node) const;
+
+    /**
+     * @brief Returns the NUMA node of the CPU the calling thread runs on, or -1 if unknown.
+     */
+    int current_node() const;
+
+private:
+    std::vector<CpuInfo> _cpus;
+    std::vector<int> _node_ids;
+};
+
+/**
+ * @enum AffinityMode
+ * @brief How workers are placed on CPUs.
+ *
+ * - `None`: the OS schedules workers freely.
+ * - `Compact`: consecutive workers on neighbouring CPUs, filling a socket before the next one.
+ * - `Scatter`: consecutive workers spread round robin over the NUMA nodes.
+ * - `Explicit`: worker `i` pinned to the `i`-th CPU of a user list, wrapping around.
+ * - `NumaNode`: every worker may run on any CPU of one NUMA node.
+ */
+enum class AffinityMode
+{
+    None,
+    Compact,
+    Scatter,
+    Explicit,
+    NumaNode
+};
+
+/**
+ * @class AffinityPolicy
+ * @brief Maps worker ids to the CPUs they are allowed to run on.
+ *
+ * Example:
+ * @code
+ *   at::ThreadPool pool(16, 16);
+ *   pool.set_affinity(at::AffinityPolicy::scatter());
+ * @endcode
+ */
+class AffinityPolicy
+{
+public:
+    /**
+     * @brief Constructs a policy that does not restrict workers.
+     */
+    AffinityPolicy() {}
+
+    static AffinityPolicy compact();
+    static AffinityPolicy scatter();
+    static AffinityPolicy cpus(std::vector<int> cpu_list);
+    static AffinityPolicy numa_node(int node);
+
+    AffinityMode mode() const { return _mode; }
+    bool enabled() const { return _mode != AffinityMode::None; }
+
+    /**
+     * @brief Returns the CPUs the worker with the given id may run on. Empty means no restriction.
+     */
+    std::vector<int> cpus_for(std::uint32_t worker_id, const CpuTopology& topology = CpuTopology::system()) const;
+
+    /**
+     * @brief Returns the NUMA node the worker with the given id is placed on, or -1 if it is not bound to one.
+     */
+    int node_for(std::uint32_t worker_id, const CpuTopology& topology = CpuTopology::system()) const;
+
+private:
+    AffinityPolicy(AffinityMode mode, std::vector<int> cpu_list, int node)
+        : _mode(mode), _cpu_list(std::move(cpu_list)), _node(node)
+    {
+    }
+
+    AffinityMode _mode{AffinityMode::None};
+    std::vector<int> _cpu_list;
+    int _node{-1};
+};
+
+/**
+ * @brief Restricts a running thread to the given CPUs.
+ *
+ * @return true on success, false if the CPUs are invalid or the platform does not support it.
+ */
+bool apply_affinity(std::thread& thread, const std::vector<int>& cpus);
+
+/**
+ * @brief Restricts a running thread, given by its native handle, to the given CPUs.
+ */
+bool apply_affinity(std::thread::native_handle_type handle, const std::vector<int>& cpus);
+
+}  // namespace at
+
+#endif  // AFFINITY_H__
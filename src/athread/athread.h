@@ -19,14 +19,32 @@
 #ifndef ATHREAD_H__
 #define ATHREAD_H__
 
+#include "affinity.h"
 #include "diagnostics.h"
 #include "executor.h"
+#include "graphprofile.h"
+#include "graphsnapshot.h"
+#include "io.h"
+#include "lockprofile.h"
+#include "log.h"
+#include "mappedfile.h"
+#include "metrics.h"
+#include "metricsexport.h"
 #include "node.h"
+#include "observer.h"
+#include "parallel.h"
+#include "perfcounters.h"
 #include "runnable.h"
+#include "simulator.h"
 #include "status.h"
 #include "task.h"
 #include "threadgraph.h"
 #include "threadpool.h"
+#include "trace.h"
+#include "traceexport.h"
 #include "version.h"
+#include "watchdog.h"
+#include "workerlocal.h"
+#include "workerthread.h"
 
 #endif  // ATHREAD_H__
@@ -0,0 +1,49 @@
+//////////////////////////////////////////////////////////////////////////
+// Copyright 2026 Le Xuan Tuan Anh
+//
+// https://github.com/z-pc/athread
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef CACHELINE_H__
+#define CACHELINE_H__
+
+#include <cstddef>
+
+// std::hardware_destructive_interference_size is not available everywhere and GCC warns when it is
+// used in headers since its value may change between compiler flags. A fixed value keeps the ABI stable.
+#ifndef AT_CACHE_LINE_SIZE
+#define AT_CACHE_LINE_SIZE 64
+#endif
+
+// Tasks are small heap objects allocated back to back, so the states of neighbouring tasks executed by
+// different workers usually share a cache line. Padding them removes that false sharing but makes every
+// task two cache lines and goes through the slower aligned allocator, which costs more than it saves
+// for tiny tasks on few cores. It is therefore opt-in.
+#ifdef AT_PAD_TASKS
+#define AT_TASK_STATE_ALIGN alignas(AT_CACHE_LINE_SIZE)
+#else
+#define AT_TASK_STATE_ALIGN
+#endif
+
+namespace at
+{
+/**
+ * @brief Minimum distance between two objects written by different threads to avoid false sharing.
+ */
+constexpr std::size_t cache_line_size = AT_CACHE_LINE_SIZE;
+
+}  // namespace at
+
+#endif  // CACHELINE_H__
@@ -35,6 +35,7 @@ extern std::mutex at_console_mutex;
         std::cout << text;                                    \
     }
 
+// Formats and writes immediately under the console lock, prefer the deferred AT_LOG_* macros of log.h.
 #ifdef AT_TRACKING
 #define AT_LOG(text) AT_COUT(">" << text << std::endl)
 #else
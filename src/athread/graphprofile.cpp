@@ -0,0 +1,178 @@
+#include "graphprofile.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "node.h"
+
+using namespace at;
+
+namespace
+{
+std::chrono::nanoseconds since(std::uint64_t origin, std::uint64_t timestamp)
+{
+    return std::chrono::nanoseconds(timestamp > origin ? static_cast<std::int64_t>(timestamp - origin) : 0);
+}
+
+double ms(std::chrono::nanoseconds duration) { return std::chrono::duration<double, std::milli>(duration).count(); }
+
+void write_counts(std::ostream& out, const PerfCounts& counts)
+{
+    static const char* const names[perf_event_count] = {"cycles", "instructions", "cache misses",
+                                                         "context switches"};
+    const char* separator = "";
+    for (std::size_t i = 0; i < perf_event_count; i++)
+    {
+        if (!counts.has(static_cast<PerfEvent>(i))) continue;
+        out << separator << counts.values[i] << ' ' << names[i];
+        separator = ", ";
+    }
+    if (counts.ipc() > 0) out << " (IPC " << counts.ipc() << ")";
+}
+}  // namespace
+
+double GraphProfile::parallelism() const
+{
+    return span.count() > 0 ? static_cast<double>(work.count()) / static_cast<double>(span.count()) : 0.0;
+}
+
+double GraphProfile::speedup() const
+{
+    return makespan.count() > 0 ? static_cast<double>(work.count()) / static_cast<double>(makespan.count()) : 0.0;
+}
+
+GraphProfile GraphProfile::build(const std::vector<INode*>& tasks, const std::vector<NodeTiming>& timings,
+                                 std::uint64_t origin, std::uint32_t worker_count)
+{
+    GraphProfile profile;
+    profile.worker_count = worker_count;
+
+    const std::size_t count = std::min(tasks.size(), timings.size());
+    std::unordered_map<const INode*, std::size_t> index_of;
+    index_of.reserve(count);
+    for (std::size_t i = 0; i < count; i++) index_of[tasks[i]] = i;
+
+    // Topological order, predecessors first. Edges to nodes outside of the graph are ignored.
+    std::vector<std::size_t> order;
+    std::vector<std::uint32_t> remaining(count, 0);
+    order.reserve(count);
+    for (std::size_t i = 0; i < count; i++)
+    {
+        for (const INode* predecessor : tasks[i]->predecessors())
+            if (index_of.count(predecessor)) remaining[i]++;
+        if (remaining[i] == 0) order.push_back(i);
+    }
+    for (std::size_t head = 0; head < order.size(); head++)
+    {
+        for (const INode* successor : tasks[order[head]]->successors())
+        {
+            auto it = index_of.find(successor);
+            if (it != index_of.end() && --remaining[it->second] == 0) order.push_back(it->second);
+        }
+    }
+
+    profile.nodes.resize(count);
+    std::vector<std::chrono::nanoseconds> path_length(count, std::chrono::nanoseconds(0));
+    std::vector<std::size_t> path_previous(count, count);
+    std::size_t path_end = count;
+
+    for (std::size_t i : order)
+    {
+        const NodeTiming& timing = timings[i];
+        NodeProfile& node = profile.nodes[i];
+        node.uid = tasks[i]->uid();
+        node.label = tasks[i]->label();
+        node.worker = timing.worker;
+        node.executed = timing.start != 0 && timing.finish >= timing.start;
+
+        std::uint64_t ready = origin;
+        std::chrono::nanoseconds longest(0);
+        for (const INode* predecessor : tasks[i]->predecessors())
+        {
+            auto it = index_of.find(predecessor);
+            if (it == index_of.end()) continue;
+            ready = std::max(ready, timings[it->second].finish);
+            if (path_previous[i] == count || path_length[it->second] > longest)
+            {
+                longest = path_length[it->second];
+                path_previous[i] = it->second;
+            }
+        }
+        if (!node.executed) continue;
+
+        node.ready = since(origin, ready);
+        node.start = since(origin, timing.start);
+        node.end = since(origin, timing.finish);
+        node.ready = std::min(node.ready, node.start);
+        node.cpu_time = std::chrono::nanoseconds(static_cast<std::int64_t>(timing.cpu_time));
+        node.counters = timing.counters;
+        profile.counters += node.counters;
+        profile.perf_counters = profile.perf_counters || timing.count_events;
+
+        profile.work += node.wall_time();
+        profile.cpu_time += node.cpu_time;
+        profile.queue_wait += node.queue_wait();
+        profile.makespan = std::max(profile.makespan, node.end);
+
+        path_length[i] = longest + node.wall_time();
+        if (path_end == count || path_length[i] > path_length[path_end]) path_end = i;
+    }
+
+    if (path_end != count)
+    {
+        profile.span = path_length[path_end];
+        for (std::size_t i = path_end; i != count; i = path_previous[i])
+        {
+            profile.critical_path.push_back(profile.nodes[i].uid);
+            profile.scheduler_overhead += profile.nodes[i].queue_wait();
+        }
+        std::reverse(profile.critical_path.begin(), profile.critical_path.end());
+    }
+    return profile;
+}
+
+void GraphProfile::write_report(std::ostream& out) const
+{
+    std::size_t executed = 0;
+    for (const auto& node : nodes)
+        if (node.executed) executed++;
+
+    out << "nodes              : " << executed << " of " << nodes.size() << " executed on " << worker_count
+        << " workers\n";
+    out << "makespan           : " << ms(makespan) << " ms\n";
+    out << "work               : " << ms(work) << " ms\n";
+    out << "cpu time           : " << ms(cpu_time) << " ms";
+    if (work.count() > 0) out << " (" << 100.0 * ms(cpu_time) / ms(work) << "% of work)";
+    out << "\n";
+    out << "span               : " << ms(span) << " ms\n";
+    out << "parallelism        : " << parallelism() << "\n";
+    out << "speedup            : " << speedup() << "\n";
+    out << "queue wait         : " << ms(queue_wait) << " ms\n";
+    out << "scheduler overhead : " << ms(scheduler_overhead) << " ms\n";
+    if (perf_counters)
+    {
+        out << "perf counters      : ";
+        if (counters.valid)
+            write_counts(out, counters);
+        else
+            out << "unavailable";
+        out << "\n";
+    }
+    out << "critical path      :\n";
+
+    std::unordered_map<std::uint64_t, const NodeProfile*> by_uid;
+    for (const auto& node : nodes) by_uid[node.uid] = &node;
+    for (std::uint64_t uid : critical_path)
+    {
+        const NodeProfile& node = *by_uid[uid];
+        out << "  " << (node.label ? node.label : "#" + std::to_string(node.uid)) << " on worker " << node.worker
+            << ": wait " << ms(node.queue_wait()) << " ms, run " << ms(node.wall_time()) << " ms, cpu "
+            << ms(node.cpu_time) << " ms";
+        if (node.counters.valid)
+        {
+            out << ", ";
+            write_counts(out, node.counters);
+        }
+        out << "\n";
+    }
+}
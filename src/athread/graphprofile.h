@@ -0,0 +1,149 @@
+//////////////////////////////////////////////////////////////////////////
+// Copyright 2026 Le Xuan Tuan Anh
+//
+// https://github.com/z-pc/athread
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef GRAPH_PROFILE_H__
+#define GRAPH_PROFILE_H__
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include "perfcounters.h"
+#include "trace.h"
+
+namespace at
+{
+class INode;
+
+/**
+ * @struct NodeTiming
+ * @brief Raw timestamps of one node, written by the worker running it during a profiled run.
+ */
+struct NodeTiming
+{
+    std::uint64_t start{0};   // Trace clock, 0 if the node did not run.
+    std::uint64_t finish{0};  // Trace clock.
+    std::uint64_t cpu_time{0};  // CPU time of the worker thread at begin(), then used by the node.
+    std::uint32_t worker{0};
+    bool count_events{false};       // Read the perf counters too, see `ThreadGraph::set_perf_counters()`.
+    PerfCounters* source{nullptr};  // Counters read by begin().
+    PerfCounts counters;            // Values at begin(), then the difference at end().
+    std::thread::id thread;         // Thread that called begin().
+
+    void begin(std::uint32_t worker_id)
+    {
+        worker = worker_id;
+        thread = std::this_thread::get_id();
+        if (count_events)
+        {
+            source = &PerfCounters::thread();
+            counters = source->read();
+        }
+        cpu_time = Trace::thread_cpu_time();
+        start = Trace::now();
+    }
+    void end()
+    {
+        finish = Trace::now();
+        // An async node completes on another thread, whose clocks and counters say nothing about the node.
+        bool same_thread = thread == std::this_thread::get_id();
+        cpu_time = same_thread ? Trace::thread_cpu_time() - cpu_time : 0;
+        if (source) counters = same_thread ? source->read() - counters : PerfCounts();
+        source = nullptr;
+    }
+};
+
+/**
+ * @struct NodeProfile
+ * @brief Measurements of one node. Times are relative to the call to `ThreadGraph::start()`.
+ *
+ * A node is ready when its last predecessor completes, or at the start of the run when it has none.
+ */
+struct NodeProfile
+{
+    std::uint64_t uid;     // `IRunnable::uid()` of the node.
+    const char* label;     // `IRunnable::label()` of the node, may be nullptr.
+    std::uint32_t worker;  // Id of the worker that ran the node.
+    bool executed;         // False if the run stopped before the node was started.
+    std::chrono::nanoseconds ready;
+    std::chrono::nanoseconds start;
+    std::chrono::nanoseconds end;
+    std::chrono::nanoseconds cpu_time;  // CPU time of the worker while the node ran, 0 for async nodes.
+    PerfCounts counters;  // Events counted while the node ran, none unless perf counters were enabled.
+
+    std::chrono::nanoseconds wall_time() const { return end - start; }
+
+    /**
+     * @brief Wall time not spent on the CPU: blocked on I/O, on a lock, sleeping or preempted.
+     */
+    std::chrono::nanoseconds off_cpu_time() const
+    {
+        return std::max(wall_time() - cpu_time, std::chrono::nanoseconds(0));
+    }
+    std::chrono::nanoseconds queue_wait() const { return start - ready; }
+};
+
+/**
+ * @class GraphProfile
+ * @brief Report of a profiled `ThreadGraph` run, see `ThreadGraph::set_profiling()`.
+ *
+ * - `work`: the sum of the wall times of the nodes, the time one worker would need.
+ * - `span`: the length of the critical path, the longest chain of dependent nodes weighted by their wall
+ *   times, the time infinitely many workers would need.
+ * - `parallelism()`: work / span, the speedup the shape of the graph allows.
+ * - `speedup()`: work / makespan, the speedup the run achieved.
+ * - `scheduler_overhead`: time the nodes of the critical path spent ready but not started. It is the part of
+ *   the makespan spent neither executing the critical path nor waiting on a lack of workers.
+ */
+class GraphProfile
+{
+public:
+    std::vector<NodeProfile> nodes;            // In the order of the graph's tasks.
+    std::vector<std::uint64_t> critical_path;  // Uids of the nodes of the critical path, first to last.
+    std::chrono::nanoseconds makespan{0};      // From start() to the end of the last node.
+    std::chrono::nanoseconds work{0};
+    std::chrono::nanoseconds span{0};
+    std::chrono::nanoseconds queue_wait{0};  // Sum of the queue waits of all nodes.
+    std::chrono::nanoseconds cpu_time{0};    // Sum of the CPU times of all nodes.
+    std::chrono::nanoseconds scheduler_overhead{0};
+    std::uint32_t worker_count{0};
+    bool perf_counters{false};  // Whether the run read the perf counters.
+    PerfCounts counters;        // Sum over the nodes.
+
+    double parallelism() const;
+    double speedup() const;
+
+    /**
+     * @brief Writes a human readable summary followed by the critical path.
+     */
+    void write_report(std::ostream& out) const;
+
+    /**
+     * @brief Builds the report of a run from the timings recorded for `tasks`.
+     * @param origin Trace clock at the start of the run.
+     */
+    static GraphProfile build(const std::vector<INode*>& tasks, const std::vector<NodeTiming>& timings,
+                              std::uint64_t origin, std::uint32_t worker_count);
+};
+
+}  // namespace at
+
+#endif  // GRAPH_PROFILE_H__
@@ -0,0 +1,341 @@
+#include "graphsnapshot.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+#include "diagnostics.h"
+
+using namespace at;
+
+namespace
+{
+constexpr char snapshot_magic[8] = {'A', 'T', 'G', 'R', 'A', 'P', 'H', '\0'};
+
+struct Header
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t width;
+    std::uint64_t node_count;
+    std::uint64_t edge_count;
+    std::uint64_t label_bytes;
+    std::uint64_t reserved;
+};
+static_assert(sizeof(Header) % 8 == 0, "Sections after the header must stay 8-byte aligned.");
+
+std::uint64_t align8(std::uint64_t offset) { return (offset + 7) & ~std::uint64_t(7); }
+
+// Offsets of the sections of a snapshot, see GraphSnapshot.
+struct Layout
+{
+    std::uint64_t predecessor_offsets;
+    std::uint64_t predecessor_ids;
+    std::uint64_t successor_offsets;
+    std::uint64_t successor_ids;
+    std::uint64_t costs;
+    std::uint64_t label_offsets;
+    std::uint64_t labels;
+    std::uint64_t size;
+
+    Layout(std::uint64_t nodes, std::uint64_t edges, std::uint64_t label_bytes)
+    {
+        predecessor_offsets = sizeof(Header);
+        predecessor_ids = predecessor_offsets + 8 * (nodes + 1);
+        successor_offsets = align8(predecessor_ids + 4 * edges);
+        successor_ids = successor_offsets + 8 * (nodes + 1);
+        costs = align8(successor_ids + 4 * edges);
+        label_offsets = costs + 8 * nodes;
+        labels = label_offsets + 8 * (nodes + 1);
+        size = labels + label_bytes;
+    }
+};
+
+// Offsets start at 0, never decrease and end at `total`.
+bool valid_offsets(const std::uint64_t* offsets, std::uint64_t count, std::uint64_t total)
+{
+    if (offsets[0] != 0 || offsets[count] != total) return false;
+    for (std::uint64_t i = 0; i < count; i++)
+        if (offsets[i] > offsets[i + 1]) return false;
+    return true;
+}
+
+bool valid_ids(const std::uint32_t* ids, std::uint64_t count, std::uint64_t nodes)
+{
+    return std::all_of(ids, ids + count, [nodes](std::uint32_t id) { return id < nodes; });
+}
+
+// Successors of each node are, in any order, the nodes listing it as a predecessor.
+bool transposed(const std::uint64_t* predecessor_offsets, const std::uint32_t* predecessor_ids,
+                const std::uint64_t* successor_offsets, const std::uint32_t* successor_ids, std::uint64_t nodes)
+{
+    std::vector<std::uint64_t> cursor(successor_offsets, successor_offsets + nodes);
+    std::vector<std::uint32_t> expected(successor_offsets[nodes]);
+    for (std::uint64_t node = 0; node < nodes; node++)
+    {
+        for (std::uint64_t i = predecessor_offsets[node]; i < predecessor_offsets[node + 1]; i++)
+        {
+            std::uint32_t predecessor = predecessor_ids[i];
+            if (cursor[predecessor] == successor_offsets[predecessor + 1]) return false;
+            expected[cursor[predecessor]++] = static_cast<std::uint32_t>(node);
+        }
+    }
+
+    // Filled in node order, so each slice of `expected` is sorted.
+    std::vector<std::uint32_t> actual;
+    for (std::uint64_t node = 0; node < nodes; node++)
+    {
+        actual.assign(successor_ids + successor_offsets[node], successor_ids + successor_offsets[node + 1]);
+        std::sort(actual.begin(), actual.end());
+        if (!std::equal(actual.begin(), actual.end(), expected.begin() + successor_offsets[node])) return false;
+    }
+    return true;
+}
+
+// Kahn's algorithm: every node is released once all its predecessors are.
+bool acyclic(const std::uint64_t* predecessor_offsets, const std::uint64_t* successor_offsets,
+             const std::uint32_t* successor_ids, std::uint64_t nodes)
+{
+    std::vector<std::uint64_t> pending(nodes);
+    std::vector<std::uint32_t> ready;
+    for (std::uint64_t node = 0; node < nodes; node++)
+    {
+        pending[node] = predecessor_offsets[node + 1] - predecessor_offsets[node];
+        if (pending[node] == 0) ready.push_back(static_cast<std::uint32_t>(node));
+    }
+
+    std::uint64_t released = 0;
+    while (!ready.empty())
+    {
+        std::uint32_t node = ready.back();
+        ready.pop_back();
+        released++;
+        for (std::uint64_t i = successor_offsets[node]; i < successor_offsets[node + 1]; i++)
+            if (--pending[successor_ids[i]] == 0) ready.push_back(successor_ids[i]);
+    }
+    return released == nodes;
+}
+
+void write_section(std::ofstream& out, const void* data, std::size_t bytes)
+{
+    static const char padding[8] = {};
+    out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+    out.write(padding, static_cast<std::streamsize>(align8(bytes) - bytes));
+}
+}  // namespace
+
+void GraphSnapshot::open(const std::string& path)
+{
+    close();
+    _file.open(path);
+
+    Header header{};
+    if (_file.size() >= sizeof(Header)) std::memcpy(&header, _file.data(), sizeof(Header));
+    if (std::memcmp(header.magic, snapshot_magic, sizeof(snapshot_magic)) != 0)
+    {
+        close();
+        AT_RUNTIME_ERROR(path << " is not a graph snapshot.");
+    }
+    if (header.version != format_version)
+    {
+        close();
+        AT_RUNTIME_ERROR(path << " has snapshot version " << header.version << ", expected " << format_version << ".");
+    }
+
+    // Bounded by the file size first, so that the layout cannot overflow.
+    const std::uint64_t size = _file.size();
+    if (header.node_count > size / 8 || header.edge_count > size / 4 || header.label_bytes > size ||
+        Layout(header.node_count, header.edge_count, header.label_bytes).size != size)
+    {
+        close();
+        AT_RUNTIME_ERROR(path << " is truncated or its counts are corrupted.");
+    }
+
+    Layout layout(header.node_count, header.edge_count, header.label_bytes);
+    const char* data = _file.data();
+    _node_count = header.node_count;
+    _edge_count = header.edge_count;
+    _width = header.width;
+    _predecessor_offsets = reinterpret_cast<const std::uint64_t*>(data + layout.predecessor_offsets);
+    _predecessor_ids = reinterpret_cast<const std::uint32_t*>(data + layout.predecessor_ids);
+    _successor_offsets = reinterpret_cast<const std::uint64_t*>(data + layout.successor_offsets);
+    _successor_ids = reinterpret_cast<const std::uint32_t*>(data + layout.successor_ids);
+    _costs = reinterpret_cast<const std::uint64_t*>(data + layout.costs);
+    _label_offsets = reinterpret_cast<const std::uint64_t*>(data + layout.label_offsets);
+    _labels = data + layout.labels;
+
+    if (!valid_offsets(_predecessor_offsets, _node_count, _edge_count) ||
+        !valid_offsets(_successor_offsets, _node_count, _edge_count) ||
+        !valid_offsets(_label_offsets, _node_count, header.label_bytes) ||
+        !valid_ids(_predecessor_ids, _edge_count, _node_count) || !valid_ids(_successor_ids, _edge_count, _node_count))
+    {
+        close();
+        AT_RUNTIME_ERROR(path << " has corrupted edges or labels.");
+    }
+
+    // Restored edges go straight into the nodes, a mismatch or a cycle would leave start() waiting forever.
+    if (!transposed(_predecessor_offsets, _predecessor_ids, _successor_offsets, _successor_ids, _node_count) ||
+        !acyclic(_predecessor_offsets, _successor_offsets, _successor_ids, _node_count))
+    {
+        close();
+        AT_RUNTIME_ERROR(path << " has edges that do not form a valid graph.");
+    }
+}
+
+void GraphSnapshot::close()
+{
+    _file.close();
+    _node_count = 0;
+    _edge_count = 0;
+    _width = 0;
+    _predecessor_offsets = nullptr;
+    _predecessor_ids = nullptr;
+    _successor_offsets = nullptr;
+    _successor_ids = nullptr;
+    _costs = nullptr;
+    _label_offsets = nullptr;
+    _labels = nullptr;
+}
+
+GraphSnapshot::Ids GraphSnapshot::predecessors(std::uint32_t id) const
+{
+    return Ids{_predecessor_ids + _predecessor_offsets[id], _predecessor_ids + _predecessor_offsets[id + 1]};
+}
+
+GraphSnapshot::Ids GraphSnapshot::successors(std::uint32_t id) const
+{
+    return Ids{_successor_ids + _successor_offsets[id], _successor_ids + _successor_offsets[id + 1]};
+}
+
+std::string_view GraphSnapshot::label(std::uint32_t id) const
+{
+    return std::string_view(_labels + _label_offsets[id], _label_offsets[id + 1] - _label_offsets[id]);
+}
+
+std::chrono::nanoseconds GraphSnapshot::cost(std::uint32_t id) const
+{
+    return std::chrono::nanoseconds(static_cast<std::int64_t>(_costs[id]));
+}
+
+std::size_t GraphSnapshot::begin_restore(const ThreadGraph& graph) const
+{
+    if (!is_open()) AT_RUNTIME_ERROR("No graph snapshot is open.");
+    if (graph.executing()) AT_RUNTIME_ERROR("Cannot restore a snapshot into a graph while it is executing.");
+    return graph._task_pool.size();
+}
+
+std::vector<Task> GraphSnapshot::end_restore(ThreadGraph& graph, std::size_t first) const
+{
+    INode* const* nodes = graph._task_pool.data() + first;
+    std::vector<Task> tasks;
+    tasks.reserve(_node_count);
+    for (std::uint32_t id = 0; id < _node_count; id++)
+    {
+        INode* node = nodes[id];
+        Ids predecessor_ids = predecessors(id);
+        node->_predecessors.reserve(node->_predecessors.size() + predecessor_ids.size());
+        for (std::uint32_t predecessor : predecessor_ids) node->_predecessors.push_back(nodes[predecessor]);
+        Ids successor_ids = successors(id);
+        node->_successors.reserve(node->_successors.size() + successor_ids.size());
+        for (std::uint32_t successor : successor_ids) node->_successors.push_back(nodes[successor]);
+
+        if (!node->label()) node->set_label(label(id));
+        tasks.push_back(graph.task_at(first + id));
+    }
+
+    graph.topology_changed();
+    if (first == 0)
+    {
+        // The graph is the saved one, its width is known.
+        graph._width = _width;
+        graph._width_version = graph._shape_version;
+    }
+    return tasks;
+}
+
+void GraphSnapshot::save(const ThreadGraph& graph, const std::string& path,
+                         const std::vector<std::chrono::nanoseconds>& costs /*= {}*/)
+{
+    const std::vector<INode*>& nodes = graph._task_pool;
+    const std::size_t count = nodes.size();
+    if (count >= UINT32_MAX) AT_INVALID_ARGUMENT("Graph has too many nodes for a snapshot.");
+    if (!costs.empty() && costs.size() != count) AT_INVALID_ARGUMENT("Costs must be empty or one per node.");
+
+    std::unordered_map<const INode*, std::uint32_t> index_of;
+    index_of.reserve(count);
+    for (std::size_t i = 0; i < count; i++) index_of[nodes[i]] = static_cast<std::uint32_t>(i);
+
+    std::vector<std::uint64_t> predecessor_offsets(count + 1, 0);
+    std::vector<std::uint64_t> successor_offsets(count + 1, 0);
+    std::vector<std::uint32_t> predecessor_ids;
+    std::vector<std::uint32_t> successor_ids;
+    auto append = [&index_of](const std::vector<INode*>& linked, std::vector<std::uint32_t>& ids)
+    {
+        for (const INode* node : linked)
+        {
+            auto it = index_of.find(node);
+            if (it != index_of.end()) ids.push_back(it->second);
+        }
+        return static_cast<std::uint64_t>(ids.size());
+    };
+    for (std::size_t i = 0; i < count; i++)
+    {
+        predecessor_offsets[i + 1] = append(nodes[i]->_predecessors, predecessor_ids);
+        successor_offsets[i + 1] = append(nodes[i]->_successors, successor_ids);
+    }
+    if (predecessor_ids.size() != successor_ids.size())
+        AT_RUNTIME_ERROR("The predecessor and successor lists of the graph do not match.");
+
+    const GraphProfile& profile = graph.profile();
+    const bool profiled = profile.nodes.size() == count;
+    std::vector<std::uint64_t> cost_hints(count, 0);
+    for (std::size_t i = 0; i < count; i++)
+    {
+        std::chrono::nanoseconds cost(0);
+        if (!costs.empty())
+            cost = costs[i];
+        else if (profiled && profile.nodes[i].executed && profile.nodes[i].uid == nodes[i]->uid())
+            cost = profile.nodes[i].wall_time();
+        cost_hints[i] = static_cast<std::uint64_t>(std::max(cost.count(), std::int64_t(0)));
+    }
+
+    std::vector<std::uint64_t> label_offsets(count + 1, 0);
+    std::string labels;
+    for (std::size_t i = 0; i < count; i++)
+    {
+        if (const char* label = nodes[i]->label()) labels += label;
+        label_offsets[i + 1] = labels.size();
+    }
+
+    Header header{};
+    std::memcpy(header.magic, snapshot_magic, sizeof(snapshot_magic));
+    header.version = format_version;
+    header.width = graph.width();
+    header.node_count = count;
+    header.edge_count = predecessor_ids.size();
+    header.label_bytes = labels.size();
+
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        write_section(out, &header, sizeof(header));
+        write_section(out, predecessor_offsets.data(), predecessor_offsets.size() * sizeof(std::uint64_t));
+        write_section(out, predecessor_ids.data(), predecessor_ids.size() * sizeof(std::uint32_t));
+        write_section(out, successor_offsets.data(), successor_offsets.size() * sizeof(std::uint64_t));
+        write_section(out, successor_ids.data(), successor_ids.size() * sizeof(std::uint32_t));
+        write_section(out, cost_hints.data(), cost_hints.size() * sizeof(std::uint64_t));
+        write_section(out, label_offsets.data(), label_offsets.size() * sizeof(std::uint64_t));
+        out.write(labels.data(), static_cast<std::streamsize>(labels.size()));
+        out.close();
+        if (!out) AT_RUNTIME_ERROR("Failed to write " << temporary << ".");
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        int error = errno;
+        std::remove(temporary.c_str());
+        AT_RUNTIME_ERROR("Failed to rename " << temporary << " to " << path << ": " << std::strerror(error));
+    }
+}
@@ -0,0 +1,167 @@
+//////////////////////////////////////////////////////////////////////////
+// Copyright 2026 Le Xuan Tuan Anh
+//
+// https://github.com/z-pc/athread
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef GRAPH_SNAPSHOT_H__
+#define GRAPH_SNAPSHOT_H__
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "mappedfile.h"
+#include "noncopyable.h"
+#include "threadgraph.h"
+
+namespace at
+{
+
+/**
+ * @class GraphSnapshot
+ * @brief The topology of a `ThreadGraph` in a binary file that is read in place through a memory mapping.
+ *
+ * A snapshot holds, for each node, its id (its position in the graph), label and cost hint, and the edges in
+ * compressed sparse row form, predecessors and successors in their order in the graph. `restore()` pushes one
+ * node per id and copies the edges from the mapping, without the checks and duplicate scans of
+ * `Task::depend()`, so a large graph is rebuilt in a single pass.
+ *
+ * The file is written for the byte order and layout of the machine that saved it:
+ *
+ *     header    magic "ATGRAPH", version, node and edge counts, label bytes, width
+ *     uint64    predecessor offsets [nodes + 1], then uint32 predecessor ids [edges]
+ *     uint64    successor offsets [nodes + 1], then uint32 successor ids [edges]
+ *     uint64    cost hints in nanoseconds [nodes]
+ *     uint64    label offsets [nodes + 1], then the label characters
+ *
+ * Every section starts on an 8-byte boundary.
+ */
+class GraphSnapshot : public at::noncopyable_::noncopyable
+{
+public:
+    static constexpr std::uint32_t format_version = 1;
+
+    /**
+     * @struct Ids
+     * @brief The ids of the predecessors or successors of a node, a view into the mapping.
+     */
+    struct Ids
+    {
+        const std::uint32_t* first;
+        const std::uint32_t* last;
+
+        const std::uint32_t* begin() const { return first; }
+        const std::uint32_t* end() const { return last; }
+        std::size_t size() const { return static_cast<std::size_t>(last - first); }
+    };
+
+    GraphSnapshot() {}
+
+    /**
+     * @brief Maps and checks the snapshot at `path`.
+     * @throws std::runtime_error if the file cannot be mapped or is not a valid snapshot.
+     */
+    explicit GraphSnapshot(const std::string& path) { open(path); }
+
+    /**
+     * @brief Maps the snapshot at `path` and checks it, replacing the current one.
+     *
+     * Beyond the header, offsets and ids, the successors must mirror the predecessors and the edges must not
+     * form a cycle, so a restored graph always runs to completion.
+     * @throws std::runtime_error if the file cannot be mapped or is not a valid snapshot.
+     */
+    void open(const std::string& path);
+    void close();
+    bool is_open() const { return _file.is_open(); }
+
+    std::size_t node_count() const { return static_cast<std::size_t>(_node_count); }
+    std::size_t edge_count() const { return static_cast<std::size_t>(_edge_count); }
+
+    /**
+     * @brief Returns the `ThreadGraph::width()` of the saved graph.
+     */
+    std::uint32_t width() const { return _width; }
+
+    Ids predecessors(std::uint32_t id) const;
+    Ids successors(std::uint32_t id) const;
+    std::string_view label(std::uint32_t id) const;
+    std::chrono::nanoseconds cost(std::uint32_t id) const;
+
+    /**
+     * @brief Pushes one node per id into `graph`, in the order of the ids, and wires the saved edges.
+     *
+     * `bind(id, label)` is called once per node and returns either an `INode*`, whose ownership goes to the
+     * graph, or a callable pushed as by `ThreadGraph::push()`. Saved labels are set on nodes without one.
+     * When `graph` was empty, it also keeps the saved width, so its first start() does not compute it.
+     * If `bind` throws, the nodes pushed so far stay in the graph without their edges.
+     *
+     * @return The tasks of the nodes, indexed by id.
+     * @throws std::runtime_error if no snapshot is open or the graph is executing.
+     */
+    template <class Bind>
+    std::vector<Task> restore(ThreadGraph& graph, Bind&& bind) const;
+
+    /**
+     * @brief Writes the topology of `graph` to `path`, through a temporary file renamed on success.
+     *
+     * Edges to nodes of other graphs are left out. The cost hints are `costs` when given, one per node in the
+     * order of the graph, otherwise the wall times of the last profiled run when it covered the node, else 0.
+     *
+     * @throws std::invalid_argument if `costs` is neither empty nor of the size of the graph.
+     * @throws std::runtime_error if the file cannot be written.
+     */
+    static void save(const ThreadGraph& graph, const std::string& path,
+                     const std::vector<std::chrono::nanoseconds>& costs = {});
+
+private:
+    std::size_t begin_restore(const ThreadGraph& graph) const;
+    std::vector<Task> end_restore(ThreadGraph& graph, std::size_t first) const;
+
+    MappedFile _file;
+    std::uint64_t _node_count{0};
+    std::uint64_t _edge_count{0};
+    std::uint32_t _width{0};
+    const std::uint64_t* _predecessor_offsets{nullptr};
+    const std::uint32_t* _predecessor_ids{nullptr};
+    const std::uint64_t* _successor_offsets{nullptr};
+    const std::uint32_t* _successor_ids{nullptr};
+    const std::uint64_t* _costs{nullptr};
+    const std::uint64_t* _label_offsets{nullptr};
+    const char* _labels{nullptr};
+};
+
+template <class Bind>
+std::vector<Task> GraphSnapshot::restore(ThreadGraph& graph, Bind&& bind) const
+{
+    const std::size_t first = begin_restore(graph);
+    for (std::uint32_t id = 0; id < _node_count; id++)
+    {
+        auto node = bind(id, label(id));
+        if constexpr (std::is_convertible_v<decltype(node), INode*>)
+            graph.push(static_cast<INode*>(node));
+        else
+            graph.push(std::move(node));
+    }
+    return end_restore(graph, first);
+}
+
+}  // namespace at
+
+#endif  // GRAPH_SNAPSHOT_H__
@@ -0,0 +1,560 @@
+#include "io.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "diagnostics.h"
+#include "log.h"
+#include "threadpool.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define AT_HAS_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+using namespace at;
+
+namespace at
+{
+
+enum class IoOp
+{
+    Read,
+    Write
+};
+
+/**
+ * @class IIoEngine
+ * @brief Backend performing the requests of an `IoContext`.
+ */
+class IIoEngine
+{
+public:
+    virtual ~IIoEngine() {}
+
+    virtual void submit(IoOp op, int fd, void* buffer, std::size_t size, std::uint64_t offset,
+                        IoCallback callback) = 0;
+};
+
+}  // namespace at
+
+namespace
+{
+
+// Linux never transfers more than this in a single read/write call.
+constexpr std::size_t max_transfer_size = 0x7ffff000;
+
+long blocking_transfer(IoOp op, int fd, void* buffer, std::size_t size, std::uint64_t offset)
+{
+#ifndef _WIN32
+    ssize_t result = op == IoOp::Read ? ::pread(fd, buffer, size, static_cast<off_t>(offset))
+                                      : ::pwrite(fd, buffer, size, static_cast<off_t>(offset));
+    return result < 0 ? -errno : static_cast<long>(result);
+#else
+    (void)op, (void)fd, (void)buffer, (void)size, (void)offset;
+    return -ENOSYS;
+#endif
+}
+
+/**
+ * Fallback engine: every request is a blocking call on a small thread pool.
+ */
+class ThreadIoEngine : public IIoEngine
+{
+public:
+    explicit ThreadIoEngine(std::uint32_t threads) : _pool(threads, threads) {}
+
+    ~ThreadIoEngine() { _pool.terminate(true); }
+
+    void submit(IoOp op, int fd, void* buffer, std::size_t size, std::uint64_t offset, IoCallback callback) override
+    {
+        bool pushed = _pool.push(
+            [op, fd, buffer, size, offset, callback]()
+            { callback(blocking_transfer(op, fd, buffer, std::min(size, max_transfer_size), offset)); });
+        if (!pushed) AT_RUNTIME_ERROR("I/O thread pool is not accepting requests.");
+    }
+
+private:
+    at::ThreadPool _pool;
+};
+
+#ifdef AT_HAS_IO_URING
+
+int sys_io_uring_setup(unsigned entries, io_uring_params* params)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+// Submissions left to fail and their errno, see IoContext::fail_uring_submissions().
+std::atomic<std::uint32_t> injected_failures{0};
+std::atomic<int> injected_error{0};
+
+int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    if (to_submit != 0 && injected_failures.load(std::memory_order_relaxed) != 0)
+    {
+        injected_failures.fetch_sub(1, std::memory_order_relaxed);
+        errno = injected_error.load(std::memory_order_relaxed);
+        return -1;
+    }
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+int sys_io_uring_register(int fd, unsigned opcode, void* arg, unsigned nr_args)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+bool probe_uring_ops(int ring_fd)
+{
+    constexpr unsigned probe_ops = 256;
+    std::unique_ptr<char[]> storage(new char[sizeof(io_uring_probe) + probe_ops * sizeof(io_uring_probe_op)]());
+    auto probe = reinterpret_cast<io_uring_probe*>(storage.get());
+
+    if (sys_io_uring_register(ring_fd, IORING_REGISTER_PROBE, probe, probe_ops) < 0) return false;
+
+    for (unsigned op : {unsigned(IORING_OP_NOP), unsigned(IORING_OP_READ), unsigned(IORING_OP_WRITE)})
+    {
+        if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) return false;
+    }
+    return true;
+}
+
+/**
+ * io_uring engine: requests are pushed to the submission ring by the caller, completions are
+ * reaped by a dedicated ring thread.
+ */
+class UringIoEngine : public IIoEngine
+{
+public:
+    explicit UringIoEngine(std::uint32_t entries)
+    {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+
+        _ring_fd = sys_io_uring_setup(entries, &params);
+        if (_ring_fd < 0) AT_RUNTIME_ERROR("io_uring_setup failed: " << std::strerror(errno));
+
+        if (!probe_uring_ops(_ring_fd))
+        {
+            ::close(_ring_fd);
+            AT_RUNTIME_ERROR("io_uring does not support read/write operations on this kernel.");
+        }
+
+        _sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        _cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap) _sq_size = _cq_size = std::max(_sq_size, _cq_size);
+
+        _sq_ptr = ::mmap(nullptr, _sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring_fd,
+                         IORING_OFF_SQ_RING);
+        _cq_ptr = single_mmap ? _sq_ptr
+                              : ::mmap(nullptr, _cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                       _ring_fd, IORING_OFF_CQ_RING);
+        _sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = ::mmap(nullptr, _sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring_fd,
+                            IORING_OFF_SQES);
+
+        if (_sq_ptr == MAP_FAILED || _cq_ptr == MAP_FAILED || sqes == MAP_FAILED)
+        {
+            int error = errno;
+            unmap();
+            if (sqes != MAP_FAILED) ::munmap(sqes, _sqes_size);
+            ::close(_ring_fd);
+            AT_RUNTIME_ERROR("io_uring mmap failed: " << std::strerror(error));
+        }
+
+        auto sq = static_cast<char*>(_sq_ptr);
+        auto cq = static_cast<char*>(_cq_ptr);
+        _sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        _sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        _sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        _sqes = static_cast<io_uring_sqe*>(sqes);
+        _cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        _cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        _cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        _cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        _ring_thread = std::thread(&UringIoEngine::reap_completions, this);
+    }
+
+    ~UringIoEngine()
+    {
+        // A NOP without user data tells the ring thread to exit, unless it already stopped on an error.
+        try
+        {
+            push_sqe(IORING_OP_NOP, -1, nullptr, 0, 0, 0);
+        }
+        catch (...)
+        {
+        }
+        if (_ring_thread.joinable()) _ring_thread.join();
+
+        ::munmap(_sqes, _sqes_size);
+        unmap();
+        ::close(_ring_fd);
+    }
+
+    void submit(IoOp op, int fd, void* buffer, std::size_t size, std::uint64_t offset, IoCallback callback) override
+    {
+        auto request = new IoCallback(std::move(callback));
+        try
+        {
+            push_sqe(op == IoOp::Read ? IORING_OP_READ : IORING_OP_WRITE, fd, buffer,
+                     static_cast<unsigned>(std::min(size, max_transfer_size)), offset,
+                     reinterpret_cast<std::uint64_t>(request));
+        }
+        catch (...)
+        {
+            delete request;  // Never reached the kernel, see push_sqe().
+            throw;
+        }
+    }
+
+private:
+    void push_sqe(std::uint8_t opcode, int fd, void* buffer, unsigned size, std::uint64_t offset,
+                  std::uint64_t user_data)
+    {
+        std::lock_guard<std::mutex> lk{_submit_mutex};
+        if (_ring_error != 0) AT_RUNTIME_ERROR("io_uring ring thread stopped: " << std::strerror(_ring_error));
+
+        // The owning IoContext bounds in-flight requests to the ring size, a free entry is always there.
+        unsigned tail = *_sq_tail;
+        unsigned index = tail & _sq_mask;
+        io_uring_sqe* sqe = &_sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = opcode;
+        sqe->fd = fd;
+        sqe->addr = reinterpret_cast<std::uint64_t>(buffer);
+        sqe->len = size;
+        sqe->off = offset;
+        sqe->user_data = user_data;
+        _sq_array[index] = index;
+        __atomic_store_n(_sq_tail, tail + 1, __ATOMIC_RELEASE);
+        if (user_data != 0) _pending.insert(reinterpret_cast<IoCallback*>(user_data));
+
+        while (sys_io_uring_enter(_ring_fd, 1, 0, 0) < 0)
+        {
+            int error = errno;
+            if (error != EINTR && error != EAGAIN && error != EBUSY)
+            {
+                // The kernel consumed nothing: take the entry back, so a later enter does not submit a request
+                // whose callback the caller is about to free.
+                __atomic_store_n(_sq_tail, tail, __ATOMIC_RELEASE);
+                if (user_data != 0) _pending.erase(reinterpret_cast<IoCallback*>(user_data));
+                AT_RUNTIME_ERROR("io_uring_enter failed: " << std::strerror(error));
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    void reap_completions()
+    {
+        bool stop = false;
+        while (!stop)
+        {
+            int error = sys_io_uring_enter(_ring_fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 ? errno : 0;
+            if (error == EAGAIN || error == EBUSY)
+            {
+                // Short of resources or the completion ring is full: reap what is there and try again.
+                std::this_thread::yield();
+            }
+            else if (error != 0 && error != EINTR)
+            {
+                reap_ready();
+                fail_pending(error);
+                return;
+            }
+            stop = reap_ready();
+        }
+    }
+
+    // Runs the callbacks of the completions in the ring, returns true once the exit NOP is seen.
+    bool reap_ready()
+    {
+        bool stop = false;
+        unsigned head = *_cq_head;
+        unsigned tail = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE);
+        if (head == tail) return false;
+
+        std::vector<std::pair<IoCallback*, long>> completed;
+        for (; head != tail; ++head)
+        {
+            const io_uring_cqe& cqe = _cqes[head & _cq_mask];
+            if (cqe.user_data == 0)
+                stop = true;
+            else
+                completed.emplace_back(reinterpret_cast<IoCallback*>(cqe.user_data), cqe.res);
+        }
+        __atomic_store_n(_cq_head, head, __ATOMIC_RELEASE);
+
+        {
+            std::lock_guard<std::mutex> lk{_submit_mutex};
+            for (const auto& completion : completed) _pending.erase(completion.first);
+        }
+        for (const auto& completion : completed)
+        {
+            std::unique_ptr<IoCallback> request(completion.first);
+            (*request)(completion.second);
+        }
+        return stop;
+    }
+
+    // The ring thread cannot go on: requests still in the ring complete with the error, later ones are refused.
+    void fail_pending(int error)
+    {
+        AT_LOG_WARN("io_uring_enter failed with errno {}, failing the pending requests", error);
+        std::unordered_set<IoCallback*> pending;
+        {
+            std::lock_guard<std::mutex> lk{_submit_mutex};
+            _ring_error = error;
+            pending.swap(_pending);
+        }
+        for (IoCallback* callback : pending)
+        {
+            std::unique_ptr<IoCallback> request(callback);
+            (*request)(-error);
+        }
+    }
+
+    void unmap()
+    {
+        if (_cq_ptr != MAP_FAILED && _cq_ptr != _sq_ptr) ::munmap(_cq_ptr, _cq_size);
+        if (_sq_ptr != MAP_FAILED) ::munmap(_sq_ptr, _sq_size);
+    }
+
+    int _ring_fd{-1};
+    void* _sq_ptr{MAP_FAILED};
+    void* _cq_ptr{MAP_FAILED};
+    std::size_t _sq_size{0};
+    std::size_t _cq_size{0};
+    std::size_t _sqes_size{0};
+    unsigned* _sq_tail{nullptr};
+    unsigned _sq_mask{0};
+    unsigned* _sq_array{nullptr};
+    io_uring_sqe* _sqes{nullptr};
+    unsigned* _cq_head{nullptr};
+    unsigned* _cq_tail{nullptr};
+    unsigned _cq_mask{0};
+    io_uring_cqe* _cqes{nullptr};
+    std::mutex _submit_mutex;
+    std::unordered_set<IoCallback*> _pending;  // Submitted requests without a completion, under the submit lock.
+    int _ring_error{0};                        // errno that stopped the ring thread, under the submit lock.
+    std::thread _ring_thread;
+};
+
+#endif  // AT_HAS_IO_URING
+
+void invoke_callback(const IoCallback& callback, long result)
+{
+    // There is nobody to propagate an exception to on the completion thread.
+    try
+    {
+        callback(result);
+    }
+    catch (...)
+    {
+        AT_LOG_WARN("I/O completion callback threw an exception");
+    }
+}
+
+std::exception_ptr make_io_error(long result, const char* what)
+{
+    return std::make_exception_ptr(std::system_error(static_cast<int>(-result), std::generic_category(), what));
+}
+
+}  // namespace
+
+IoContext::IoContext(std::uint32_t queue_depth, IoBackend backend, std::uint32_t fallback_threads)
+{
+    if (queue_depth == 0) AT_INVALID_ARGUMENT("Queue depth must be greater than zero.");
+    if (fallback_threads == 0) AT_INVALID_ARGUMENT("Fallback thread count must be greater than zero.");
+
+    _queue_depth = queue_depth;
+
+#ifdef AT_HAS_IO_URING
+    if (backend == IoBackend::Uring || (backend == IoBackend::Auto && uring_available()))
+    {
+        _engine.reset(new UringIoEngine(queue_depth));
+        _backend = IoBackend::Uring;
+        return;
+    }
+#else
+    if (backend == IoBackend::Uring) AT_RUNTIME_ERROR("io_uring is not supported on this platform.");
+#endif
+
+    _engine.reset(new ThreadIoEngine(fallback_threads));
+    _backend = IoBackend::Threads;
+}
+
+IoContext::~IoContext()
+{
+    {
+        std::unique_lock<std::mutex> lk{_slot_mutex};
+        _slot_condition.wait(lk, [this]() { return _in_flight == 0; });
+    }
+    _engine.reset();
+}
+
+void IoContext::fail_uring_submissions(int error, std::uint32_t count)
+{
+#ifdef AT_HAS_IO_URING
+    injected_error.store(error, std::memory_order_relaxed);
+    injected_failures.store(count, std::memory_order_relaxed);
+#else
+    (void)error, (void)count;
+#endif
+}
+
+bool IoContext::uring_available()
+{
+#ifdef AT_HAS_IO_URING
+    static const bool available = []()
+    {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        int fd = sys_io_uring_setup(2, &params);
+        if (fd < 0) return false;
+        bool supported = probe_uring_ops(fd);
+        ::close(fd);
+        return supported;
+    }();
+    return available;
+#else
+    return false;
+#endif
+}
+
+std::size_t IoContext::in_flight() const
+{
+    std::lock_guard<std::mutex> lk{_slot_mutex};
+    return _in_flight;
+}
+
+void IoContext::acquire_slot()
+{
+    std::unique_lock<std::mutex> lk{_slot_mutex};
+    _slot_condition.wait(lk, [this]() { return _in_flight < _queue_depth; });
+    ++_in_flight;
+}
+
+void IoContext::release_slot()
+{
+    {
+        std::lock_guard<std::mutex> lk{_slot_mutex};
+        --_in_flight;
+    }
+    _slot_condition.notify_all();
+}
+
+void IoContext::read(int fd, void* buffer, std::size_t size, std::uint64_t offset, IoCallback callback)
+{
+    acquire_slot();
+    try
+    {
+        _engine->submit(IoOp::Read, fd, buffer, size, offset,
+                        [this, callback](long result)
+                        {
+                            invoke_callback(callback, result);
+                            release_slot();
+                        });
+    }
+    catch (...)
+    {
+        release_slot();
+        throw;
+    }
+}
+
+void IoContext::write(int fd, const void* buffer, std::size_t size, std::uint64_t offset, IoCallback callback)
+{
+    acquire_slot();
+    try
+    {
+        _engine->submit(IoOp::Write, fd, const_cast<void*>(buffer), size, offset,
+                        [this, callback](long result)
+                        {
+                            invoke_callback(callback, result);
+                            release_slot();
+                        });
+    }
+    catch (...)
+    {
+        release_slot();
+        throw;
+    }
+}
+
+std::future<std::size_t> IoContext::read(int fd, void* buffer, std::size_t size, std::uint64_t offset)
+{
+    auto promise = std::make_shared<std::promise<std::size_t>>();
+    auto future = promise->get_future();
+    read(fd, buffer, size, offset,
+         [promise](long result)
+         {
+             if (result < 0)
+                 promise->set_exception(make_io_error(result, "read"));
+             else
+                 promise->set_value(static_cast<std::size_t>(result));
+         });
+    return future;
+}
+
+std::future<std::size_t> IoContext::write(int fd, const void* buffer, std::size_t size, std::uint64_t offset)
+{
+    auto promise = std::make_shared<std::promise<std::size_t>>();
+    auto future = promise->get_future();
+    write(fd, buffer, size, offset,
+          [promise](long result)
+          {
+              if (result < 0)
+                  promise->set_exception(make_io_error(result, "write"));
+              else
+                  promise->set_value(static_cast<std::size_t>(result));
+          });
+    return future;
+}
+
+void IoNode::finish(long result)
+{
+    _result = result;
+    try
+    {
+        if (_on_complete) _on_complete(result);
+    }
+    catch (...)
+    {
+        fail(std::current_exception());
+        return;
+    }
+
+    if (result < 0)
+        fail(make_io_error(result, "I/O node"));
+    else
+        complete();
+}
+
+void IoReadNode::execute()
+{
+    _io.read(_fd, _buffer, _size, _offset, [this](long result) { finish(result); });
+}
+
+void IoWriteNode::execute()
+{
+    _io.write(_fd, _buffer, _size, _offset, [this](long result) { finish(result); });
+}
@@ -0,0 +1,243 @@
+//////////////////////////////////////////////////////////////////////////
+// Copyright 2026 Le Xuan Tuan Anh
+//
+// https://github.com/z-pc/athread
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef IO_H__
+#define IO_H__
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+
+#include "node.h"
+#include "noncopyable.h"
+
+namespace at
+{
+
+class IIoEngine;
+
+/**
+ * @enum IoBackend
+ * @brief Selects how an `IoContext` performs its reads and writes.
+ *
+ * - `Auto`: io_uring when the kernel supports it, otherwise `Threads`.
+ * - `Uring`: io_uring only. The constructor throws if it is not available.
+ * - `Threads`: blocking `pread`/`pwrite` on a small internal `ThreadPool`.
+ */
+enum class IoBackend
+{
+    Auto,
+    Uring,
+    Threads
+};
+
+/**
+ * @brief Completion callback of an I/O request.
+ *
+ * The argument is the number of transferred bytes, or a negative `errno` value on failure.
+ * Callbacks run on the I/O completion thread and should be short.
+ */
+using IoCallback = std::function<void(long)>;
+
+/**
+ * @class IoContext
+ * @brief Asynchronous positional file I/O.
+ *
+ * Requests are submitted from any thread and completed on a dedicated completion thread, so many
+ * reads and writes can be in flight without dedicating a worker to each of them. On Linux the
+ * requests go through io_uring; when it is unavailable the context falls back to blocking calls
+ * on an internal `ThreadPool`.
+ *
+ * Completions are delivered to a callback, a `std::future`, or complete an `AsyncNode`
+ * (see `IoReadNode` and `IoWriteNode`).
+ *
+ * @note Buffers must stay valid until the request is completed. A short read or write is reported
+ *       as is, it is not retried.
+ * @note The destructor waits for all in-flight requests to complete.
+ */
+class IoContext : public at::noncopyable_::noncopyable
+{
+public:
+    /**
+     * @brief Constructs an I/O context.
+     *
+     * @param queue_depth Maximum number of requests in flight. Submitting beyond that blocks. Default is 256.
+     * @param backend The backend to use. Default is `IoBackend::Auto`.
+     * @param fallback_threads Number of threads used by the `Threads` backend. Default is 2.
+     */
+    explicit IoContext(std::uint32_t queue_depth = 256, IoBackend backend = IoBackend::Auto,
+                       std::uint32_t fallback_threads = 2);
+
+    /**
+     * @brief Destructor. Waits for all in-flight requests and stops the completion thread.
+     */
+    ~IoContext();
+
+    /**
+     * @brief Returns the backend actually in use, never `IoBackend::Auto`.
+     */
+    IoBackend backend() const { return _backend; }
+
+    /**
+     * @brief Returns the number of submitted requests that are not completed yet.
+     */
+    std::size_t in_flight() const;
+
+    /**
+     * @brief Reads up to `size` bytes from `fd` at `offset` into `buffer`.
+     *
+     * @param callback Invoked on the completion thread with the result of the read.
+     */
+    void read(int fd, void* buffer, std::size_t size, std::uint64_t offset, IoCallback callback);
+
+    /**
+     * @brief Writes up to `size` bytes from `buffer` to `fd` at `offset`.
+     *
+     * @param callback Invoked on the completion thread with the result of the write.
+     */
+    void write(int fd, const void* buffer, std::size_t size, std::uint64_t offset, IoCallback callback);
+
+    /**
+     * @brief Reads up to `size` bytes from `fd` at `offset` into `buffer`.
+     *
+     * @return A future holding the number of bytes read. It throws `std::system_error` on failure.
+     */
+    std::future<std::size_t> read(int fd, void* buffer, std::size_t size, std::uint64_t offset);
+
+    /**
+     * @brief Writes up to `size` bytes from `buffer` to `fd` at `offset`.
+     *
+     * @return A future holding the number of bytes written. It throws `std::system_error` on failure.
+     */
+    std::future<std::size_t> write(int fd, const void* buffer, std::size_t size, std::uint64_t offset);
+
+    /**
+     * @brief Checks whether io_uring can be used on this system.
+     */
+    static bool uring_available();
+
+    /**
+     * @brief Makes the next `count` submissions to io_uring fail with `error`, to test the error handling.
+     */
+    static void fail_uring_submissions(int error, std::uint32_t count);
+
+private:
+    void acquire_slot();
+    void release_slot();
+
+    IoBackend _backend;
+    std::uint32_t _queue_depth;
+    std::size_t _in_flight{0};
+    mutable std::mutex _slot_mutex;
+    std::condition_variable _slot_condition;
+    std::unique_ptr<IIoEngine> _engine;
+};
+
+/**
+ * @class IoNode
+ * @brief Base of the graph nodes that perform one asynchronous read or write.
+ *
+ * The node is completed when the I/O request is completed, without holding a worker in between.
+ * A failed request (negative result) fails the node and `ThreadGraph::wait()` throws.
+ */
+class IoNode : public AsyncNode
+{
+public:
+    /**
+     * @brief Returns the result of the last execution: transferred bytes or a negative `errno` value.
+     */
+    long result() const { return _result; }
+
+protected:
+    IoNode(IoContext& io, int fd, std::size_t size, std::uint64_t offset, IoCallback on_complete)
+        : _io(io), _fd(fd), _size(size), _offset(offset), _on_complete(std::move(on_complete))
+    {
+    }
+
+    void finish(long result);
+
+    IoContext& _io;
+    int _fd;
+    std::size_t _size;
+    std::uint64_t _offset;
+    IoCallback _on_complete;
+    long _result{0};
+};
+
+/**
+ * @class IoReadNode
+ * @brief Graph node that reads a file range into a buffer.
+ */
+class IoReadNode : public IoNode
+{
+public:
+    /**
+     * @param io The context that performs the read.
+     * @param fd Open file descriptor.
+     * @param buffer Destination buffer, at least `size` bytes.
+     * @param size Number of bytes to read.
+     * @param offset File offset to read from.
+     * @param on_complete Optional callback invoked with the result before the node is completed.
+     */
+    IoReadNode(IoContext& io, int fd, void* buffer, std::size_t size, std::uint64_t offset,
+               IoCallback on_complete = nullptr)
+        : IoNode(io, fd, size, offset, std::move(on_complete)), _buffer(buffer)
+    {
+    }
+
+protected:
+    void execute() override;
+
+private:
+    void* _buffer;
+};
+
+/**
+ * @class IoWriteNode
+ * @brief Graph node that writes a buffer to a file range.
+ */
+class IoWriteNode : public IoNode
+{
+public:
+    /**
+     * @param io The context that performs the write.
+     * @param fd Open file descriptor.
+     * @param buffer Source buffer, at least `size` bytes.
+     * @param size Number of bytes to write.
+     * @param offset File offset to write at.
+     * @param on_complete Optional callback invoked with the result before the node is completed.
+     */
+    IoWriteNode(IoContext& io, int fd, const void* buffer, std::size_t size, std::uint64_t offset,
+                IoCallback on_complete = nullptr)
+        : IoNode(io, fd, size, offset, std::move(on_complete)), _buffer(buffer)
+    {
+    }
+
+protected:
+    void execute() override;
+
+private:
+    const void* _buffer;
+};
+
+}  // namespace at
+
+#endif  // IO_H__
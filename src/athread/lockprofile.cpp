@@ -0,0 +1,90 @@
+#include "lockprofile.h"
+
+#include <cstdio>
+#include <ostream>
+#include <utility>
+
+#include "trace.h"
+
+using namespace at;
+
+namespace
+{
+// Durations with three significant digits in the unit that fits them.
+std::string duration(std::uint64_t nanoseconds)
+{
+    char text[32];
+    if (nanoseconds < 1000)
+        std::snprintf(text, sizeof(text), "%lluns", static_cast<unsigned long long>(nanoseconds));
+    else if (nanoseconds < 1000000)
+        std::snprintf(text, sizeof(text), "%.3gus", static_cast<double>(nanoseconds) / 1e3);
+    else if (nanoseconds < 1000000000)
+        std::snprintf(text, sizeof(text), "%.3gms", static_cast<double>(nanoseconds) / 1e6);
+    else
+        std::snprintf(text, sizeof(text), "%.3gs", static_cast<double>(nanoseconds) / 1e9);
+    return text;
+}
+}  // namespace
+
+void ProfiledMutex::lock()
+{
+    if (!_mutex.try_lock())
+    {
+        std::uint64_t start = Trace::now();
+        _mutex.lock();
+        std::uint64_t end = Trace::now();
+        _contended.store(_contended.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        _wait_time.record(end > start ? end - start : 0);
+    }
+    acquired();
+}
+
+bool ProfiledMutex::try_lock()
+{
+    if (!_mutex.try_lock()) return false;
+    acquired();
+    return true;
+}
+
+void ProfiledMutex::unlock()
+{
+    std::uint64_t now = Trace::now();
+    _hold_time.record(now > _acquired_at ? now - _acquired_at : 0);
+    _mutex.unlock();
+}
+
+// Held, so the counters have a single writer and need no read-modify-write.
+void ProfiledMutex::acquired()
+{
+    _acquisitions.store(_acquisitions.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    _acquired_at = Trace::now();
+}
+
+LockStats ProfiledMutex::stats(std::string name) const
+{
+    LockStats stats;
+    stats.name = std::move(name);
+    stats.acquisitions = _acquisitions.load(std::memory_order_relaxed);
+    stats.contended = _contended.load(std::memory_order_relaxed);
+    _wait_time.add_to(stats.wait_time);
+    _hold_time.add_to(stats.hold_time);
+    return stats;
+}
+
+void at::write_lock_report(std::ostream& out, const std::vector<LockStats>& stats)
+{
+    char line[256];
+    std::snprintf(line, sizeof(line), "%-24s %12s %10s %9s %9s %9s %11s %9s %9s %9s\n", "lock", "acquired",
+                  "contended", "wait p50", "wait p99", "wait max", "wait total", "hold p50", "hold p99", "hold max");
+    out << line;
+    for (const auto& lock : stats)
+    {
+        std::snprintf(line, sizeof(line), "%-24s %12llu %9.2f%% %9s %9s %9s %11s %9s %9s %9s\n", lock.name.c_str(),
+                      static_cast<unsigned long long>(lock.acquisitions), 100.0 * lock.contention(),
+                      duration(lock.wait_time.percentile(50)).c_str(), duration(lock.wait_time.percentile(99)).c_str(),
+                      duration(lock.wait_time.max()).c_str(), duration(lock.wait_time.sum()).c_str(),
+                      duration(lock.hold_time.percentile(50)).c_str(), duration(lock.hold_time.percentile(99)).c_str(),
+                      duration(lock.hold_time.max()).c_str());
+        out << line;
+    }
+}
@@ -0,0 +1,119 @@
+//////////////////////////////////////////////////////////////////////////
+// Copyright 2026 Le Xuan Tuan Anh
+//
+// https://github.com/z-pc/athread
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef LOCK_PROFILE_H__
+#define LOCK_PROFILE_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "metrics.h"
+#include "noncopyable.h"
+
+namespace at
+{
+
+/**
+ * @struct LockStats
+ * @brief Snapshot of the activity of a `ProfiledMutex`, see `ThreadPool::lock_stats()`. Durations are in
+ * nanoseconds.
+ */
+struct LockStats
+{
+    std::string name;
+    std::uint64_t acquisitions{0};
+    std::uint64_t contended{0};   // Acquisitions that found the mutex held and had to block.
+    HistogramSnapshot wait_time;  // Time blocked in lock(), contended acquisitions only.
+    HistogramSnapshot hold_time;  // From the acquisition to unlock(), every acquisition.
+
+    double contention() const
+    {
+        return acquisitions ? static_cast<double>(contended) / static_cast<double>(acquisitions) : 0.0;
+    }
+};
+
+/**
+ * @class ProfiledMutex
+ * @brief A `std::mutex` counting its acquisitions and measuring how long callers wait for it and hold it.
+ *
+ * A lock first tries the mutex; only when that fails is the clock read around the blocking lock. The hold
+ * time costs two clock reads per acquisition. Waiting on a `std::condition_variable_any` releases and takes
+ * the mutex again, so a wait ends a hold and its wake up is counted as an acquisition.
+ */
+class ProfiledMutex : public at::noncopyable_::noncopyable
+{
+public:
+    ProfiledMutex() = default;
+
+    void lock();
+    bool try_lock();
+    void unlock();
+
+    /**
+     * @brief Returns the counters and histograms. May run while other threads use the mutex.
+     */
+    LockStats stats(std::string name) const;
+
+private:
+    void acquired();
+
+    std::mutex _mutex;
+    std::uint64_t _acquired_at{0};  // Written by the owner only.
+    std::atomic<std::uint64_t> _acquisitions{0};
+    std::atomic<std::uint64_t> _contended{0};
+    LatencyHistogram _wait_time;
+    LatencyHistogram _hold_time;
+};
+
+// The locks of the schedulers. Profiled only in builds with AT_PROFILE_LOCKS, where workers wait on a
+// `std::condition_variable_any` so that the waits go through the profiled mutex.
+#ifdef AT_PROFILE_LOCKS
+using SchedulerMutex = ProfiledMutex;
+using SchedulerCondition = std::condition_variable_any;
+#else
+using SchedulerMutex = std::mutex;
+using SchedulerCondition = std::condition_variable;
+#endif
+
+/**
+ * @brief Appends the statistics of `mutex` under `name`, nothing when the scheduler locks are not profiled.
+ */
+inline void collect_lock_stats(std::vector<LockStats>& stats, const SchedulerMutex& mutex, const char* name)
+{
+#ifdef AT_PROFILE_LOCKS
+    stats.push_back(mutex.stats(name));
+#else
+    (void)stats;
+    (void)mutex;
+    (void)name;
+#endif
+}
+
+/**
+ * @brief Writes one line per lock: acquisitions, contention, wait percentiles and total, hold percentiles.
+ */
+void write_lock_report(std::ostream& out, const std::vector<LockStats>& stats);
+
+}  // namespace at
+
+#endif  // LOCK_PROFILE_H__
@@ -0,0 +1,283 @@
+#include "log.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+
+#include "cacheline.h"
+#include "diagnostics.h"
+#include "noncopyable.h"
+#include "trace.h"
+#include "worker.h"
+
+using namespace at;
+
+namespace
+{
+
+/**
+ * @brief Single producer, single consumer ring of records, see `TraceBuffer` in trace.cpp.
+ */
+class LogBuffer : public at::noncopyable_::noncopyable
+{
+public:
+    explicit LogBuffer(std::size_t capacity) : _mask(capacity - 1), _records(new LogRecord[capacity]) {}
+
+    void push(const LogRecord& record)
+    {
+        std::uint64_t head = _head.load(std::memory_order_relaxed);
+        if (head - _cached_tail > _mask)
+        {
+            _cached_tail = _tail.load(std::memory_order_acquire);
+            if (head - _cached_tail > _mask)
+            {
+                _dropped.store(_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return;
+            }
+        }
+        _records[head & _mask] = record;
+        _head.store(head + 1, std::memory_order_release);
+    }
+
+    std::size_t pop_all(std::vector<LogRecord>& out)
+    {
+        std::uint64_t tail = _tail.load(std::memory_order_relaxed);
+        std::uint64_t head = _head.load(std::memory_order_acquire);
+        for (std::uint64_t i = tail; i != head; i++) out.push_back(_records[i & _mask]);
+        _tail.store(head, std::memory_order_release);
+        return static_cast<std::size_t>(head - tail);
+    }
+
+    bool empty() const { return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_relaxed); }
+    std::uint64_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+    void retire() { _retired.store(true, std::memory_order_release); }
+    bool retired() const { return _retired.load(std::memory_order_acquire); }
+
+private:
+    const std::uint64_t _mask;
+    std::unique_ptr<LogRecord[]> _records;
+
+    // Written by the producer.
+    alignas(cache_line_size) std::atomic<std::uint64_t> _head{0};
+    std::uint64_t _cached_tail{0};
+    std::atomic<std::uint64_t> _dropped{0};
+    std::atomic_bool _retired{false};
+
+    // Written by the consumer.
+    alignas(cache_line_size) std::atomic<std::uint64_t> _tail{0};
+};
+
+struct Registry
+{
+    std::mutex mutex;
+    std::vector<std::shared_ptr<LogBuffer>> buffers;
+    std::size_t capacity{Log::default_capacity};
+    std::uint64_t retired_dropped{0};
+
+    std::mutex writer_mutex;
+    std::condition_variable writer_condition;
+    std::thread writer;
+    bool writer_stop{false};
+};
+
+Registry& registry()
+{
+    // Never destroyed, threads may log while static objects are torn down.
+    static Registry* instance = new Registry();
+    return *instance;
+}
+
+struct ThreadBuffer
+{
+    std::shared_ptr<LogBuffer> buffer;
+
+    ~ThreadBuffer()
+    {
+        if (buffer) buffer->retire();
+    }
+};
+
+thread_local ThreadBuffer thread_buffer;
+
+void append_arg(std::string& text, LogArgType type, std::uint64_t bits)
+{
+    char number[32];
+    switch (type)
+    {
+        case LogArgType::Int:
+            std::snprintf(number, sizeof(number), "%lld", static_cast<long long>(static_cast<std::int64_t>(bits)));
+            break;
+        case LogArgType::UInt:
+            std::snprintf(number, sizeof(number), "%llu", static_cast<unsigned long long>(bits));
+            break;
+        case LogArgType::Double:
+        {
+            double value;
+            std::memcpy(&value, &bits, sizeof(value));
+            std::snprintf(number, sizeof(number), "%g", value);
+            break;
+        }
+        case LogArgType::Bool: text += bits ? "true" : "false"; return;
+        case LogArgType::String:
+        {
+            const char* string = reinterpret_cast<const char*>(static_cast<std::uintptr_t>(bits));
+            text += string ? string : "(null)";
+            return;
+        }
+        case LogArgType::Pointer:
+            std::snprintf(number, sizeof(number), "0x%llx", static_cast<unsigned long long>(bits));
+            break;
+    }
+    text += number;
+}
+
+}  // namespace
+
+const char* at::log_level_name(LogLevel level)
+{
+    switch (level)
+    {
+        case LogLevel::Trace: return "TRACE";
+        case LogLevel::Debug: return "DEBUG";
+        case LogLevel::Info: return "INFO";
+        case LogLevel::Warn: return "WARN";
+    }
+    return "";
+}
+
+std::string LogRecord::text() const
+{
+    std::string text;
+    std::size_t next = 0;
+    for (const char* c = format; c && *c; c++)
+    {
+        if (c[0] == '{' && c[1] == '}' && next < arg_count)
+        {
+            append_arg(text, types[next], args[next]);
+            next++;
+            c++;
+        }
+        else
+        {
+            text += *c;
+        }
+    }
+    return text;
+}
+
+void Log::push(LogRecord& record)
+{
+    record.timestamp = Trace::now();
+    record.worker_id = IWorker::current_id();
+    if (!thread_buffer.buffer)
+    {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        thread_buffer.buffer = std::make_shared<LogBuffer>(reg.capacity);
+        reg.buffers.push_back(thread_buffer.buffer);
+    }
+    thread_buffer.buffer->push(record);
+}
+
+std::size_t Log::drain(std::vector<LogRecord>& records)
+{
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+
+    std::size_t count = 0;
+    for (auto& buffer : reg.buffers) count += buffer->pop_all(records);
+
+    // Partitioned rather than removed, the buffers that go are still read for their drop counts.
+    auto gone = std::stable_partition(reg.buffers.begin(), reg.buffers.end(),
+                                      [](const std::shared_ptr<LogBuffer>& buffer)
+                                      { return !buffer->retired() || !buffer->empty(); });
+    for (auto it = gone; it != reg.buffers.end(); ++it) reg.retired_dropped += (*it)->dropped();
+    reg.buffers.erase(gone, reg.buffers.end());
+    return count;
+}
+
+void Log::write(std::ostream& out, const LogRecord& record)
+{
+    const char* file = record.file ? record.file : "";
+    const char* slash = std::max(std::strrchr(file, '/'), std::strrchr(file, '\\'));
+    out << log_level_name(record.level) << ' ' << (slash ? slash + 1 : file) << ':' << record.line;
+    if (record.worker_id != invalid_worker_id) out << " [worker " << record.worker_id << ']';
+    out << ' ' << record.text() << '\n';
+}
+
+std::size_t Log::flush(std::ostream& out)
+{
+    std::vector<LogRecord> records;
+    drain(records);
+    if (records.empty()) return 0;
+
+    // Threads follow each other in the drained records, the lines are written in time order.
+    std::stable_sort(records.begin(), records.end(),
+                     [](const LogRecord& a, const LogRecord& b) { return a.timestamp < b.timestamp; });
+    std::lock_guard<std::mutex> lock(at_console_mutex);
+    for (const auto& record : records) write(out, record);
+    out.flush();
+    return records.size();
+}
+
+void Log::start_writer(std::ostream& out, std::chrono::milliseconds period /*= std::chrono::milliseconds(50)*/)
+{
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.writer_mutex);
+    if (reg.writer.joinable()) AT_RUNTIME_ERROR("Log writer is already running.");
+
+    reg.writer_stop = false;
+    reg.writer = std::thread(
+        [&reg, &out, period]()
+        {
+            std::unique_lock<std::mutex> lk(reg.writer_mutex);
+            bool stop = false;
+            while (!stop)
+            {
+                stop = reg.writer_condition.wait_for(lk, period, [&reg]() { return reg.writer_stop; });
+                lk.unlock();
+                Log::flush(out);
+                lk.lock();
+            }
+        });
+}
+
+void Log::stop_writer()
+{
+    Registry& reg = registry();
+    std::thread writer;
+    {
+        std::lock_guard<std::mutex> lock(reg.writer_mutex);
+        if (!reg.writer.joinable()) return;
+        reg.writer_stop = true;
+        writer = std::move(reg.writer);
+    }
+    reg.writer_condition.notify_all();
+    writer.join();
+}
+
+void Log::set_buffer_capacity(std::size_t records)
+{
+    if (records == 0) AT_INVALID_ARGUMENT("Log buffer capacity must be greater than 0.");
+
+    std::size_t capacity = 1;
+    while (capacity < records) capacity <<= 1;
+
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.capacity = capacity;
+}
+
+std::uint64_t Log::dropped()
+{
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    std::uint64_t total = reg.retired_dropped;
+    for (auto& buffer : reg.buffers) total += buffer->dropped();
+    return total;
+}
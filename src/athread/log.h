@@ -0,0 +1,241 @@
+//////////////////////////////////////////////////////////////////////////
+// Copyright 2026 Le Xuan Tuan Anh
+//
+// https://github.com/z-pc/athread
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef LOG_H__
+#define LOG_H__
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iosfwd>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Levels of the AT_LOG_* macros. Statements below `AT_LOG_LEVEL` are removed by the preprocessor, their
+// arguments are not evaluated. Set with the AT_LOG_LEVEL CMake option, AT_TRACKING alone means debug.
+#define AT_LOG_LEVEL_TRACE 0
+#define AT_LOG_LEVEL_DEBUG 1
+#define AT_LOG_LEVEL_INFO  2
+#define AT_LOG_LEVEL_WARN  3
+#define AT_LOG_LEVEL_OFF   4
+
+#ifndef AT_LOG_LEVEL
+#ifdef AT_TRACKING
+#define AT_LOG_LEVEL AT_LOG_LEVEL_DEBUG
+#else
+#define AT_LOG_LEVEL AT_LOG_LEVEL_OFF
+#endif
+#endif
+
+namespace at
+{
+
+enum class LogLevel : std::uint8_t
+{
+    Trace = AT_LOG_LEVEL_TRACE,
+    Debug = AT_LOG_LEVEL_DEBUG,
+    Info = AT_LOG_LEVEL_INFO,
+    Warn = AT_LOG_LEVEL_WARN,
+};
+
+const char* log_level_name(LogLevel level);
+
+enum class LogArgType : std::uint8_t
+{
+    Int,
+    UInt,
+    Double,
+    Bool,
+    String,  // A `const char*` that must outlive the drain of the record, a literal or an interned label.
+    Pointer,
+};
+
+/**
+ * @struct LogRecord
+ * @brief A log statement as recorded: the format and the binary arguments, formatted by `text()` only when the
+ * record is written.
+ */
+struct LogRecord
+{
+    static constexpr std::size_t max_args = 6;
+
+    std::uint64_t timestamp;  // Nanoseconds on the `std::chrono::steady_clock` time line, see `Trace::now()`.
+    const char* format;       // `{}` is replaced by the next argument.
+    const char* file;
+    std::uint32_t line;
+    std::uint32_t worker_id;  // `IWorker::current_id()` of the recording thread.
+    LogLevel level;
+    std::uint8_t arg_count;
+    std::array<LogArgType, max_args> types;
+    std::array<std::uint64_t, max_args> args;
+
+    std::string text() const;
+};
+
+/**
+ * @class Log
+ * @brief Deferred logging: a statement copies its arguments into a lock-free per-thread ring buffer, formatting
+ * and I/O happen later on the thread draining the buffers.
+ *
+ * Nothing is written until the records are drained, by `flush()` or by the writer thread of `start_writer()`.
+ * When the buffer of a thread is full, its new records are dropped and counted in `dropped()`.
+ *
+ * Arguments are copied as binary values, so only numbers, booleans, enums, pointers and C strings are accepted.
+ * C strings are copied as pointers: pass literals or strings that outlive the next drain.
+ */
+class Log
+{
+public:
+    static constexpr std::size_t default_capacity = 1024;
+
+    template <class... Args>
+    static void record(LogLevel level, const char* file, std::uint32_t line, const char* format, const Args&... args)
+    {
+        static_assert(sizeof...(Args) <= LogRecord::max_args, "Too many arguments for a log statement.");
+        LogRecord record{};
+        record.format = format;
+        record.file = file;
+        record.line = line;
+        record.level = level;
+        record.arg_count = static_cast<std::uint8_t>(sizeof...(Args));
+        std::size_t index = 0;
+        (encode(record, index++, args), ...);
+        (void)index;
+        push(record);
+    }
+
+    /**
+     * @brief Moves the records of all threads to `records`, each thread's in order.
+     * @return The number of records appended.
+     */
+    static std::size_t drain(std::vector<LogRecord>& records);
+
+    /**
+     * @brief Drains the records and writes one formatted line per record to `out`.
+     * @return The number of records written.
+     */
+    static std::size_t flush(std::ostream& out);
+
+    /**
+     * @brief Writes `record` as `LEVEL file:line [worker N] text`.
+     */
+    static void write(std::ostream& out, const LogRecord& record);
+
+    /**
+     * @brief Starts a thread flushing the records to `out` every `period`, and once more when stopped.
+     * @throws std::runtime_error if a writer is already running.
+     */
+    static void start_writer(std::ostream& out, std::chrono::milliseconds period = std::chrono::milliseconds(50));
+
+    /**
+     * @brief Stops the writer thread after a last flush. Does nothing if none is running.
+     */
+    static void stop_writer();
+
+    /**
+     * @brief Sets the number of records held by the buffers of threads that log for the first time later.
+     */
+    static void set_buffer_capacity(std::size_t records);
+
+    static std::uint64_t dropped();
+
+private:
+    template <class T>
+    static void encode(LogRecord& record, std::size_t index, const T& value)
+    {
+        using U = std::decay_t<T>;
+        LogArgType type;
+        std::uint64_t bits = 0;
+        if constexpr (std::is_same_v<U, bool>)
+        {
+            type = LogArgType::Bool;
+            bits = value ? 1 : 0;
+        }
+        else if constexpr (std::is_enum_v<U>)
+        {
+            type = LogArgType::Int;
+            bits = static_cast<std::uint64_t>(static_cast<std::int64_t>(value));
+        }
+        else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>)
+        {
+            type = LogArgType::Int;
+            bits = static_cast<std::uint64_t>(static_cast<std::int64_t>(value));
+        }
+        else if constexpr (std::is_integral_v<U>)
+        {
+            type = LogArgType::UInt;
+            bits = static_cast<std::uint64_t>(value);
+        }
+        else if constexpr (std::is_floating_point_v<U>)
+        {
+            type = LogArgType::Double;
+            double d = static_cast<double>(value);
+            std::memcpy(&bits, &d, sizeof(bits));
+        }
+        else if constexpr (std::is_same_v<U, const char*> || std::is_same_v<U, char*>)
+        {
+            type = LogArgType::String;
+            bits = reinterpret_cast<std::uintptr_t>(static_cast<U>(value));
+        }
+        else if constexpr (std::is_pointer_v<U>)
+        {
+            type = LogArgType::Pointer;
+            bits = reinterpret_cast<std::uintptr_t>(static_cast<const void*>(value));
+        }
+        else
+        {
+            static_assert(std::is_pointer_v<U>, "Log arguments must be numbers, enums, pointers or C strings.");
+        }
+        record.types[index] = type;
+        record.args[index] = bits;
+    }
+
+    static void push(LogRecord& record);
+};
+
+}  // namespace at
+
+#define AT_LOG_RECORD(level, ...) at::Log::record(level, __FILE__, __LINE__, __VA_ARGS__)
+
+#if AT_LOG_LEVEL <= AT_LOG_LEVEL_TRACE
+#define AT_LOG_TRACE(...) AT_LOG_RECORD(at::LogLevel::Trace, __VA_ARGS__)
+#else
+#define AT_LOG_TRACE(...) ((void)0)
+#endif
+
+#if AT_LOG_LEVEL <= AT_LOG_LEVEL_DEBUG
+#define AT_LOG_DEBUG(...) AT_LOG_RECORD(at::LogLevel::Debug, __VA_ARGS__)
+#else
+#define AT_LOG_DEBUG(...) ((void)0)
+#endif
+
+#if AT_LOG_LEVEL <= AT_LOG_LEVEL_INFO
+#define AT_LOG_INFO(...) AT_LOG_RECORD(at::LogLevel::Info, __VA_ARGS__)
+#else
+#define AT_LOG_INFO(...) ((void)0)
+#endif
+
+#if AT_LOG_LEVEL <= AT_LOG_LEVEL_WARN
+#define AT_LOG_WARN(...) AT_LOG_RECORD(at::LogLevel::Warn, __VA_ARGS__)
+#else
+#define AT_LOG_WARN(...) ((void)0)
+#endif
+
+#endif  // LOG_H__
@@ -0,0 +1,193 @@
+#include "mappedfile.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#include "diagnostics.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace at;
+
+namespace
+{
+
+constexpr std::size_t length_prefix_size = sizeof(std::uint32_t);
+
+std::uint32_t read_length_prefix(const char* p)
+{
+    const auto* bytes = reinterpret_cast<const unsigned char*>(p);
+    return static_cast<std::uint32_t>(bytes[0]) | (static_cast<std::uint32_t>(bytes[1]) << 8) |
+           (static_cast<std::uint32_t>(bytes[2]) << 16) | (static_cast<std::uint32_t>(bytes[3]) << 24);
+}
+
+// Returns the offset right after the record starting at `offset`.
+std::size_t next_record(std::string_view data, std::size_t offset, RecordFormat format)
+{
+    if (format == RecordFormat::Newline)
+    {
+        std::size_t end = data.find('\n', offset);
+        return end == std::string_view::npos ? data.size() : end + 1;
+    }
+
+    if (data.size() - offset < length_prefix_size) AT_RUNTIME_ERROR("Truncated record header at offset " << offset);
+    std::size_t length = read_length_prefix(data.data() + offset);
+    if (data.size() - offset - length_prefix_size < length)
+        AT_RUNTIME_ERROR("Record at offset " << offset << " runs past the end of the data");
+    return offset + length_prefix_size + length;
+}
+
+}  // namespace
+
+MappedFile::MappedFile(MappedFile&& other) noexcept : _data(other._data), _size(other._size), _opened(other._opened)
+{
+    other._data = nullptr;
+    other._size = 0;
+    other._opened = false;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        std::swap(_data, other._data);
+        std::swap(_size, other._size);
+        std::swap(_opened, other._opened);
+    }
+    return *this;
+}
+
+void MappedFile::open(const std::string& path)
+{
+    close();
+
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) AT_RUNTIME_ERROR("Cannot open " << path << ": " << std::strerror(errno));
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0)
+    {
+        int error = errno;
+        ::close(fd);
+        AT_RUNTIME_ERROR("Cannot stat " << path << ": " << std::strerror(error));
+    }
+
+    std::size_t size = static_cast<std::size_t>(info.st_size);
+    if (size > 0)
+    {
+        void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            int error = errno;
+            ::close(fd);
+            AT_RUNTIME_ERROR("Cannot map " << path << ": " << std::strerror(error));
+        }
+        _data = static_cast<const char*>(data);
+    }
+
+    // The mapping stays valid after the descriptor is closed.
+    ::close(fd);
+    _size = size;
+    _opened = true;
+#else
+    AT_RUNTIME_ERROR("MappedFile is not supported on this platform: " << path);
+#endif
+}
+
+void MappedFile::close()
+{
+#ifndef _WIN32
+    if (_data) ::munmap(const_cast<char*>(_data), _size);
+#endif
+    _data = nullptr;
+    _size = 0;
+    _opened = false;
+}
+
+std::string_view MappedFile::view(std::size_t offset, std::size_t length) const
+{
+    if (offset >= _size) return std::string_view();
+    return std::string_view(_data + offset, std::min(length, _size - offset));
+}
+
+void MappedFile::advise(std::size_t offset, std::size_t length, Advice advice) const
+{
+#ifndef _WIN32
+    if (!_data || offset >= _size || length == 0) return;
+
+    static const std::size_t page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    std::size_t begin = offset - offset % page_size;
+    std::size_t end = std::min(_size, offset + length);
+
+    int flag = MADV_NORMAL;
+    switch (advice)
+    {
+    case Advice::Normal: flag = MADV_NORMAL; break;
+    case Advice::Sequential: flag = MADV_SEQUENTIAL; break;
+    case Advice::Random: flag = MADV_RANDOM; break;
+    case Advice::WillNeed: flag = MADV_WILLNEED; break;
+    case Advice::DontNeed: flag = MADV_DONTNEED; break;
+    }
+    ::madvise(const_cast<char*>(_data) + begin, end - begin, flag);
+#else
+    (void)offset, (void)length, (void)advice;
+#endif
+}
+
+std::vector<FileChunk> at::partition_records(std::string_view data, std::size_t chunk_size, RecordFormat format)
+{
+    if (chunk_size == 0) AT_INVALID_ARGUMENT("Chunk size must be greater than zero.");
+
+    std::vector<FileChunk> chunks;
+    chunks.reserve(data.size() / chunk_size + 1);
+
+    std::size_t begin = 0;
+    while (begin < data.size())
+    {
+        std::size_t end;
+        if (format == RecordFormat::Newline)
+        {
+            // Jump to the target size and finish the record there, no need to look at the bytes before.
+            std::size_t target = std::min(data.size(), begin + chunk_size);
+            end = target == data.size() ? target : next_record(data, target - 1, format);
+        }
+        else
+        {
+            end = begin;
+            while (end < data.size() && end - begin < chunk_size) end = next_record(data, end, format);
+        }
+
+        chunks.push_back(FileChunk{begin, end - begin});
+        begin = end;
+    }
+    return chunks;
+}
+
+void at::for_each_record(std::string_view chunk, RecordFormat format, const std::function<void(std::string_view)>& fn)
+{
+    std::size_t offset = 0;
+    while (offset < chunk.size())
+    {
+        std::size_t end = next_record(chunk, offset, format);
+        if (format == RecordFormat::Newline)
+        {
+            std::size_t length = end - offset;
+            if (chunk[end - 1] == '\n') --length;
+            fn(chunk.substr(offset, length));
+        }
+        else
+        {
+            fn(chunk.substr(offset + length_prefix_size, end - offset - length_prefix_size));
+        }
+        offset = end;
+    }
+}
@@ -0,0 +1,166 @@
+//////////////////////////////////////////////////////////////////////////
+// Copyright 2026 Le Xuan Tuan Anh
+//
+// https://github.com/z-pc/athread
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef MAPPED_FILE_H__
+#define MAPPED_FILE_H__
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "noncopyable.h"
+
+namespace at
+{
+
+/**
+ * @class MappedFile
+ * @brief Read-only memory mapping of a whole file.
+ *
+ * The content is accessed in place, nothing is copied into user buffers. Pages are loaded by the
+ * kernel on first access; `advise()` tells it how a range is going to be used.
+ */
+class MappedFile : public at::noncopyable_::noncopyable
+{
+public:
+    /**
+     * @enum Advice
+     * @brief Access pattern hints forwarded to `madvise`.
+     */
+    enum class Advice
+    {
+        Normal,      ///< No special treatment.
+        Sequential,  ///< The range is read once from start to end, aggressive read-ahead.
+        Random,      ///< The range is accessed randomly, no read-ahead.
+        WillNeed,    ///< The range is needed soon, start reading it in the background.
+        DontNeed     ///< The range is not needed anymore, its pages can be dropped.
+    };
+
+    /**
+     * @brief Constructs an empty mapping.
+     */
+    MappedFile() {}
+
+    /**
+     * @brief Maps the file at `path`.
+     * @throws std::runtime_error if the file cannot be opened or mapped.
+     */
+    explicit MappedFile(const std::string& path) { open(path); }
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    /**
+     * @brief Destructor. Unmaps the file.
+     */
+    ~MappedFile() { close(); }
+
+    /**
+     * @brief Maps the file at `path`, replacing the current mapping.
+     * @throws std::runtime_error if the file cannot be opened or mapped.
+     */
+    void open(const std::string& path);
+
+    /**
+     * @brief Unmaps the file. Views obtained before become invalid.
+     */
+    void close();
+
+    bool is_open() const { return _opened; }
+    const char* data() const { return _data; }
+    std::size_t size() const { return _size; }
+
+    /**
+     * @brief Returns the whole content of the file.
+     */
+    std::string_view view() const { return std::string_view(_data, _size); }
+
+    /**
+     * @brief Returns the content of `[offset, offset + length)`, clamped to the file size.
+     */
+    std::string_view view(std::size_t offset, std::size_t length) const;
+
+    /**
+     * @brief Gives the kernel an access pattern hint for `[offset, offset + length)`.
+     *
+     * The range is widened to page boundaries. Hints are best effort, failures are ignored.
+     */
+    void advise(std::size_t offset, std::size_t length, Advice advice) const;
+
+private:
+    const char* _data{nullptr};
+    std::size_t _size{0};
+    bool _opened{false};
+};
+
+/**
+ * @enum RecordFormat
+ * @brief Describes how records are delimited inside a file.
+ *
+ * - `Newline`: each record ends with `'\n'`, the last record may end at the end of the file.
+ * - `LengthPrefixed`: each record is a 32-bit little-endian payload size followed by the payload.
+ */
+enum class RecordFormat
+{
+    Newline,
+    LengthPrefixed
+};
+
+/**
+ * @struct FileChunk
+ * @brief A range of a file that starts and ends on record boundaries.
+ */
+struct FileChunk
+{
+    std::size_t offset;  ///< Offset of the first byte of the chunk.
+    std::size_t size;    ///< Number of bytes in the chunk.
+};
+
+/**
+ * @brief Splits `data` into consecutive record-aligned chunks of about `chunk_size` bytes.
+ *
+ * A chunk is never smaller than `chunk_size` unless it is the last one, and never cuts a record;
+ * a single record larger than `chunk_size` forms its own chunk.
+ *
+ * @throws std::invalid_argument if `chunk_size` is zero.
+ * @throws std::runtime_error if a length-prefixed record runs past the end of the data.
+ */
+std::vector<FileChunk> partition_records(std::string_view data, std::size_t chunk_size, RecordFormat format);
+
+/**
+ * @brief Splits a mapped file into record-aligned chunks. See `partition_records(std::string_view, ...)`.
+ */
+inline std::vector<FileChunk> partition_records(const MappedFile& file, std::size_t chunk_size, RecordFormat format)
+{
+    return partition_records(file.view(), chunk_size, format);
+}
+
+/**
+ * @brief Calls `fn` with the payload of every record in `chunk`.
+ *
+ * Newline records are passed without their trailing `'\n'`.
+ *
+ * @throws std::runtime_error if a length-prefixed record runs past the end of the chunk.
+ */
+void for_each_record(std::string_view chunk, RecordFormat format, const std::function<void(std::string_view)>& fn);
+
+}  // namespace at
+
+#endif  // MAPPED_FILE_H__
@@ -0,0 +1,238 @@
+#include "metrics.h"
+
+#include <algorithm>
+
+#include "worker.h"
+
+using namespace at;
+
+namespace
+{
+int magnitude(std::uint64_t value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(value);
+#else
+    int bits = 0;
+    while (value >>= 1) bits++;
+    return bits;
+#endif
+}
+
+// Threads that are not workers of the pool, producers mostly, spread over the upper half of the shards.
+std::size_t thread_slot()
+{
+    static std::atomic<std::size_t> next{0};
+    constexpr std::size_t half = PoolMetricsRecorder::max_shards / 2;
+    thread_local std::size_t slot = half + next.fetch_add(1, std::memory_order_relaxed) % half;
+    return slot;
+}
+}  // namespace
+
+//////////////////////////////////////////////////////////////////////////
+// HistogramSnapshot
+
+HistogramSnapshot::HistogramSnapshot() : _buckets(LatencyHistogram::bucket_count, 0) {}
+
+std::uint64_t HistogramSnapshot::percentile(double percent) const
+{
+    if (_count == 0) return 0;
+
+    percent = std::clamp(percent, 0.0, 100.0);
+    auto rank = static_cast<std::uint64_t>(percent / 100.0 * static_cast<double>(_count) + 0.5);
+    rank = std::clamp<std::uint64_t>(rank, 1, _count);
+
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < _buckets.size(); i++)
+    {
+        seen += _buckets[i];
+        if (seen >= rank) return std::min(LatencyHistogram::bucket_upper_bound(i), _max);
+    }
+    return _max;
+}
+
+void HistogramSnapshot::merge(const HistogramSnapshot& other)
+{
+    for (std::size_t i = 0; i < _buckets.size(); i++) _buckets[i] += other._buckets[i];
+    _count += other._count;
+    _sum += other._sum;
+    _max = std::max(_max, other._max);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// LatencyHistogram
+
+std::size_t LatencyHistogram::bucket_of(std::uint64_t value)
+{
+    if (value < sub_bucket_count) return static_cast<std::size_t>(value);
+
+    int m = magnitude(value);
+    if (m > max_magnitude) return bucket_count - 1;
+
+    std::uint64_t sub = (value >> (m - sub_bucket_bits)) & (sub_bucket_count - 1);
+    return static_cast<std::size_t>((m - sub_bucket_bits + 1) * sub_bucket_count + sub);
+}
+
+std::uint64_t LatencyHistogram::bucket_upper_bound(std::size_t index)
+{
+    if (index < sub_bucket_count) return index;
+
+    int m = static_cast<int>(index / sub_bucket_count) + sub_bucket_bits - 1;
+    std::uint64_t sub = index % sub_bucket_count;
+    std::uint64_t width = std::uint64_t(1) << (m - sub_bucket_bits);
+    return (sub_bucket_count + sub) * width + width - 1;
+}
+
+void LatencyHistogram::record(std::uint64_t value)
+{
+    _buckets[bucket_of(value)].fetch_add(1, std::memory_order_relaxed);
+    _sum.fetch_add(value, std::memory_order_relaxed);
+
+    std::uint64_t max = _max.load(std::memory_order_relaxed);
+    while (value > max && !_max.compare_exchange_weak(max, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+void LatencyHistogram::add_to(HistogramSnapshot& snapshot) const
+{
+    for (std::size_t i = 0; i < bucket_count; i++)
+    {
+        std::uint64_t count = _buckets[i].load(std::memory_order_relaxed);
+        snapshot._buckets[i] += count;
+        snapshot._count += count;
+    }
+    snapshot._sum += _sum.load(std::memory_order_relaxed);
+    snapshot._max = std::max(snapshot._max, _max.load(std::memory_order_relaxed));
+}
+
+//////////////////////////////////////////////////////////////////////////
+// PoolMetricsRecorder
+
+PoolMetricsRecorder::~PoolMetricsRecorder()
+{
+    for (auto& shard : _shards) delete shard.load(std::memory_order_relaxed);
+}
+
+PoolMetricsRecorder::Shard& PoolMetricsRecorder::shard()
+{
+    std::uint32_t worker = IWorker::current_id();
+    std::size_t index = worker != invalid_worker_id ? worker % (max_shards / 2) : thread_slot();
+
+    Shard* shard = _shards[index].load(std::memory_order_acquire);
+    if (shard) return *shard;
+
+    // First use of the slot, the loser of a race frees its copy.
+    Shard* created = new Shard();
+    if (_shards[index].compare_exchange_strong(shard, created, std::memory_order_acq_rel)) return *created;
+    delete created;
+    return *shard;
+}
+
+void PoolMetricsRecorder::task_completed(std::uint64_t queue_wait, std::uint64_t execution_time,
+                                         std::uint64_t cpu_time)
+{
+    Shard& s = shard();
+    s.completed.fetch_add(1, std::memory_order_relaxed);
+    s.queue_wait.record(queue_wait);
+    s.execution_time.record(execution_time);
+    s.cpu_time.record(cpu_time);
+}
+
+void PoolMetricsRecorder::task_counted(const PerfCounts& counts)
+{
+    Shard& s = shard();
+    for (std::size_t i = 0; i < perf_event_count; i++)
+        if (counts.values[i]) s.counters[i].fetch_add(counts.values[i], std::memory_order_relaxed);
+    s.counters_valid.fetch_or(counts.valid, std::memory_order_relaxed);
+}
+
+void PoolMetricsRecorder::worker_started(bool seasonal)
+{
+    _live_workers.fetch_add(1, std::memory_order_relaxed);
+    if (seasonal) _seasonal_workers.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PoolMetricsRecorder::worker_exited(bool seasonal)
+{
+    _live_workers.fetch_sub(1, std::memory_order_relaxed);
+    if (seasonal) _seasonal_workers.fetch_sub(1, std::memory_order_relaxed);
+}
+
+PoolMetrics PoolMetricsRecorder::snapshot() const
+{
+    PoolMetrics metrics;
+    for (const auto& slot : _shards)
+    {
+        const Shard* shard = slot.load(std::memory_order_acquire);
+        if (!shard) continue;
+
+        metrics.submitted += shard->submitted.load(std::memory_order_relaxed);
+        metrics.completed += shard->completed.load(std::memory_order_relaxed);
+        metrics.rejected += shard->rejected.load(std::memory_order_relaxed);
+        shard->queue_wait.add_to(metrics.queue_wait);
+        shard->execution_time.add_to(metrics.execution_time);
+        shard->cpu_time.add_to(metrics.cpu_time);
+        PerfCounts counts;
+        for (std::size_t i = 0; i < perf_event_count; i++)
+            counts.values[i] = shard->counters[i].load(std::memory_order_relaxed);
+        counts.valid = shard->counters_valid.load(std::memory_order_relaxed);
+        metrics.counters += counts;
+    }
+    metrics.queue_depth = _queue_depth.load(std::memory_order_relaxed);
+    metrics.max_queue_depth = _max_queue_depth.load(std::memory_order_relaxed);
+    metrics.live_workers = _live_workers.load(std::memory_order_relaxed);
+    metrics.idle_workers = _idle_workers.load(std::memory_order_relaxed);
+    metrics.seasonal_workers = _seasonal_workers.load(std::memory_order_relaxed);
+    return metrics;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// GraphMetricsRecorder
+
+GraphMetricsRecorder& GraphMetricsRecorder::operator=(const GraphMetricsRecorder& other)
+{
+    // Only used when a graph is moved, no worker is running then.
+    _runs.store(other._runs.load());
+    _failed_runs.store(other._failed_runs.load());
+    _node_count.store(other._node_count.load());
+    _last_makespan.store(other._last_makespan.load());
+    _last_work.store(other._last_work.load());
+    _last_span.store(other._last_span.load());
+    _last_cpu_time.store(other._last_cpu_time.load());
+    _nodes_started.store(other._nodes_started.load());
+    _live_workers.store(other._live_workers.load());
+    _idle_workers.store(other._idle_workers.load());
+    return *this;
+}
+
+void GraphMetricsRecorder::run_started(std::uint64_t node_count)
+{
+    _runs.fetch_add(1, std::memory_order_relaxed);
+    _node_count.store(node_count, std::memory_order_relaxed);
+}
+
+void GraphMetricsRecorder::run_profiled(std::uint64_t makespan, std::uint64_t work, std::uint64_t span,
+                                        std::uint64_t cpu_time)
+{
+    _last_cpu_time.store(cpu_time, std::memory_order_relaxed);
+    _last_makespan.store(makespan, std::memory_order_relaxed);
+    _last_work.store(work, std::memory_order_relaxed);
+    _last_span.store(span, std::memory_order_relaxed);
+}
+
+GraphMetrics GraphMetricsRecorder::snapshot() const
+{
+    GraphMetrics metrics;
+    metrics.runs = _runs.load(std::memory_order_relaxed);
+    metrics.failed_runs = _failed_runs.load(std::memory_order_relaxed);
+    metrics.nodes_started = _nodes_started.load(std::memory_order_relaxed);
+    metrics.node_count = _node_count.load(std::memory_order_relaxed);
+    metrics.live_workers = _live_workers.load(std::memory_order_relaxed);
+    metrics.idle_workers = _idle_workers.load(std::memory_order_relaxed);
+    metrics.last_makespan = _last_makespan.load(std::memory_order_relaxed);
+    metrics.last_work = _last_work.load(std::memory_order_relaxed);
+    metrics.last_span = _last_span.load(std::memory_order_relaxed);
+    metrics.last_cpu_time = _last_cpu_time.load(std::memory_order_relaxed);
+    return metrics;
+}
@@ -0,0 +1,254 @@
+//////////////////////////////////////////////////////////////////////////
+// Copyright 2026 Le Xuan Tuan Anh
+//
+// https://github.com/z-pc/athread
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef METRICS_H__
+#define METRICS_H__
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "cacheline.h"
+#include "noncopyable.h"
+#include "perfcounters.h"
+
+namespace at
+{
+
+/**
+ * @class HistogramSnapshot
+ * @brief A copy of the buckets of a `LatencyHistogram`, merged over all shards.
+ */
+class HistogramSnapshot
+{
+public:
+    HistogramSnapshot();
+
+    std::uint64_t count() const { return _count; }
+    std::uint64_t sum() const { return _sum; }
+    std::uint64_t max() const { return _max; }
+    double mean() const { return _count ? static_cast<double>(_sum) / static_cast<double>(_count) : 0.0; }
+
+    /**
+     * @brief Returns the value below which `percent` percent of the recorded values fall.
+     *
+     * The result is the upper bound of the bucket holding that rank, at most 12.5% above the exact value.
+     * Returns 0 when nothing was recorded.
+     */
+    std::uint64_t percentile(double percent) const;
+
+    /**
+     * @brief Returns the number of values recorded in each bucket, see `LatencyHistogram::bucket_upper_bound()`.
+     */
+    const std::vector<std::uint64_t>& buckets() const { return _buckets; }
+
+    void merge(const HistogramSnapshot& other);
+
+private:
+    friend class LatencyHistogram;
+
+    std::vector<std::uint64_t> _buckets;
+    std::uint64_t _count{0};
+    std::uint64_t _sum{0};
+    std::uint64_t _max{0};
+};
+
+/**
+ * @class LatencyHistogram
+ * @brief Lock-free histogram of durations with a bounded relative error, in the manner of HdrHistogram.
+ *
+ * Values below 8 have their own bucket. Above, every power of two is split into 8 linear buckets, so a
+ * bucket is at most 12.5% wide relative to its values. Values from 2^44 ns (about 4.9 hours) up share
+ * the last bucket. Recording is two relaxed atomic adds and a rarely taken compare-exchange for the max.
+ */
+class LatencyHistogram : public at::noncopyable_::noncopyable
+{
+public:
+    static constexpr int sub_bucket_bits = 3;
+    static constexpr std::uint64_t sub_bucket_count = std::uint64_t(1) << sub_bucket_bits;
+    static constexpr int max_magnitude = 44;
+    static constexpr std::size_t bucket_count = (max_magnitude - sub_bucket_bits + 2) * sub_bucket_count;
+
+    static std::size_t bucket_of(std::uint64_t value);
+    static std::uint64_t bucket_upper_bound(std::size_t index);
+
+    void record(std::uint64_t value);
+
+    /**
+     * @brief Adds the current content to `snapshot`. May run while other threads record.
+     */
+    void add_to(HistogramSnapshot& snapshot) const;
+
+private:
+    std::array<std::atomic<std::uint64_t>, bucket_count> _buckets{};
+    std::atomic<std::uint64_t> _sum{0};
+    std::atomic<std::uint64_t> _max{0};
+};
+
+/**
+ * @struct PoolMetrics
+ * @brief Snapshot of the activity of a `ThreadPool`, see `ThreadPool::metrics()`.
+ *
+ * Counters are cumulative since the pool was created. Durations are in nanoseconds.
+ */
+struct PoolMetrics
+{
+    std::uint64_t submitted{0};  // Tasks accepted by push().
+    std::uint64_t completed{0};  // Tasks whose execute() returned.
+    std::uint64_t rejected{0};   // Tasks refused by push() because the pool was terminated.
+    std::uint64_t queue_depth{0};
+    std::uint64_t max_queue_depth{0};
+    std::uint32_t live_workers{0};      // Worker threads running, seasonal ones included.
+    std::uint32_t idle_workers{0};      // Workers sleeping until a task is pushed.
+    std::uint32_t seasonal_workers{0};  // Live workers above the core count, exiting when idle for too long.
+    HistogramSnapshot queue_wait;       // From push() to the start of execute(), sampled tasks only.
+    HistogramSnapshot execution_time;   // Duration of execute(), sampled tasks only.
+    HistogramSnapshot cpu_time;         // CPU time used by execute(), sampled tasks only.
+    PerfCounts counters;                // Events counted while tasks ran, see `ThreadPool::set_perf_counters()`.
+};
+
+/**
+ * @class PoolMetricsRecorder
+ * @brief The counters behind `PoolMetrics`.
+ *
+ * Counters and histograms are sharded: workers write to the shard of their id and other threads to a
+ * shard picked once per thread, each shard on its own cache lines and allocated on first use. A snapshot
+ * merges the shards without taking any lock, so it may be slightly behind the workers.
+ */
+class PoolMetricsRecorder : public at::noncopyable_::noncopyable
+{
+public:
+    static constexpr std::size_t max_shards = 64;
+
+    PoolMetricsRecorder() = default;
+    ~PoolMetricsRecorder();
+
+    void task_submitted() { shard().submitted.fetch_add(1, std::memory_order_relaxed); }
+    void task_rejected() { shard().rejected.fetch_add(1, std::memory_order_relaxed); }
+    void task_completed() { shard().completed.fetch_add(1, std::memory_order_relaxed); }
+    void task_completed(std::uint64_t queue_wait, std::uint64_t execution_time, std::uint64_t cpu_time);
+    void task_counted(const PerfCounts& counts);
+
+    // Called with the queue lock held, which orders the updates.
+    void queue_depth_changed(std::uint64_t depth)
+    {
+        _queue_depth.store(depth, std::memory_order_relaxed);
+        if (depth > _max_queue_depth.load(std::memory_order_relaxed))
+            _max_queue_depth.store(depth, std::memory_order_relaxed);
+    }
+
+    void worker_started(bool seasonal);
+    void worker_exited(bool seasonal);
+    void worker_parked() { _idle_workers.fetch_add(1, std::memory_order_relaxed); }
+    void worker_woke() { _idle_workers.fetch_sub(1, std::memory_order_relaxed); }
+
+    PoolMetrics snapshot() const;
+
+private:
+    struct alignas(cache_line_size) Shard
+    {
+        std::atomic<std::uint64_t> submitted{0};
+        std::atomic<std::uint64_t> completed{0};
+        std::atomic<std::uint64_t> rejected{0};
+        std::array<std::atomic<std::uint64_t>, perf_event_count> counters{};
+        std::atomic<std::uint32_t> counters_valid{0};
+        alignas(cache_line_size) LatencyHistogram queue_wait;
+        LatencyHistogram execution_time;
+        LatencyHistogram cpu_time;
+    };
+
+    Shard& shard();
+
+    std::array<std::atomic<Shard*>, max_shards> _shards{};
+
+    alignas(cache_line_size) std::atomic<std::uint64_t> _queue_depth{0};
+    std::atomic<std::uint64_t> _max_queue_depth{0};
+
+    alignas(cache_line_size) std::atomic<std::uint32_t> _live_workers{0};
+    std::atomic<std::uint32_t> _idle_workers{0};
+    std::atomic<std::uint32_t> _seasonal_workers{0};
+};
+
+/**
+ * @struct GraphMetrics
+ * @brief Snapshot of the activity of a `ThreadGraph`, see `ThreadGraph::metrics()`.
+ *
+ * Counters are cumulative since the graph was created. The `last_*` durations come from the last profiled
+ * run, see `ThreadGraph::set_profiling()`, and are zero until one completes.
+ */
+struct GraphMetrics
+{
+    std::uint64_t runs{0};           // Calls to start().
+    std::uint64_t failed_runs{0};    // Runs whose wait() reported an exception of a node.
+    std::uint64_t nodes_started{0};  // Nodes picked by the workers, over all runs.
+    std::uint64_t node_count{0};     // Nodes in the graph at the last start().
+    std::uint32_t live_workers{0};
+    std::uint32_t idle_workers{0};  // Workers sleeping until a node becomes ready.
+    bool executing{false};
+    std::uint64_t last_makespan{0};
+    std::uint64_t last_work{0};
+    std::uint64_t last_span{0};
+    std::uint64_t last_cpu_time{0};
+};
+
+/**
+ * @class GraphMetricsRecorder
+ * @brief The counters behind `GraphMetrics`.
+ *
+ * `node_started()` is called by the worker holding the task lock, the other updates come from the thread
+ * driving the graph or from workers starting and parking, so plain relaxed atomics are enough.
+ */
+class GraphMetricsRecorder
+{
+public:
+    GraphMetricsRecorder() = default;
+    GraphMetricsRecorder(const GraphMetricsRecorder& other) { *this = other; }
+    GraphMetricsRecorder& operator=(const GraphMetricsRecorder& other);
+
+    void run_started(std::uint64_t node_count);
+    void run_failed() { _failed_runs.fetch_add(1, std::memory_order_relaxed); }
+    void run_profiled(std::uint64_t makespan, std::uint64_t work, std::uint64_t span, std::uint64_t cpu_time);
+    void node_started() { _nodes_started.fetch_add(1, std::memory_order_relaxed); }
+
+    void worker_started() { _live_workers.fetch_add(1, std::memory_order_relaxed); }
+    void worker_exited() { _live_workers.fetch_sub(1, std::memory_order_relaxed); }
+    void worker_parked() { _idle_workers.fetch_add(1, std::memory_order_relaxed); }
+    void worker_woke() { _idle_workers.fetch_sub(1, std::memory_order_relaxed); }
+
+    GraphMetrics snapshot() const;
+
+private:
+    std::atomic<std::uint64_t> _runs{0};
+    std::atomic<std::uint64_t> _failed_runs{0};
+    std::atomic<std::uint64_t> _node_count{0};
+    std::atomic<std::uint64_t> _last_makespan{0};
+    std::atomic<std::uint64_t> _last_work{0};
+    std::atomic<std::uint64_t> _last_span{0};
+    std::atomic<std::uint64_t> _last_cpu_time{0};
+
+    // Written by the workers.
+    alignas(cache_line_size) std::atomic<std::uint64_t> _nodes_started{0};
+    std::atomic<std::uint32_t> _live_workers{0};
+    std::atomic<std::uint32_t> _idle_workers{0};
+};
+
+}  // namespace at
+
+#endif  // METRICS_H__
@@ -0,0 +1,299 @@
+#include "metricsexport.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+#include "diagnostics.h"
+#include "threadgraph.h"
+#include "threadpool.h"
+
+using namespace at;
+
+namespace
+{
+
+struct Bucket
+{
+    const char* label;
+    std::uint64_t bound;  // Nanoseconds.
+};
+
+constexpr Bucket histogram_buckets[] = {
+    {"1e-06", 1000},    {"1e-05", 10000},       {"0.0001", 100000},  {"0.001", 1000000},
+    {"0.01", 10000000}, {"0.1", 100000000},     {"1", 1000000000},   {"10", 10000000000},
+};
+
+std::string seconds(std::uint64_t nanoseconds)
+{
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.9g", static_cast<double>(nanoseconds) / 1e9);
+    return text;
+}
+
+// Label values escape backslashes, double quotes and line feeds.
+std::string label(const char* key, const std::string& value)
+{
+    std::string text = key;
+    text += "=\"";
+    for (char c : value)
+    {
+        if (c == '\\' || c == '"')
+        {
+            text += '\\';
+            text += c;
+        }
+        else if (c == '\n')
+        {
+            text += "\\n";
+        }
+        else
+        {
+            text += c;
+        }
+    }
+    text += '"';
+    return text;
+}
+
+/**
+ * @brief Writes metric families. All the samples of a family follow its `# HELP` and `# TYPE` lines.
+ */
+class Renderer
+{
+public:
+    Renderer(std::ostream& out, MetricsFormat format, const std::string& prefix)
+        : _out(out), _format(format), _prefix(prefix)
+    {
+    }
+
+    // Counters are declared without their `_total` suffix in OpenMetrics, with it in the Prometheus format.
+    void family(const char* name, const char* type, const char* help)
+    {
+        _name = _prefix + "_" + name;
+        _counter = std::strcmp(type, "counter") == 0;
+        std::string declared = _counter && _format == MetricsFormat::Prometheus ? _name + "_total" : _name;
+        _out << "# HELP " << declared << ' ' << help << '\n';
+        _out << "# TYPE " << declared << ' ' << type << '\n';
+    }
+
+    template <class Value>
+    void sample(const std::string& labels, const Value& value)
+    {
+        _out << _name << (_counter ? "_total" : "") << '{' << labels << "} " << value << '\n';
+    }
+
+    void histogram(const std::string& labels, const HistogramSnapshot& histogram)
+    {
+        const auto& counts = histogram.buckets();
+        std::uint64_t cumulative = 0;
+        std::size_t index = 0;
+        for (const auto& bucket : histogram_buckets)
+        {
+            for (; index < counts.size() && LatencyHistogram::bucket_upper_bound(index) <= bucket.bound; index++)
+                cumulative += counts[index];
+            _out << _name << "_bucket{" << labels << ",le=\"" << bucket.label << "\"} " << cumulative << '\n';
+        }
+        _out << _name << "_bucket{" << labels << ",le=\"+Inf\"} " << histogram.count() << '\n';
+        _out << _name << "_sum{" << labels << "} " << seconds(histogram.sum()) << '\n';
+        _out << _name << "_count{" << labels << "} " << histogram.count() << '\n';
+    }
+
+    void end()
+    {
+        if (_format == MetricsFormat::OpenMetrics) _out << "# EOF\n";
+    }
+
+private:
+    std::ostream& _out;
+    MetricsFormat _format;
+    const std::string& _prefix;
+    std::string _name;
+    bool _counter{false};
+};
+
+template <class Metrics, class Get>
+void write_family(Renderer& renderer, const std::vector<std::pair<std::string, Metrics>>& sources, const char* name,
+                  const char* type, const char* help, Get get)
+{
+    if (sources.empty()) return;
+    renderer.family(name, type, help);
+    for (const auto& source : sources) renderer.sample(source.first, get(source.second));
+}
+
+}  // namespace
+
+MetricsExporter::MetricsExporter(MetricsFormat format /*= MetricsFormat::Prometheus*/,
+                                 std::string prefix /*= "athread"*/)
+    : _format(format), _prefix(std::move(prefix))
+{
+}
+
+MetricsExporter::~MetricsExporter() { stop(); }
+
+void MetricsExporter::add(const std::string& name, const ThreadPool& pool)
+{
+    std::lock_guard<std::mutex> lock(_sources_mutex);
+    _pools.push_back({name, &pool});
+}
+
+void MetricsExporter::add(const std::string& name, const ThreadGraph& graph)
+{
+    std::lock_guard<std::mutex> lock(_sources_mutex);
+    _graphs.push_back({name, &graph});
+}
+
+void MetricsExporter::remove(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(_sources_mutex);
+    auto named = [&name](const auto& entry) { return entry.name == name; };
+    _pools.erase(std::remove_if(_pools.begin(), _pools.end(), named), _pools.end());
+    _graphs.erase(std::remove_if(_graphs.begin(), _graphs.end(), named), _graphs.end());
+}
+
+void MetricsExporter::write(std::ostream& out) const
+{
+    // Snapshots first, the text is written without holding anything.
+    std::vector<std::pair<std::string, PoolMetrics>> pools;
+    std::vector<std::pair<std::string, GraphMetrics>> graphs;
+    {
+        std::lock_guard<std::mutex> lock(_sources_mutex);
+        for (const auto& entry : _pools) pools.emplace_back(label("pool", entry.name), entry.source->metrics());
+        for (const auto& entry : _graphs) graphs.emplace_back(label("graph", entry.name), entry.source->metrics());
+    }
+
+    Renderer r(out, _format, _prefix);
+    using P = PoolMetrics;
+    write_family(r, pools, "pool_tasks_submitted", "counter", "Tasks accepted by the pool.",
+                 [](const P& m) { return m.submitted; });
+    write_family(r, pools, "pool_tasks_completed", "counter", "Tasks executed by the pool.",
+                 [](const P& m) { return m.completed; });
+    write_family(r, pools, "pool_tasks_rejected", "counter", "Tasks refused because the pool was terminated.",
+                 [](const P& m) { return m.rejected; });
+    write_family(r, pools, "pool_queue_depth", "gauge", "Tasks waiting in the queues.",
+                 [](const P& m) { return m.queue_depth; });
+    write_family(r, pools, "pool_queue_depth_max", "gauge", "Highest number of tasks waiting in the queues.",
+                 [](const P& m) { return m.max_queue_depth; });
+    write_family(r, pools, "pool_workers_live", "gauge", "Worker threads running.",
+                 [](const P& m) { return m.live_workers; });
+    write_family(r, pools, "pool_workers_idle", "gauge", "Workers waiting for a task.",
+                 [](const P& m) { return m.idle_workers; });
+    write_family(r, pools, "pool_workers_seasonal", "gauge", "Workers above the core count.",
+                 [](const P& m) { return m.seasonal_workers; });
+    if (!pools.empty())
+    {
+        r.family("pool_queue_wait_seconds", "histogram", "Time from push to the start of a sampled task.");
+        for (const auto& pool : pools) r.histogram(pool.first, pool.second.queue_wait);
+        r.family("pool_execution_seconds", "histogram", "Execution time of a sampled task.");
+        for (const auto& pool : pools) r.histogram(pool.first, pool.second.execution_time);
+        r.family("pool_cpu_seconds", "histogram", "CPU time used by a sampled task.");
+        for (const auto& pool : pools) r.histogram(pool.first, pool.second.cpu_time);
+    }
+
+    // Only for the pools counting them, see ThreadPool::set_perf_counters().
+    static const char* const counter_families[perf_event_count][2] = {
+        {"pool_cpu_cycles", "CPU cycles spent in tasks."},
+        {"pool_instructions", "Instructions retired by tasks."},
+        {"pool_cache_misses", "Cache misses of tasks."},
+        {"pool_context_switches", "Context switches while tasks ran."},
+    };
+    for (std::size_t i = 0; i < perf_event_count; i++)
+    {
+        auto event = static_cast<PerfEvent>(i);
+        auto counted = [event](const std::pair<std::string, PoolMetrics>& pool)
+        { return pool.second.counters.has(event); };
+        if (std::none_of(pools.begin(), pools.end(), counted)) continue;
+        r.family(counter_families[i][0], "counter", counter_families[i][1]);
+        for (const auto& pool : pools)
+            if (counted(pool)) r.sample(pool.first, pool.second.counters[event]);
+    }
+
+    using G = GraphMetrics;
+    write_family(r, graphs, "graph_runs", "counter", "Runs started.", [](const G& m) { return m.runs; });
+    write_family(r, graphs, "graph_failed_runs", "counter", "Runs stopped by an exception of a node.",
+                 [](const G& m) { return m.failed_runs; });
+    write_family(r, graphs, "graph_nodes_started", "counter", "Nodes started by the workers.",
+                 [](const G& m) { return m.nodes_started; });
+    write_family(r, graphs, "graph_nodes", "gauge", "Nodes in the graph at the last start.",
+                 [](const G& m) { return m.node_count; });
+    write_family(r, graphs, "graph_workers_live", "gauge", "Worker threads running.",
+                 [](const G& m) { return m.live_workers; });
+    write_family(r, graphs, "graph_workers_idle", "gauge", "Workers waiting for a ready node.",
+                 [](const G& m) { return m.idle_workers; });
+    write_family(r, graphs, "graph_executing", "gauge", "1 while a run is in progress.",
+                 [](const G& m) { return m.executing ? 1 : 0; });
+    write_family(r, graphs, "graph_last_makespan_seconds", "gauge", "Duration of the last profiled run.",
+                 [](const G& m) { return seconds(m.last_makespan); });
+    write_family(r, graphs, "graph_last_work_seconds", "gauge", "Sum of the node times of the last profiled run.",
+                 [](const G& m) { return seconds(m.last_work); });
+    write_family(r, graphs, "graph_last_span_seconds", "gauge", "Critical path length of the last profiled run.",
+                 [](const G& m) { return seconds(m.last_span); });
+    write_family(r, graphs, "graph_last_cpu_seconds", "gauge", "CPU time used by the nodes of the last profiled run.",
+                 [](const G& m) { return seconds(m.last_cpu_time); });
+    r.end();
+
+    if (!out) AT_RUNTIME_ERROR("Failed to write the metrics.");
+}
+
+std::string MetricsExporter::render() const
+{
+    std::ostringstream out;
+    write(out);
+    return out.str();
+}
+
+void MetricsExporter::write_file(const std::string& path) const
+{
+    std::string text = render();
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out << text;
+        out.close();
+        if (!out) AT_RUNTIME_ERROR("Failed to write " << temporary << ".");
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        int error = errno;
+        std::remove(temporary.c_str());
+        AT_RUNTIME_ERROR("Failed to rename " << temporary << " to " << path << ": " << std::strerror(error));
+    }
+}
+
+void MetricsExporter::start(Sink sink, std::chrono::milliseconds period /*= std::chrono::seconds(10)*/)
+{
+    std::lock_guard<std::mutex> lock(_thread_mutex);
+    if (_thread.joinable()) AT_RUNTIME_ERROR("Metrics exporter is already running.");
+
+    _stop = false;
+    _thread = std::thread(
+        [this, sink = std::move(sink), period]()
+        {
+            std::unique_lock<std::mutex> lk(_thread_mutex);
+            bool stop = false;
+            while (!stop)
+            {
+                stop = _stop_condition.wait_for(lk, period, [this]() { return _stop; });
+                lk.unlock();
+                sink(render());
+                lk.lock();
+            }
+        });
+}
+
+void MetricsExporter::stop()
+{
+    std::thread thread;
+    {
+        std::lock_guard<std::mutex> lock(_thread_mutex);
+        if (!_thread.joinable()) return;
+        _stop = true;
+        thread = std::move(_thread);
+    }
+    _stop_condition.notify_all();
+    thread.join();
+}
@@ -0,0 +1,125 @@
+//////////////////////////////////////////////////////////////////////////
+// Copyright 2026 Le Xuan Tuan Anh
+//
+// https://github.com/z-pc/athread
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef METRICSEXPORT_H__
+#define METRICSEXPORT_H__
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "metrics.h"
+#include "noncopyable.h"
+
+namespace at
+{
+class ThreadGraph;
+class ThreadPool;
+
+enum class MetricsFormat
+{
+    Prometheus,   // Prometheus text exposition format 0.0.4.
+    OpenMetrics,  // OpenMetrics 1.0 text format, ends with `# EOF`.
+};
+
+/**
+ * @class MetricsExporter
+ * @brief Renders the metrics of pools and graphs in the Prometheus or OpenMetrics text format.
+ *
+ * Pools and graphs are registered under a name, used as the `pool` or `graph` label of their samples. Rendering
+ * reads `ThreadPool::metrics()` and `ThreadGraph::metrics()`, it does not take any lock of the schedulers or
+ * stop their workers. The text goes to a stream, to a file that a node exporter or a sidecar scrapes, or to a
+ * callback, once or periodically from a background thread.
+ *
+ * Histograms are exported with the buckets 1us, 10us, ..., 10s. A value is counted in a bucket only when its
+ * whole histogram bucket is below the bound, so counts near a bound may land in the next bucket.
+ *
+ * Registered pools and graphs must outlive the exporter or be removed first.
+ */
+class MetricsExporter : public at::noncopyable_::noncopyable
+{
+public:
+    using Sink = std::function<void(const std::string&)>;
+
+    explicit MetricsExporter(MetricsFormat format = MetricsFormat::Prometheus, std::string prefix = "athread");
+    ~MetricsExporter();
+
+    /**
+     * @brief Registers a pool or a graph. Names should be unique, they tell the samples apart.
+     */
+    void add(const std::string& name, const ThreadPool& pool);
+    void add(const std::string& name, const ThreadGraph& graph);
+
+    /**
+     * @brief Unregisters every pool and graph registered under `name`.
+     */
+    void remove(const std::string& name);
+
+    std::string render() const;
+
+    /**
+     * @throws std::runtime_error if writing to `out` fails.
+     */
+    void write(std::ostream& out) const;
+
+    /**
+     * @brief Writes the metrics to `path.tmp`, then renames it to `path` so readers never see a partial file.
+     * @throws std::runtime_error if the file cannot be written or renamed.
+     */
+    void write_file(const std::string& path) const;
+
+    /**
+     * @brief Starts a thread passing `render()` to `sink` every `period`, and once more when stopped.
+     * @throws std::runtime_error if the exporter is already running.
+     */
+    void start(Sink sink, std::chrono::milliseconds period = std::chrono::seconds(10));
+
+    /**
+     * @brief Stops the thread started by `start()`. Does nothing if none is running.
+     */
+    void stop();
+
+private:
+    template <class Source>
+    struct Entry
+    {
+        std::string name;
+        const Source* source;
+    };
+
+    MetricsFormat _format;
+    std::string _prefix;
+
+    mutable std::mutex _sources_mutex;
+    std::vector<Entry<ThreadPool>> _pools;
+    std::vector<Entry<ThreadGraph>> _graphs;
+
+    std::mutex _thread_mutex;
+    std::condition_variable _stop_condition;
+    std::thread _thread;
+    bool _stop{false};
+};
+
+}  // namespace at
+
+#endif  // METRICSEXPORT_H__
@@ -19,10 +19,15 @@
 #ifndef NODE_H__
 #define NODE_H__
 
+#include <exception>
+#include <vector>
+
 #include "runnable.h"
 
 namespace at
 {
+class ThreadGraph;
+struct NodeTiming;
 
 /**
  * @class INode
@@ -38,6 +43,9 @@ class INode : public IRunnable
 {
     friend class Task;
     friend class ThreadGraph;
+    friend class GraphWorker;
+    friend class AsyncNode;
+    friend class GraphSnapshot;
 
 public:
     const std::vector<INode*>& predecessors() const { return _predecessors; }
@@ -47,8 +55,52 @@ protected:
     using IRunnable::IRunnable;
 
 private:
+    /**
+     * @brief Moves the node from `Executing` to `Completed` and releases its successors.
+     */
+    void complete_execution()
+    {
+        advance_state(std::memory_order_release);
+        for (INode* successor : _successors) successor->release_predecessor();
+    }
+
     std::vector<INode*> _predecessors;  ///< Set of predecessor nodes (dependencies).
     std::vector<INode*> _successors;    ///< Set of successor nodes (dependents).
+    ThreadGraph* _graph{nullptr};       ///< Graph that owns this node, set by ThreadGraph::push().
+    bool _deferred{false};              ///< Completion is signalled later instead of when execute() returns.
+    NodeTiming* _timing{nullptr};       ///< Where to record the run of the node when the graph is profiled.
+};
+
+/**
+ * @class AsyncNode
+ * @brief A node whose work finishes after `execute()` has returned.
+ *
+ * `execute()` only starts the work (for example submits an I/O request) and returns, so the worker
+ * is free to run other nodes. The node stays in the `Executing` state and its successors are held
+ * back until `complete()` or `fail()` is called, typically from a completion callback on another thread.
+ *
+ * @note Exactly one of `complete()` or `fail()` must be called for every execution.
+ */
+class AsyncNode : public INode
+{
+public:
+    /**
+     * @brief Marks the node as completed and wakes up the workers of the owning graph.
+     */
+    void complete();
+
+    /**
+     * @brief Marks the node as completed with an error.
+     *
+     * The owning graph stops scheduling new nodes and `ThreadGraph::wait()` rethrows the error
+     * as `std::runtime_error`.
+     *
+     * @param error The exception describing the failure.
+     */
+    void fail(std::exception_ptr error);
+
+protected:
+    AsyncNode() { _deferred = true; }
 };
 
 /**
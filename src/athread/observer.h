@@ -0,0 +1,71 @@
+//////////////////////////////////////////////////////////////////////////
+// Copyright 2026 Le Xuan Tuan Anh
+//
+// https://github.com/z-pc/athread
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef OBSERVER_H__
+#define OBSERVER_H__
+
+#include <cstdint>
+
+namespace at
+{
+
+/**
+ * @class Observer
+ * @brief Receives the scheduling events of a `ThreadPool` or a `ThreadGraph`, see `set_observer()`.
+ *
+ * Override the callbacks of interest, the others do nothing. Worker ids are the ones of `IWorker::id()`,
+ * `invalid_worker_id` when the thread is not a worker of the scheduler, task ids are `IRunnable::uid()`.
+ *
+ * Callbacks run on the thread causing the event, concurrently from several workers, and delay the scheduler
+ * while they run. They must not throw. `on_task_end()` follows every `on_task_begin()`, also for a task that
+ * throws. `on_steal()` is called with the queue lock of the pool held, so it must not push tasks to
+ * the same pool. Without an observer, each event point costs one load and an untaken branch.
+ *
+ * Graphs have no queue: nodes are not enqueued nor stolen, those callbacks are only called by pools.
+ */
+class Observer
+{
+public:
+    virtual ~Observer() = default;
+
+    virtual void on_worker_start(std::uint32_t /*worker_id*/) {}
+    virtual void on_worker_stop(std::uint32_t /*worker_id*/) {}
+
+    /**
+     * @brief A task was accepted by `ThreadPool::push()`, called before a worker can see it.
+     * @param worker_id The worker pushing the task, or `invalid_worker_id` for other threads.
+     */
+    virtual void on_task_enqueue(std::uint32_t /*worker_id*/, std::uint64_t /*task_id*/) {}
+
+    virtual void on_task_begin(std::uint32_t /*worker_id*/, std::uint64_t /*task_id*/) {}
+    virtual void on_task_end(std::uint32_t /*worker_id*/, std::uint64_t /*task_id*/) {}
+
+    /**
+     * @brief The worker found nothing to run and goes to sleep.
+     */
+    virtual void on_park(std::uint32_t /*worker_id*/) {}
+
+    /**
+     * @brief The worker took a task from the queue of another NUMA node.
+     */
+    virtual void on_steal(std::uint32_t /*worker_id*/, std::uint64_t /*task_id*/) {}
+};
+
+}  // namespace at
+
+#endif  // OBSERVER_H__
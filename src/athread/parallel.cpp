@@ -0,0 +1,34 @@
+#include "parallel.h"
+
+using namespace at;
+
+void TaskLatch::count_down(std::exception_ptr error)
+{
+    std::lock_guard<std::mutex> lk{_mutex};
+    if (error && !_error) _error = error;
+    if (--_remaining == 0) _condition.notify_all();
+}
+
+void TaskLatch::wait()
+{
+    std::unique_lock<std::mutex> lk{_mutex};
+    _condition.wait(lk, [this]() { return _remaining == 0; });
+    if (_error) std::rethrow_exception(_error);
+}
+
+void at::parallel_for(ThreadPool& pool, const MappedFile& file, std::size_t chunk_size, RecordFormat format,
+                      const std::function<void(std::string_view)>& fn)
+{
+    const std::vector<FileChunk> chunks = partition_records(file, chunk_size, format);
+
+    parallel_for(pool, std::size_t(0), chunks.size(),
+                 [&file, &chunks, &fn](std::size_t index)
+                 {
+                     const FileChunk& chunk = chunks[index];
+                     file.advise(chunk.offset, chunk.size, MappedFile::Advice::Sequential);
+                     if (index + 1 < chunks.size())
+                         file.advise(chunks[index + 1].offset, chunks[index + 1].size, MappedFile::Advice::WillNeed);
+
+                     fn(file.view(chunk.offset, chunk.size));
+                 });
+}
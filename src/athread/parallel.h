@@ -0,0 +1,132 @@
+//////////////////////////////////////////////////////////////////////////
+// Copyright 2026 Le Xuan Tuan Anh
+//
+// https://github.com/z-pc/athread
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef PARALLEL_H__
+#define PARALLEL_H__
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <type_traits>
+
+#include "diagnostics.h"
+#include "mappedfile.h"
+#include "threadpool.h"
+
+namespace at
+{
+
+/**
+ * @class TaskLatch
+ * @brief Counts down the tasks of a parallel loop and keeps the first exception they throw.
+ */
+class TaskLatch
+{
+public:
+    explicit TaskLatch(std::size_t count) : _remaining(count) {}
+
+    /**
+     * @brief Marks one task as finished, optionally with an error.
+     */
+    void count_down(std::exception_ptr error = nullptr);
+
+    /**
+     * @brief Blocks until all tasks are finished, then rethrows the first error if any.
+     */
+    void wait();
+
+private:
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    std::size_t _remaining;
+    std::exception_ptr _error;
+};
+
+/**
+ * @brief Runs `fn(i)` for every `i` in `[first, last)` on the workers of `pool` and waits for all of them.
+ *
+ * The range is split into tasks of `grain` consecutive indices. The first exception thrown by `fn`
+ * is rethrown to the caller once every task is finished.
+ *
+ * @note The pool must be able to execute tasks now (for example a `ThreadPoolFixed` must be started),
+ *       otherwise the call blocks forever.
+ * @throws std::runtime_error if the pool does not accept tasks.
+ */
+template <class Index, class Fn>
+void parallel_for(ThreadPool& pool, Index first, Index last, Fn&& fn, Index grain = 1)
+{
+    static_assert(std::is_integral<Index>::value, "parallel_for requires an integral index type");
+    if (grain <= 0) AT_INVALID_ARGUMENT("Grain size must be greater than zero.");
+    if (last <= first) return;
+
+    const std::size_t count = static_cast<std::size_t>((last - first + grain - 1) / grain);
+    auto latch = std::make_shared<TaskLatch>(count);
+
+    for (std::size_t task = 0; task < count; task++)
+    {
+        Index begin = static_cast<Index>(first + static_cast<Index>(task) * grain);
+        Index end = last - begin > grain ? static_cast<Index>(begin + grain) : last;
+
+        bool pushed = pool.push(
+            [latch, begin, end, &fn]()
+            {
+                try
+                {
+                    for (Index i = begin; i < end; ++i) fn(i);
+                    latch->count_down();
+                }
+                catch (...)
+                {
+                    latch->count_down(std::current_exception());
+                }
+            });
+
+        if (!pushed)
+        {
+            // Account for the tasks that will never run, then report once the pushed ones are done.
+            for (std::size_t skipped = task; skipped < count; skipped++)
+                latch->count_down(std::make_exception_ptr(std::runtime_error("Thread pool does not accept tasks.")));
+            break;
+        }
+    }
+
+    latch->wait();
+}
+
+/**
+ * @brief Processes a mapped file in parallel, one record-aligned chunk per task.
+ *
+ * The file is split with `partition_records()` and `fn` receives each chunk as a view into the mapping,
+ * so nothing is copied. Before a chunk is processed its range is advised as sequential and the following
+ * chunk is prefetched in the background.
+ *
+ * @param pool The pool executing the chunks.
+ * @param file The mapped file.
+ * @param chunk_size Approximate size of a chunk in bytes.
+ * @param format How records are delimited.
+ * @param fn Called once per chunk. Use `for_each_record()` to iterate the records of a chunk.
+ */
+void parallel_for(ThreadPool& pool, const MappedFile& file, std::size_t chunk_size, RecordFormat format,
+                  const std::function<void(std::string_view)>& fn);
+
+}  // namespace at
+
+#endif  // PARALLEL_H__
@@ -0,0 +1,194 @@
+#include "perfcounters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define AT_PERF_RDPMC
+#endif
+#endif
+
+using namespace at;
+
+namespace
+{
+thread_local PerfCounters* thread_counters = nullptr;
+
+#ifdef __linux__
+struct EventSpec
+{
+    std::uint32_t type;
+    std::uint64_t config;
+};
+
+// In the order of PerfEvent.
+constexpr EventSpec event_specs[perf_event_count] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+};
+
+int open_event(const EventSpec& spec)
+{
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = spec.type;
+    attr.config = spec.config;
+    // Context switches happen in the kernel, the other events are counted in user space only, which the
+    // default perf_event_paranoid allows.
+    attr.exclude_kernel = spec.type == PERF_TYPE_SOFTWARE ? 0 : 1;
+    attr.exclude_hv = 1;
+    // The calling thread on any CPU.
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+}
+
+std::uint64_t rusage_context_switches()
+{
+    rusage usage;
+    if (getrusage(RUSAGE_THREAD, &usage) != 0) return 0;
+    return static_cast<std::uint64_t>(usage.ru_nvcsw) + static_cast<std::uint64_t>(usage.ru_nivcsw);
+}
+
+#ifdef AT_PERF_RDPMC
+std::uint64_t rdpmc(std::uint32_t counter)
+{
+    std::uint32_t low, high;
+    asm volatile("rdpmc" : "=a"(low), "=d"(high) : "c"(counter));
+    return (static_cast<std::uint64_t>(high) << 32) | low;
+}
+
+// Reads the counter from user space, see the description of perf_event_mmap_page in linux/perf_event.h.
+// Returns false when the event is not scheduled on this CPU right now, read() is used instead.
+bool read_mapped(const void* mapping, std::uint64_t& value)
+{
+    auto page = static_cast<const volatile perf_event_mmap_page*>(mapping);
+    std::uint32_t sequence;
+    bool scheduled;
+    do
+    {
+        sequence = page->lock;
+        std::atomic_signal_fence(std::memory_order_acquire);
+        std::uint32_t index = page->index;
+        std::int64_t count = page->offset;
+        scheduled = page->cap_user_rdpmc && index != 0;
+        if (scheduled)
+        {
+            unsigned shift = 64 - page->pmc_width;
+            count += static_cast<std::int64_t>(rdpmc(index - 1) << shift) >> shift;
+        }
+        value = static_cast<std::uint64_t>(count);
+        std::atomic_signal_fence(std::memory_order_acquire);
+    } while (page->lock != sequence);
+    return scheduled;
+}
+#endif
+#endif
+}  // namespace
+
+double PerfCounts::ipc() const
+{
+    if (!has(PerfEvent::Cycles) || !has(PerfEvent::Instructions) || cycles() == 0) return 0.0;
+    return static_cast<double>(instructions()) / static_cast<double>(cycles());
+}
+
+PerfCounts& PerfCounts::operator+=(const PerfCounts& other)
+{
+    for (std::size_t i = 0; i < perf_event_count; i++) values[i] += other.values[i];
+    valid |= other.valid;
+    return *this;
+}
+
+PerfCounts PerfCounts::operator-(const PerfCounts& before) const
+{
+    PerfCounts delta;
+    delta.valid = valid & before.valid;
+    for (std::size_t i = 0; i < perf_event_count; i++)
+        if ((delta.valid >> i) & 1u) delta.values[i] = values[i] - before.values[i];
+    return delta;
+}
+
+PerfCounters::PerfCounters()
+{
+    _fds.fill(-1);
+    _pages.fill(nullptr);
+#ifdef __linux__
+    for (std::size_t i = 0; i < perf_event_count; i++)
+    {
+        _fds[i] = open_event(event_specs[i]);
+        if (_fds[i] < 0)
+        {
+            // Counting kernel events is not allowed, the thread's resource usage has the context switches.
+            if (static_cast<PerfEvent>(i) == PerfEvent::ContextSwitches) _available |= 1u << i;
+            continue;
+        }
+        _available |= 1u << i;
+
+#ifdef AT_PERF_RDPMC
+        if (event_specs[i].type == PERF_TYPE_HARDWARE)
+        {
+            void* page = mmap(nullptr, static_cast<std::size_t>(sysconf(_SC_PAGESIZE)), PROT_READ, MAP_SHARED,
+                              _fds[i], 0);
+            if (page != MAP_FAILED && static_cast<perf_event_mmap_page*>(page)->cap_user_rdpmc)
+                _pages[i] = page;
+            else if (page != MAP_FAILED)
+                munmap(page, static_cast<std::size_t>(sysconf(_SC_PAGESIZE)));
+        }
+#endif
+    }
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+    for (std::size_t i = 0; i < perf_event_count; i++)
+    {
+        if (_pages[i]) munmap(_pages[i], static_cast<std::size_t>(sysconf(_SC_PAGESIZE)));
+        if (_fds[i] >= 0) close(_fds[i]);
+    }
+#endif
+    if (thread_counters == this) thread_counters = nullptr;
+}
+
+PerfCounters& PerfCounters::thread()
+{
+    thread_local PerfCounters counters;
+    thread_counters = &counters;
+    return counters;
+}
+
+PerfCounters* PerfCounters::opened() { return thread_counters; }
+
+PerfCounts PerfCounters::read() const
+{
+    PerfCounts counts;
+    counts.valid = _available;
+#ifdef __linux__
+    for (std::size_t i = 0; i < perf_event_count; i++)
+    {
+        if (_fds[i] < 0)
+        {
+            if ((_available >> i) & 1u) counts.values[i] = rusage_context_switches();
+            continue;
+        }
+#ifdef AT_PERF_RDPMC
+        if (_pages[i] && read_mapped(_pages[i], counts.values[i])) continue;
+#endif
+        if (::read(_fds[i], &counts.values[i], sizeof(std::uint64_t)) != sizeof(std::uint64_t))
+        {
+            counts.values[i] = 0;
+            counts.valid &= ~(1u << i);
+        }
+    }
+#endif
+    return counts;
+}
@@ -0,0 +1,117 @@
+//////////////////////////////////////////////////////////////////////////
+// Copyright 2026 Le Xuan Tuan Anh
+//
+// https://github.com/z-pc/athread
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef PERFCOUNTERS_H__
+#define PERFCOUNTERS_H__
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "noncopyable.h"
+
+namespace at
+{
+
+/**
+ * @enum PerfEvent
+ * @brief Events counted by `PerfCounters`, indexes of `PerfCounts::values`.
+ */
+enum class PerfEvent : std::uint8_t
+{
+    Cycles,
+    Instructions,
+    CacheMisses,
+    ContextSwitches,
+};
+
+constexpr std::size_t perf_event_count = 4;
+
+/**
+ * @struct PerfCounts
+ * @brief Values of the counters of a thread, or their difference over an interval.
+ *
+ * `valid` has the bit `1 << PerfEvent` set for each event that could be counted, the others read 0.
+ */
+struct PerfCounts
+{
+    std::array<std::uint64_t, perf_event_count> values{};
+    std::uint32_t valid{0};
+
+    std::uint64_t operator[](PerfEvent event) const { return values[static_cast<std::size_t>(event)]; }
+    bool has(PerfEvent event) const { return (valid >> static_cast<unsigned>(event)) & 1u; }
+
+    std::uint64_t cycles() const { return (*this)[PerfEvent::Cycles]; }
+    std::uint64_t instructions() const { return (*this)[PerfEvent::Instructions]; }
+    std::uint64_t cache_misses() const { return (*this)[PerfEvent::CacheMisses]; }
+    std::uint64_t context_switches() const { return (*this)[PerfEvent::ContextSwitches]; }
+
+    /**
+     * @brief Instructions per cycle, 0 when either is not counted.
+     */
+    double ipc() const;
+
+    PerfCounts& operator+=(const PerfCounts& other);
+    PerfCounts operator-(const PerfCounts& before) const;
+};
+
+/**
+ * @class PerfCounters
+ * @brief Counters of cycles, instructions, cache misses and context switches of the calling thread.
+ *
+ * On Linux the counters are opened with `perf_event_open`, user space only, so they work with the default
+ * `perf_event_paranoid` setting. On x86, hardware counters are read with `rdpmc` when the kernel allows it,
+ * otherwise with `read()`. Events that cannot be opened (no PMU in a virtual machine, no permission, another
+ * platform) are left out of `available()` and read as 0, nothing fails. When the kernel does not allow counting
+ * context switches, they are taken from `getrusage(RUSAGE_THREAD)`.
+ */
+class PerfCounters : public at::noncopyable_::noncopyable
+{
+public:
+    /**
+     * @brief Returns the counters of the calling thread, opened on the first call and closed when the thread
+     * exits.
+     */
+    static PerfCounters& thread();
+
+    /**
+     * @brief Returns the counters of the calling thread if `thread()` was already called on it, nullptr
+     * otherwise.
+     */
+    static PerfCounters* opened();
+
+    ~PerfCounters();
+
+    /**
+     * @brief Returns the mask of the events that could be opened, see `PerfCounts::valid`.
+     */
+    std::uint32_t available() const { return _available; }
+
+    PerfCounts read() const;
+
+private:
+    PerfCounters();
+
+    std::array<int, perf_event_count> _fds;
+    std::array<void*, perf_event_count> _pages;  // Mapped for rdpmc, nullptr when not usable.
+    std::uint32_t _available{0};
+};
+
+}  // namespace at
+
+#endif  // PERFCOUNTERS_H__
@@ -0,0 +1,29 @@
+#include "runnable.h"
+
+#include <mutex>
+#include <unordered_set>
+
+std::uint64_t at::next_task_uid()
+{
+    constexpr std::uint64_t block_size = 1024;
+    static std::atomic<std::uint64_t> next_block{1};
+
+    thread_local std::uint64_t next = 0;
+    thread_local std::uint64_t end = 0;
+    if (next == end)
+    {
+        next = next_block.fetch_add(block_size, std::memory_order_relaxed);
+        end = next + block_size;
+    }
+    return next++;
+}
+
+const char* at::intern_label(std::string_view label)
+{
+    // Never destroyed, labels may be read while static objects are torn down.
+    static std::mutex* mutex = new std::mutex();
+    static std::unordered_set<std::string>* labels = new std::unordered_set<std::string>();
+
+    std::lock_guard<std::mutex> lock(*mutex);
+    return labels->emplace(label).first->c_str();
+}
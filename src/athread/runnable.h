@@ -20,14 +20,32 @@
 #define RUNNABLE_H__
 
 #include <atomic>
+#include <cstdint>
 #include <functional>
-#include <sstream>
 #include <string>
+#include <string_view>
 #include <unordered_set>
 
+#include "cacheline.h"
+
 namespace at
 {
 
+/**
+ * @brief Returns a new task id. Ids start at 1 and are never reused during the life of the process.
+ *
+ * Each thread takes ids from its own block, so creating tasks from many threads does not contend on a
+ * shared counter. Ids are increasing for the tasks created by one thread.
+ */
+std::uint64_t next_task_uid();
+
+/**
+ * @brief Returns a copy of `label` that lives until the end of the process.
+ *
+ * Equal strings give the same pointer, so a label is stored once however many tasks use it.
+ */
+const char* intern_label(std::string_view label);
+
 /**
  * @class IRunnable
  * @brief Abstract interface for runnable tasks in a thread pool.
@@ -46,6 +64,7 @@ class IRunnable
     friend class ThreadSeasonalWorker;
     friend class ThreadGraph;
     friend class INode;
+    friend class AsyncNode;
     friend class Task;
 
 public:
@@ -69,7 +88,7 @@ public:
      *
      * Initializes the task state to `STATE::READY`.
      */
-    IRunnable() { _state = RunnableState::Ready; };
+    IRunnable() : _uid(next_task_uid()), _state(pack(RunnableState::Ready, 0, 0)) {};
 
     /**
      * @brief Virtual destructor.
@@ -83,11 +102,38 @@ public:
      *
      * @return The current state of the task as an integer (`STATE` enum value).
      */
-    int state() const { return _state.load(); }
+    int state() const { return unpack_state(_state.load(std::memory_order_acquire)); }
+
+    /**
+     * @brief Returns the number of predecessors not completed yet in the current run of a graph.
+     *
+     * Always 0 for tasks of a thread pool.
+     */
+    std::uint32_t pending() const { return unpack_pending(_state.load(std::memory_order_acquire)); }
+
+    /**
+     * @brief Returns how many times the owning graph has started a run including this task.
+     */
+    std::uint32_t epoch() const { return unpack_epoch(_state.load(std::memory_order_acquire)); }
+
+    /**
+     * @brief Returns the numeric id of the task, unique in the process and assigned at construction.
+     */
+    std::uint64_t uid() const { return _uid; }
+
+    /**
+     * @brief Returns the label of the task, or nullptr if none was set.
+     */
+    const char* label() const { return _label; }
+
+    /**
+     * @brief Sets a label shown in diagnostics. The string is interned, see `intern_label()`.
+     */
+    void set_label(std::string_view label) { _label = label.empty() ? nullptr : intern_label(label); }
 
     /**
      * @brief Get identify of a runnable.
-     * @return The indentify string. Memory location as string is default.
+     * @return The label if set, otherwise `#` followed by the numeric id.
      */
     virtual std::string id() const;
 
@@ -104,16 +150,89 @@ protected:
     virtual void execute() = 0;
 
 private:
-    virtual void set_state(int state) { _state.store(state); };
+    // The state, the pending predecessor count and the epoch share one atomic word, so a transition is a
+    // single read-modify-write and readers see the three fields consistently:
+    //   bits  0..7   state
+    //   bits  8..39  pending predecessors
+    //   bits 40..63  epoch
+    static constexpr std::uint64_t state_mask = 0xff;
+    static constexpr int pending_shift = 8;
+    static constexpr std::uint64_t pending_unit = std::uint64_t(1) << pending_shift;
+    static constexpr std::uint64_t pending_mask = std::uint64_t(0xffffffff) << pending_shift;
+    static constexpr int epoch_shift = 40;
+    static constexpr std::uint64_t epoch_mask = std::uint64_t(0xffffff);
+
+    static constexpr std::uint64_t pack(int state, std::uint32_t pending, std::uint32_t epoch)
+    {
+        return (static_cast<std::uint64_t>(state) & state_mask) | (static_cast<std::uint64_t>(pending) << pending_shift) |
+               ((static_cast<std::uint64_t>(epoch) & epoch_mask) << epoch_shift);
+    }
+    static constexpr int unpack_state(std::uint64_t word) { return static_cast<int>(word & state_mask); }
+    static constexpr std::uint32_t unpack_pending(std::uint64_t word)
+    {
+        return static_cast<std::uint32_t>((word & pending_mask) >> pending_shift);
+    }
+    static constexpr std::uint32_t unpack_epoch(std::uint64_t word)
+    {
+        return static_cast<std::uint32_t>(word >> epoch_shift);
+    }
+
+    /**
+     * @brief Replaces the state, keeping the pending count and the epoch.
+     *
+     * Release ordering: whoever observes the new state also observes the writes made before it,
+     * in particular the side effects of `execute()` when the new state is `Completed`.
+     */
+    virtual void set_state(int state)
+    {
+        std::uint64_t word = _state.load(std::memory_order_relaxed);
+        while (!_state.compare_exchange_weak(word, (word & ~state_mask) | static_cast<std::uint64_t>(state),
+                                             std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+    };
+
+    /**
+     * @brief Moves to the next state in Ready -> Executing -> Completed with a single atomic add.
+     * @param order Release when other threads must see the writes made before the transition.
+     */
+    void advance_state(std::memory_order order) { _state.fetch_add(1, order); }
+
+    /**
+     * @brief Starts a new run: state `Ready`, `pending` predecessors to wait for and the next epoch.
+     *
+     * Relaxed, the graph arms its nodes before waking the workers, which publishes the stores.
+     */
+    void arm(std::uint32_t pending)
+    {
+        std::uint32_t epoch = unpack_epoch(_state.load(std::memory_order_relaxed)) + 1;
+        _state.store(pack(RunnableState::Ready, pending, epoch), std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Records that one predecessor has completed.
+     * @return true if it was the last pending predecessor.
+     */
+    bool release_predecessor()
+    {
+        std::uint64_t word = _state.load(std::memory_order_relaxed);
+        do
+        {
+            if (unpack_pending(word) == 0) return false;  // Edge added after the run was armed.
+        } while (!_state.compare_exchange_weak(word, word - pending_unit, std::memory_order_acq_rel,
+                                               std::memory_order_relaxed));
+        return unpack_pending(word) == 1;
+    }
 
-    std::atomic_int _state;  // Atomic variable to track the state of the task.
+    const std::uint64_t _uid;                               // Numeric id, see next_task_uid().
+    const char* _label{nullptr};                            // Interned label or nullptr.
+    AT_TASK_STATE_ALIGN std::atomic<std::uint64_t> _state;  // Packed state word, see above.
 };
 
 inline std::string IRunnable::id() const
 {
-    std::ostringstream oss;
-    oss << static_cast<const void*>(this);
-    return oss.str();
+    if (_label) return _label;
+    return "#" + std::to_string(_uid);
 }
 
 inline std::string IRunnable::state_to_string(int state)
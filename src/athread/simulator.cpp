@@ -0,0 +1,322 @@
+#include "simulator.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+
+#include "diagnostics.h"
+#include "node.h"
+#include "threadgraph.h"
+
+using namespace at;
+
+namespace
+{
+constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+
+enum class NodeState : std::uint8_t
+{
+    Ready,  // Not started, as `INode::Ready`.
+    Executing,
+    Completed,
+};
+
+using Pick = std::pair<TraceNodeState, std::size_t>;
+
+/**
+ * @brief The scheduling state of one simulated run. `depend()` and `ready_node()` follow
+ * `ThreadGraph::trace_ready_depend()` and `ThreadGraph::trace_ready_node()` on node indices.
+ */
+class Replay
+{
+public:
+    Replay(const std::vector<std::vector<std::size_t>>& predecessors,
+           const std::vector<std::vector<std::size_t>>& successors)
+        : _predecessors(predecessors),
+          _successors(successors),
+          _state(predecessors.size(), NodeState::Ready),
+          _pending(predecessors.size(), 0),
+          _visited(predecessors.size(), 0)
+    {
+        for (std::size_t i = 0; i < predecessors.size(); i++)
+            _pending[i] = static_cast<std::uint32_t>(predecessors[i].size());
+    }
+
+    void started(std::size_t node) { _state[node] = NodeState::Executing; }
+
+    void completed(std::size_t node)
+    {
+        _state[node] = NodeState::Completed;
+        for (std::size_t successor : _successors[node]) _pending[successor]--;
+    }
+
+    Pick ready_node(std::size_t entry)
+    {
+        if (entry == none)
+        {
+            while (_cursor < _state.size() && _state[_cursor] != NodeState::Ready) ++_cursor;
+            if (_cursor < _state.size()) return depend(_cursor);
+
+            for (std::size_t i = 0; i < _state.size(); i++)
+                if (_state[i] == NodeState::Executing) return Pick(TraceNodeState::Pending, i);
+        }
+        else if (_state[entry] == NodeState::Executing)
+        {
+            for (std::size_t successor : _successors[entry])
+            {
+                if (_state[successor] != NodeState::Ready) continue;
+                Pick pick = depend(successor);
+                if (pick.first == TraceNodeState::Ready) return pick;
+            }
+            Pick next = ready_node(none);
+            if (next.first == TraceNodeState::Ready) return next;
+            return Pick(TraceNodeState::Pending, entry);
+        }
+        else if (_state[entry] == NodeState::Ready)
+        {
+            Pick pick = depend(entry);
+            if (pick.first == TraceNodeState::Ready) return pick;
+            if (pick.first == TraceNodeState::Pending)
+            {
+                Pick next = ready_node(none);
+                if (next.first == TraceNodeState::Ready) return next;
+                return pick;
+            }
+        }
+        else
+        {
+            Pick delay(TraceNodeState::Pending, none);
+            for (std::size_t successor : _successors[entry])
+            {
+                if (_state[successor] != NodeState::Ready) continue;
+                Pick pick = depend(successor);
+                if (pick.first == TraceNodeState::Ready) return pick;
+                if (pick.first == TraceNodeState::Pending) delay = pick;
+            }
+            Pick next = ready_node(none);
+            if (next.first == TraceNodeState::Ready) return next;
+            if (delay.second != none) return delay;
+            if (next.first == TraceNodeState::Pending) return next;
+        }
+        return Pick(TraceNodeState::Completed, none);
+    }
+
+private:
+    Pick depend(std::size_t node)
+    {
+        ++_stamp;
+        return depend_from(node);
+    }
+
+    // Unlike the scheduler, the walk visits every ancestor once, so that it stays linear on diamonds.
+    Pick depend_from(std::size_t node)
+    {
+        if (_state[node] == NodeState::Executing) return Pick(TraceNodeState::Pending, node);
+        if (_state[node] == NodeState::Completed) return Pick(TraceNodeState::Completed, node);
+        if (_pending[node] == 0) return Pick(TraceNodeState::Ready, node);
+
+        _visited[node] = _stamp;
+        Pick waiting(TraceNodeState::Pending, none);
+        for (std::size_t predecessor : _predecessors[node])
+        {
+            if (_visited[predecessor] == _stamp) continue;
+            if (_state[predecessor] == NodeState::Ready)
+            {
+                Pick pick = depend_from(predecessor);
+                if (pick.first == TraceNodeState::Ready) return pick;
+                if (pick.first == TraceNodeState::Pending) waiting = pick;
+            }
+            else if (_state[predecessor] == NodeState::Executing)
+            {
+                waiting = Pick(TraceNodeState::Pending, predecessor);
+            }
+        }
+        return waiting.second != none ? waiting : Pick(TraceNodeState::Ready, node);
+    }
+
+    const std::vector<std::vector<std::size_t>>& _predecessors;
+    const std::vector<std::vector<std::size_t>>& _successors;
+    std::vector<NodeState> _state;
+    std::vector<std::uint32_t> _pending;  // Predecessors not completed yet.
+    std::vector<std::uint32_t> _visited;  // Stamp of the last walk through the node.
+    std::uint32_t _stamp{0};
+    std::size_t _cursor{0};  // First node in the order of the graph that may not have started.
+};
+
+struct VirtualWorker
+{
+    std::size_t entry{none};    // Node the next look up starts from.
+    std::size_t running{none};  // Node executing, until its end event.
+    bool exited{false};
+};
+}  // namespace
+
+double SimulatedSchedule::utilization(std::uint32_t worker) const
+{
+    if (worker >= busy.size() || profile.makespan.count() <= 0) return 0.0;
+    return static_cast<double>(busy[worker].count()) / static_cast<double>(profile.makespan.count());
+}
+
+double SimulatedSchedule::utilization() const
+{
+    if (busy.empty() || profile.makespan.count() <= 0) return 0.0;
+    return static_cast<double>(profile.work.count()) /
+           (static_cast<double>(profile.makespan.count()) * static_cast<double>(busy.size()));
+}
+
+ScheduleSimulator::ScheduleSimulator(const ThreadGraph& graph)
+    : _tasks(graph._task_pool), _max_workers(graph.optimized_threads() ? graph.width() : UINT32_MAX)
+{
+    const std::size_t count = _tasks.size();
+    std::unordered_map<const INode*, std::size_t> index_of;
+    index_of.reserve(count);
+    for (std::size_t i = 0; i < count; i++)
+    {
+        index_of[_tasks[i]] = i;
+        _index_of[_tasks[i]->uid()] = i;
+    }
+
+    // Edges to nodes outside of the graph are ignored, as by the profile.
+    _predecessors.resize(count);
+    _successors.resize(count);
+    for (std::size_t i = 0; i < count; i++)
+    {
+        for (const INode* predecessor : _tasks[i]->predecessors())
+        {
+            auto it = index_of.find(predecessor);
+            if (it != index_of.end()) _predecessors[i].push_back(it->second);
+        }
+        for (const INode* successor : _tasks[i]->successors())
+        {
+            auto it = index_of.find(successor);
+            if (it != index_of.end()) _successors[i].push_back(it->second);
+        }
+    }
+    _costs.assign(count, std::chrono::nanoseconds(-1));
+}
+
+void ScheduleSimulator::set_cost(const Task& task, std::chrono::nanoseconds cost)
+{
+    if (cost.count() < 0) AT_INVALID_ARGUMENT("Cost must not be negative.");
+    auto it = task.empty() ? _index_of.end() : _index_of.find(task.uid());
+    if (it == _index_of.end()) AT_INVALID_ARGUMENT("Task is not a node of the simulated graph.");
+    _costs[it->second] = cost;
+}
+
+std::size_t ScheduleSimulator::set_costs(const GraphProfile& profile)
+{
+    std::size_t matched = 0;
+    for (const auto& node : profile.nodes)
+    {
+        if (!node.executed) continue;
+        auto it = _index_of.find(node.uid);
+        if (it == _index_of.end()) continue;
+        _costs[it->second] = std::max(node.wall_time(), std::chrono::nanoseconds(0));
+        matched++;
+    }
+    return matched;
+}
+
+std::chrono::nanoseconds ScheduleSimulator::cost_of(std::size_t index) const
+{
+    return _costs[index].count() >= 0 ? _costs[index] : _default_cost;
+}
+
+SimulatedSchedule ScheduleSimulator::run(std::uint32_t thread_count) const
+{
+    if (thread_count == 0) AT_INVALID_ARGUMENT("Thread count must be greater than zero.");
+
+    const std::size_t count = _tasks.size();
+    const std::uint32_t worker_count = std::min(thread_count, _max_workers);
+
+    SimulatedSchedule schedule;
+    schedule.busy.assign(worker_count, std::chrono::nanoseconds(0));
+
+    // Timestamps on a virtual trace clock starting at 1, since a start of 0 means not executed.
+    constexpr std::uint64_t origin = 1;
+    std::vector<NodeTiming> timings(count);
+    Replay replay(_predecessors, _successors);
+    std::vector<VirtualWorker> workers(worker_count);
+    using Event = std::pair<std::uint64_t, std::uint32_t>;  // End of the running node, worker.
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+    std::uint64_t now = origin;
+
+    auto dispatch = [&](std::uint32_t id)
+    {
+        VirtualWorker& worker = workers[id];
+        Pick pick = replay.ready_node(worker.entry);
+        if (pick.first == TraceNodeState::Ready)
+        {
+            std::size_t node = pick.second;
+            replay.started(node);
+            std::uint64_t cost = static_cast<std::uint64_t>(cost_of(node).count());
+            NodeTiming& timing = timings[node];
+            timing.worker = id;
+            timing.start = now + static_cast<std::uint64_t>(_dispatch_overhead.count());
+            timing.finish = timing.start + cost;
+            timing.cpu_time = cost;
+            schedule.busy[id] += std::chrono::nanoseconds(cost);
+            worker.entry = node;
+            worker.running = node;
+            events.push(Event(timing.finish, id));
+        }
+        else if (pick.first == TraceNodeState::Pending)
+        {
+            worker.entry = pick.second;
+        }
+        else
+        {
+            worker.exited = true;
+        }
+    };
+
+    for (std::uint32_t id = 0; id < worker_count; id++) dispatch(id);
+
+    std::vector<std::uint32_t> finished;
+    std::vector<bool> just_finished(worker_count, false);
+    while (!events.empty())
+    {
+        // Every node ending at the same time completes before any worker looks for the next one.
+        now = events.top().first;
+        finished.clear();
+        while (!events.empty() && events.top().first == now)
+        {
+            std::uint32_t id = events.top().second;
+            events.pop();
+            replay.completed(workers[id].running);
+            workers[id].running = none;
+            finished.push_back(id);
+            just_finished[id] = true;
+        }
+
+        // The finishing workers go on from their node, then the parked ones are woken in the order of their ids.
+        for (std::uint32_t id : finished) dispatch(id);
+        for (std::uint32_t id = 0; id < worker_count; id++)
+        {
+            if (!just_finished[id] && !workers[id].exited && workers[id].running == none) dispatch(id);
+        }
+        for (std::uint32_t id : finished) just_finished[id] = false;
+    }
+
+    schedule.profile = GraphProfile::build(_tasks, timings, origin, worker_count);
+    return schedule;
+}
+
+std::uint32_t ScheduleSimulator::suggest_thread_count(std::uint32_t max_thread_count,
+                                                      double tolerance /*= 0.05*/) const
+{
+    if (max_thread_count == 0) AT_INVALID_ARGUMENT("Thread count must be greater than zero.");
+    max_thread_count = std::max<std::uint32_t>(std::min(max_thread_count, _max_workers), 1);
+
+    std::vector<std::chrono::nanoseconds> makespans;
+    for (std::uint32_t threads = 1; threads <= max_thread_count; threads++)
+        makespans.push_back(run(threads).profile.makespan);
+
+    double limit = static_cast<double>(std::min_element(makespans.begin(), makespans.end())->count()) * (1 + tolerance);
+    for (std::uint32_t threads = 1; threads <= max_thread_count; threads++)
+        if (static_cast<double>(makespans[threads - 1].count()) <= limit) return threads;
+    return max_thread_count;
+}
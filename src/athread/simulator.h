@@ -0,0 +1,127 @@
+//////////////////////////////////////////////////////////////////////////
+// Copyright 2026 Le Xuan Tuan Anh
+//
+// https://github.com/z-pc/athread
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef SIMULATOR_H__
+#define SIMULATOR_H__
+
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "graphprofile.h"
+
+namespace at
+{
+class ThreadGraph;
+class Task;
+
+/**
+ * @struct SimulatedSchedule
+ * @brief Predicted run of a graph, see `ScheduleSimulator::run()`.
+ *
+ * `profile` holds the predicted timings in the form of a profiled run: makespan, work, span, critical path and
+ * the start, end and worker of every node. Nodes are assumed to spend their whole cost on the CPU.
+ */
+struct SimulatedSchedule
+{
+    GraphProfile profile;
+    std::vector<std::chrono::nanoseconds> busy;  // Time each virtual worker spent running nodes.
+
+    /**
+     * @brief Returns the share of the makespan worker `worker` spent running nodes, 0 to 1.
+     */
+    double utilization(std::uint32_t worker) const;
+
+    /**
+     * @brief Returns the mean utilization of the workers, work / (makespan * workers).
+     */
+    double utilization() const;
+};
+
+/**
+ * @class ScheduleSimulator
+ * @brief Predicts the makespan of a `ThreadGraph` on a given number of workers without running its nodes.
+ *
+ * The simulator replays the policy of the graph workers on a virtual clock, in a single thread and
+ * deterministically: a worker finishing a node first looks for a ready node among the successors of that
+ * node, then among the ancestors of the first node not started yet in the order of the graph; a worker
+ * finding none waits for the node it was given back and looks again from it when a node completes. Parked
+ * workers are served in the order of their ids. The cost of a node is the estimate given by `set_cost()`,
+ * the wall time of a previous profiled run given to `set_costs()`, or the default cost.
+ *
+ * The topology is copied by the constructor; the graph must not be destroyed while the simulator is used,
+ * and nodes pushed later are not seen.
+ */
+class ScheduleSimulator
+{
+public:
+    explicit ScheduleSimulator(const ThreadGraph& graph);
+
+    /**
+     * @brief Sets the estimated duration of `task`.
+     * @throws std::invalid_argument if the task is not a node of the graph or the cost is negative.
+     */
+    void set_cost(const Task& task, std::chrono::nanoseconds cost);
+
+    /**
+     * @brief Takes the wall times of the nodes executed in `profile`, matched by uid, as their costs.
+     * @return The number of nodes whose cost was set.
+     */
+    std::size_t set_costs(const GraphProfile& profile);
+
+    /**
+     * @brief Sets the cost of the nodes without an estimate. Default is one microsecond.
+     */
+    void set_default_cost(std::chrono::nanoseconds cost) { _default_cost = cost; }
+
+    /**
+     * @brief Sets the time between a worker picking a node and the node starting, the scheduling cost paid
+     * once per node. Default is 0.
+     */
+    void set_dispatch_overhead(std::chrono::nanoseconds overhead) { _dispatch_overhead = overhead; }
+
+    /**
+     * @brief Simulates a run on `thread_count` workers, capped at `ThreadGraph::width()` when the graph
+     * optimizes its threads like `ThreadGraph::start()` does.
+     * @throws std::invalid_argument if `thread_count` is 0.
+     */
+    SimulatedSchedule run(std::uint32_t thread_count) const;
+
+    /**
+     * @brief Returns the smallest thread count, up to `max_thread_count`, whose predicted makespan is within
+     * `tolerance` of the shortest one.
+     */
+    std::uint32_t suggest_thread_count(std::uint32_t max_thread_count, double tolerance = 0.05) const;
+
+private:
+    std::chrono::nanoseconds cost_of(std::size_t index) const;
+
+    std::vector<INode*> _tasks;  // In the order of the graph.
+    std::vector<std::vector<std::size_t>> _predecessors;
+    std::vector<std::vector<std::size_t>> _successors;
+    std::unordered_map<std::uint64_t, std::size_t> _index_of;  // By uid.
+    std::vector<std::chrono::nanoseconds> _costs;              // Negative without an estimate.
+    std::chrono::nanoseconds _default_cost{std::chrono::microseconds(1)};
+    std::chrono::nanoseconds _dispatch_overhead{0};
+    std::uint32_t _max_workers;  // Width of the graph if it optimizes its threads, no limit otherwise.
+};
+
+}  // namespace at
+
+#endif  // SIMULATOR_H__
@@ -18,13 +18,14 @@ Task& at::Task::depend(const Task& t)
         t._node->_predecessors.end())
         AT_RUNTIME_ERROR("Circular dependency detected");
 
+    // The two lists mirror each other, so the predecessors of this node tell whether the edge exists. That keeps a
+    // wide fan-out linear to build, a wide fan-in still scans a growing list per edge and stays quadratic.
     if (std::find(_node->_predecessors.begin(), _node->_predecessors.end(), t._node) == _node->_predecessors.end())
     {
         _node->_predecessors.push_back(t._node);
-    }
-    if (std::find(t._node->_successors.begin(), t._node->_successors.end(), this->_node) == t._node->_successors.end())
-    {
         t._node->_successors.push_back(this->_node);
+        topology_changed(_node);
+        topology_changed(t._node);
     }
 
     return *this;
@@ -58,6 +59,8 @@ Task& Task::erase_depend(const Task& other)
         other._node->_successors.erase(
             std::remove(other._node->_successors.begin(), other._node->_successors.end(), _node),
             other._node->_successors.end());
+        topology_changed(_node);
+        topology_changed(other._node);
     }
     return *this;
 }
@@ -80,6 +83,8 @@ Task& Task::erase_precede(const Task& other)
         other._node->_predecessors.erase(
             std::remove(other._node->_predecessors.begin(), other._node->_predecessors.end(), _node),
             other._node->_predecessors.end());
+        topology_changed(_node);
+        topology_changed(other._node);
     }
     return *this;
 }
@@ -97,6 +102,18 @@ bool Task::operator!=(const Task& other) const { return _node != other._node; }
 
 bool Task::operator==(const Task& other) const { return _node == other._node; }
 
+Task& Task::set_label(std::string_view label)
+{
+    if (_node == nullptr) AT_INVALID_ARGUMENT("Task is not valid");
+    _node->set_label(label);
+    return *this;
+}
+
+void Task::topology_changed(INode* node)
+{
+    if (node->_graph) node->_graph->topology_changed();
+}
+
 void at::Task::reset_state()
 {
     if (_node) _node->set_state(INode::Ready);
@@ -21,6 +21,7 @@
 
 #include <memory>
 #include <optional>
+#include <string_view>
 #include <vector>
 
 #include "node.h"
@@ -189,6 +190,22 @@ public:
 
     bool empty() const { return _node == nullptr; }
 
+    /**
+     * @brief Returns the numeric id of the underlying node, used in traces and diagnostics.
+     */
+    std::uint64_t uid() const { return _node->uid(); }
+
+    /**
+     * @brief Returns the label of the underlying node, or nullptr if none was set.
+     */
+    const char* label() const { return _node->label(); }
+
+    /**
+     * @brief Sets a label shown in diagnostics instead of the numeric id.
+     * @return Reference to this Task for chaining, e.g. `graph.push(fn).set_label("decode").depend(load)`.
+     */
+    Task& set_label(std::string_view label);
+
     /**
      * @brief Returns the number of predecessor (dependency) tasks.
      *
@@ -244,6 +261,11 @@ private:
      */
     explicit Task(INode* node) : _node{node} {}
 
+    /**
+     * @brief Tells the graph owning `node`, if any, that its edges changed.
+     */
+    static void topology_changed(INode* node);
+
     INode* _node;  ///< Pointer to the associated INode object (may be nullptr for invalid Task).
 };
 
@@ -1,12 +1,15 @@
 #include "threadgraph.h"
 
+#include <algorithm>
 #include <cassert>
 #include <chrono>
 #include <functional>
 #include <future>
 #include <iostream>
+#include <unordered_map>
 
 #include "diagnostics.h"
+#include "log.h"
 #include "worker.h"
 
 using namespace at;
@@ -19,13 +22,15 @@ void ThreadGraph::create_worker(std::uint32_t count)
         std::unique_ptr<WorkerContext> context = std::make_unique<WorkerContext>();
         context->worker.reset(new GraphWorker(generate_worker_uid(), this));
         context->future = context->worker->get_future();
-        context->thread = std::thread(&IWorker::process_tasks, context->worker.get());
+        context->thread = WorkerThread(context->worker.get(), _options);
         _worker_contexts.push_back(std::move(context));
     }
 }
 
-ThreadGraph::ThreadGraph(std::uint32_t thread_count, bool enable_optimized_threads)
+ThreadGraph::ThreadGraph(std::uint32_t thread_count, bool enable_optimized_threads, const WorkerOptions& options)
 {
+    validate_worker_options(options);
+    _options = options;
     _thread_count = thread_count;
     _termination_flag = false;
     _executing_flag = false;
@@ -43,13 +48,16 @@ at::Task ThreadGraph::push(at::INode* node)
     if (node->state() == INode::Executing || node->state() == INode::Completed)
         AT_INVALID_ARGUMENT("Node is already in EXECUTING or COMPLETE state. A valid node must be provided.");
 
-    // Check if the node is already in the graph
-    if (std::find(_task_pool.begin(), _task_pool.end(), node) != _task_pool.end())
+    // Check if the node is already in the graph. Its owner is set below, a scan of the pool would make
+    // building a graph quadratic.
+    if (node->_graph == this)
         AT_INVALID_ARGUMENT("Node is already in the graph. A valid node must be provided.");
 
     // Insert the node into the graph
     // The node is not already in the graph, so we can safely insert it.
     _task_pool.push_back(node);
+    node->_graph = this;
+    topology_changed();
     return Task(node);
 }
 
@@ -76,6 +84,7 @@ bool at::ThreadGraph::erase(Task& t)
     }
 
     _task_pool.erase(it);
+    topology_changed();
     delete t._node;
     t._node = nullptr;
 
@@ -89,13 +98,25 @@ void ThreadGraph::clear()
     reset();
     for (auto t : _task_pool) delete t;
     _task_pool.clear();
+    topology_changed();
 }
 
 void ThreadGraph::reset_all_tasks_state()
 {
-    std::lock_guard<std::mutex> lk{_tasks_mutex};
+    std::lock_guard<SchedulerMutex> lk{_tasks_mutex};
 
-    for (INode* t : _task_pool) t->set_state(INode::Ready);
+    NodeTiming timing;
+    timing.count_events = _perf_counters;
+    _node_timings.assign(_profiling ? _task_pool.size() : 0, timing);
+    for (std::size_t i = 0; i < _task_pool.size(); i++)
+    {
+        INode* t = _task_pool[i];
+        std::uint32_t pending = 0;
+        for (const INode* predecessor : t->_predecessors)
+            if (predecessor) ++pending;
+        t->arm(pending);
+        t->_timing = _profiling ? &_node_timings[i] : nullptr;
+    }
 }
 
 void at::ThreadGraph::start()
@@ -109,14 +130,20 @@ void at::ThreadGraph::start()
     _stop_reason = StopReason::None;
     _executing_flag.store(true);
     _ready_tasks_cache = _task_pool;
+    _ready_cursor = 0;
 
     uint32_t numThreads = _thread_count;
 
-    // If optimized threads are enabled, adjust the number of threads based on the number of tasks.
+    // If optimized threads are enabled, run no more workers than the graph can keep busy.
     if (_enable_optimized_threads)
     {
-        numThreads = std::min(_thread_count, static_cast<std::uint32_t>(_task_pool.size()));
+        numThreads = std::min(_thread_count, width());
     }
+
+    _profile_pending = _profiling;
+    if (_profiling) _profile_origin = Trace::now();
+    _metrics.run_started(_task_pool.size());
+    AT_LOG_DEBUG("graph starts {} nodes on {} workers", _task_pool.size(), numThreads);
     create_worker(numThreads);
 }
 
@@ -154,9 +181,41 @@ void at::ThreadGraph::wait()
         }
     }
 
+    wait_deferred();
+    if (_profile_pending)
+    {
+        _profile = GraphProfile::build(_task_pool, _node_timings, _profile_origin,
+                                       static_cast<std::uint32_t>(_worker_contexts.size()));
+        _profile_pending = false;
+        topology_changed();  // The width uses the measured times.
+        _metrics.run_profiled(static_cast<std::uint64_t>(_profile.makespan.count()),
+                              static_cast<std::uint64_t>(_profile.work.count()),
+                              static_cast<std::uint64_t>(_profile.span.count()),
+                              static_cast<std::uint64_t>(_profile.cpu_time.count()));
+    }
+
+    if (_deferred_error)
+    {
+        try
+        {
+            std::rethrow_exception(_deferred_error);
+        }
+        catch (const std::exception& e)
+        {
+            exception_msg += e.what();
+            exception_msg += "\n";
+        }
+        catch (...)
+        {
+            exception_msg += "unknown error in async node\n";
+        }
+        _deferred_error = nullptr;
+    }
+
     if (!exception_msg.empty())
     {
         _stop_reason = StopReason::Error;
+        _metrics.run_failed();
         reset();
         throw std::runtime_error("Exception occurred in worker thread: " + exception_msg);
     }
@@ -174,19 +233,34 @@ at::ThreadGraph& ThreadGraph::operator=(ThreadGraph&& other) noexcept
     if (this != &other)
     {
         std::lock(_tasks_mutex, other._tasks_mutex);
-        std::lock_guard<std::mutex> lhs_lock(_tasks_mutex, std::adopt_lock);
-        std::lock_guard<std::mutex> rhs_lock(other._tasks_mutex, std::adopt_lock);
+        std::lock_guard<SchedulerMutex> lhs_lock(_tasks_mutex, std::adopt_lock);
+        std::lock_guard<SchedulerMutex> rhs_lock(other._tasks_mutex, std::adopt_lock);
 
         _enable_optimized_threads = other._enable_optimized_threads;
         _thread_count = other._thread_count;
         _task_pool = std::move(other._task_pool);
         _ready_tasks_cache = std::move(other._ready_tasks_cache);
+        _ready_cursor = other._ready_cursor;
         _worker_contexts = std::move(other._worker_contexts);
         _stop_reason = other._stop_reason;
+        _options = other._options;
+        _profiling = other._profiling;
+        _profile_pending = other._profile_pending;
+        _perf_counters = other._perf_counters;
+        _profile_origin = other._profile_origin;
+        _node_timings = std::move(other._node_timings);
+        _profile = std::move(other._profile);
+        _metrics = other._metrics;
+        _observer = other._observer;
+        _shape_version = other._shape_version;
+        _width_version = other._width_version;
+        _width = other._width;
 
         _termination_flag.store(other._termination_flag.load());
         _executing_flag.store(other._executing_flag.load());
         // No need to move mutex or condition_variable, just leave as is
+
+        for (auto node : _task_pool) node->_graph = this;
     }
     return *this;
 }
@@ -194,15 +268,30 @@ at::ThreadGraph& ThreadGraph::operator=(ThreadGraph&& other) noexcept
 ThreadGraph::ThreadGraph(ThreadGraph&& other) noexcept
     : _enable_optimized_threads(other._enable_optimized_threads),
       _thread_count(other._thread_count),
+      _worker_contexts(std::move(other._worker_contexts)),
+      _stop_reason(other._stop_reason),
+      _options(other._options),
+      _profiling(other._profiling),
+      _profile_pending(other._profile_pending),
+      _perf_counters(other._perf_counters),
+      _profile_origin(other._profile_origin),
+      _node_timings(std::move(other._node_timings)),
+      _profile(std::move(other._profile)),
+      _metrics(other._metrics),
+      _observer(other._observer),
+      _shape_version(other._shape_version),
+      _width_version(other._width_version),
+      _width(other._width),
       _task_pool(std::move(other._task_pool)),
       _ready_tasks_cache(std::move(other._ready_tasks_cache)),
-      _worker_contexts(std::move(other._worker_contexts)),
-      _stop_reason(other._stop_reason)
+      _ready_cursor(other._ready_cursor)
 {
     // Atomics and condition_variable cannot be moved, so reset them
     _termination_flag.store(other._termination_flag.load());
     _executing_flag.store(other._executing_flag.load());
     // No need to move mutex or condition_variable, just default construct
+
+    for (auto node : _task_pool) node->_graph = this;
 }
 
 WaitStatus ThreadGraph::wait_for(std::chrono::nanoseconds timeout)
@@ -246,20 +335,145 @@ void ThreadGraph::reset()
     _executing_flag.store(false);
     _termination_flag.store(false);
     _ready_tasks_cache.clear();
+    _ready_cursor = 0;
     _worker_contexts.clear();
 }
 
 bool ThreadGraph::executing() const { return _executing_flag.load(); }
 
-bool ThreadGraph::remove_ready_cache(INode* node)
+GraphMetrics ThreadGraph::metrics() const
+{
+    GraphMetrics metrics = _metrics.snapshot();
+    metrics.executing = executing();
+    return metrics;
+}
+
+std::uint32_t ThreadGraph::width() const
+{
+    if (_width_version != _shape_version)
+    {
+        _width = compute_width();
+        _width_version = _shape_version;
+    }
+    return _width;
+}
+
+std::uint32_t ThreadGraph::compute_width() const
+{
+    const std::size_t count = _task_pool.size();
+    if (count == 0) return 0;
+
+    std::unordered_map<const INode*, std::size_t> index_of;
+    index_of.reserve(count);
+    for (std::size_t i = 0; i < count; i++) index_of[_task_pool[i]] = i;
+
+    // Measured when the last profiled run executed the same node at the same place, the mean of the measured
+    // times otherwise. Zero-length nodes still hold a worker for a moment.
+    std::vector<std::uint64_t> cost(count, 0);
+    std::uint64_t measured_sum = 0;
+    std::size_t measured = 0;
+    const bool profiled = _profile.nodes.size() == count;
+    for (std::size_t i = 0; i < count; i++)
+    {
+        if (!profiled || !_profile.nodes[i].executed || _profile.nodes[i].uid != _task_pool[i]->uid()) continue;
+        cost[i] = std::max<std::uint64_t>(static_cast<std::uint64_t>(_profile.nodes[i].wall_time().count()), 1);
+        measured_sum += cost[i];
+        measured++;
+    }
+    const std::uint64_t fallback = measured ? std::max<std::uint64_t>(measured_sum / measured, 1) : 1;
+    for (auto& c : cost)
+        if (c == 0) c = fallback;
+
+    // Earliest start of every node with as many workers as needed, in topological order.
+    std::vector<std::uint64_t> start(count, 0);
+    std::vector<std::uint32_t> remaining(count, 0);
+    std::vector<std::size_t> order;
+    order.reserve(count);
+    for (std::size_t i = 0; i < count; i++)
+    {
+        for (const INode* predecessor : _task_pool[i]->_predecessors)
+            if (index_of.count(predecessor)) remaining[i]++;
+        if (remaining[i] == 0) order.push_back(i);
+    }
+    for (std::size_t head = 0; head < order.size(); head++)
+    {
+        std::size_t i = order[head];
+        for (const INode* successor : _task_pool[i]->_successors)
+        {
+            auto it = index_of.find(successor);
+            if (it == index_of.end()) continue;
+            start[it->second] = std::max(start[it->second], start[i] + cost[i]);
+            if (--remaining[it->second] == 0) order.push_back(it->second);
+        }
+    }
+
+    // Peak overlap. At equal times ends sort first, a node ending frees its worker for one starting then.
+    std::vector<std::pair<std::uint64_t, int>> events;
+    events.reserve(order.size() * 2);
+    for (std::size_t i : order)
+    {
+        events.emplace_back(start[i], 1);
+        events.emplace_back(start[i] + cost[i], -1);
+    }
+    std::sort(events.begin(), events.end());
+    std::int64_t running = 0;
+    std::int64_t peak = 1;
+    for (const auto& event : events)
+    {
+        running += event.second;
+        peak = std::max(peak, running);
+    }
+    return static_cast<std::uint32_t>(std::min<std::int64_t>(peak, UINT32_MAX));
+}
+
+std::vector<LockStats> ThreadGraph::lock_stats() const
+{
+    std::vector<LockStats> stats;
+    collect_lock_stats(stats, _tasks_mutex, "graph.tasks");
+    return stats;
+}
+
+void ThreadGraph::complete_deferred(INode* node, std::exception_ptr error)
 {
-    auto it = std::find(_ready_tasks_cache.begin(), _ready_tasks_cache.end(), node);
-    if (it != _ready_tasks_cache.end())
     {
-        _ready_tasks_cache.erase(it);
-        return true;
+        std::lock_guard<SchedulerMutex> lk{_tasks_mutex};
+        if (node->_timing) node->_timing->end();
+        node->complete_execution();
+        if (_deferred_in_flight > 0) --_deferred_in_flight;
+        if (_activity.watched()) _activity.progressed();
+
+        // The first error wins, the remaining nodes are not scheduled anymore.
+        if (error && !_deferred_error)
+        {
+            _deferred_error = error;
+            _termination_flag.store(true);
+        }
     }
-    return false;
+    _task_available_condition.notify_all();
+}
+
+void ThreadGraph::wait_deferred()
+{
+    // Workers may have exited (terminate or error) while async nodes are still running.
+    // Their completions must not outlive this run.
+    std::unique_lock<SchedulerMutex> lk{_tasks_mutex};
+    _task_available_condition.wait(lk, [this]() { return _deferred_in_flight == 0; });
+}
+
+void AsyncNode::complete()
+{
+    if (_graph)
+        _graph->complete_deferred(this, nullptr);
+    else
+        set_state(INode::Completed);
+}
+
+void AsyncNode::fail(std::exception_ptr error)
+{
+    if (_graph)
+        _graph->complete_deferred(this, error);
+    else
+        set_state(INode::Completed);
 }
 
 std::pair<at::TraceNodeState, INode*> ThreadGraph::trace_ready_depend(
@@ -276,6 +490,11 @@ std::pair<at::TraceNodeState, INode*> ThreadGraph::trace_ready_depend(
     {
         return std::pair(TraceNodeState::Completed, const_cast<INode*>(entryNode));
     }
+    else if (entryNode->pending() == 0)
+    {
+        // Every predecessor has completed in this run, no need to walk them.
+        return std::pair(TraceNodeState::Ready, const_cast<INode*>(entryNode));
+    }
     else
     {
         std::pair<at::TraceNodeState, INode*> exe;
@@ -315,7 +534,11 @@ std::pair<at::TraceNodeState, INode*> ThreadGraph::trace_ready_node(const INode*
 {
     if (entryNode == nullptr)
     {
-        if (_ready_tasks_cache.size() > 0) return trace_ready_depend(_ready_tasks_cache.at(0));
+        // Nodes before the cursor have been dispatched, the ones dispatched through a successor are skipped here.
+        while (_ready_cursor < _ready_tasks_cache.size() &&
+               _ready_tasks_cache[_ready_cursor]->state() != INode::Ready)
+            ++_ready_cursor;
+        if (_ready_cursor < _ready_tasks_cache.size()) return trace_ready_depend(_ready_tasks_cache[_ready_cursor]);
 
         for (const auto task : _task_pool)
             if (task->state() == INode::Executing) return std::pair(TraceNodeState::Pending, task);
@@ -21,16 +21,26 @@
 
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
 #include <future>
 #include <memory>
 #include <mutex>
 #include <vector>
 
+#include "cacheline.h"
+#include "graphprofile.h"
+#include "lockprofile.h"
+#include "metrics.h"
 #include "node.h"
 #include "noncopyable.h"
+#include "observer.h"
 #include "status.h"
 #include "task.h"
+#include "watchdog.h"
 #include "worker.h"
+#include "workerthread.h"
 
 namespace at
 {
@@ -79,15 +89,23 @@ class ThreadGraph : public at::noncopyable_::noncopyable
     friend class IWorker;
     friend class GraphWorker;
     friend class Executor;
+    friend class AsyncNode;
+    friend class Watchdog;
+    friend class ScheduleSimulator;
+    friend class GraphSnapshot;
+    friend class Task;
 
 public:
     /**
      * @brief Constructs a new ThreadGraph instance.
      * @param thread_count Number of worker threads to use (default: 2).
      * @param use_optimized_threads Whether to optimize thread usage (default: true).
+     * @param options Attributes of the worker threads: stack size, name, scheduling and affinity.
      * @note The number of threads can be changed later with set_thread_count().
+     * @throws std::invalid_argument if the options are out of range.
      */
-    explicit ThreadGraph(std::uint32_t thread_count = 2, bool use_optimized_threads = true);
+    explicit ThreadGraph(std::uint32_t thread_count = 2, bool use_optimized_threads = true,
+                         const WorkerOptions& options = WorkerOptions());
 
     /**
      * @brief Destructor. Cleans up all resources, including worker threads and tasks.
@@ -183,7 +201,7 @@ public:
 
     /**
      * @brief Enables or disables optimized thread usage.
-     * @param optimizedThreads If true, thread count is optimized based on task count.
+     * @param optimizedThreads If true, start() runs no more workers than the width() of the graph.
      */
     void set_optimized_threads(bool is_optimized_threading) { _enable_optimized_threads = is_optimized_threading; }
 
@@ -193,6 +211,85 @@ public:
      */
     bool optimized_threads() const { return _enable_optimized_threads; }
 
+    /**
+     * @brief Returns the most nodes the graph can run at the same time, the worker count of start() when
+     * optimized threads are enabled, capped at thread_count().
+     *
+     * Every node is laid out as soon as its predecessors end, with its wall time in the last profiled run when
+     * that run covered it and the mean measured time (or equal costs) otherwise; the width is the peak number
+     * of nodes overlapping. A 10k-node chain has a width of 1, a fan-out of N nodes a width of N. The result is
+     * kept until nodes, edges or the profile change. Call it only while the graph is not executing.
+     */
+    std::uint32_t width() const;
+
+    /**
+     * @brief Computes the width() of the graph now, so that the next start() does not have to.
+     */
+    void freeze() { width(); }
+
+    /**
+     * @brief Sets how workers are placed on CPUs.
+     * @param policy The placement policy, applied from the next start().
+     */
+    void set_affinity(const AffinityPolicy& policy) { _options.affinity = policy; }
+
+    /**
+     * @brief Returns the placement policy of the workers.
+     */
+    const AffinityPolicy& affinity() const { return _options.affinity; }
+
+    /**
+     * @brief Returns the attributes of the worker threads.
+     */
+    const WorkerOptions& worker_options() const { return _options; }
+
+    /**
+     * @brief Enables or disables profiling of the runs started from now on.
+     *
+     * A profiled run records when each node starts and ends and which worker runs it, and `wait()` turns the
+     * timings into a `GraphProfile`. Disabled, the cost is one branch per node.
+     */
+    void set_profiling(bool enabled) { _profiling = enabled; }
+
+    /**
+     * @brief Returns whether the runs are profiled.
+     */
+    bool profiling() const { return _profiling; }
+
+    /**
+     * @brief Reads the cycles, instructions, cache misses and context switches of each node in profiled runs.
+     *
+     * Each worker opens its counters on its first profiled node, see `PerfCounters`. Events the system does not
+     * provide are left out of the report. Costs a few hundred nanoseconds per node, more when `rdpmc` is not
+     * allowed.
+     */
+    void set_perf_counters(bool enabled) { _perf_counters = enabled; }
+    bool perf_counters() const { return _perf_counters; }
+
+    /**
+     * @brief Returns the report of the last profiled run, empty until one has been waited for.
+     */
+    const GraphProfile& profile() const { return _profile; }
+
+    /**
+     * @brief Returns a snapshot of the counters of the graph. Safe to call from any thread, even while the
+     * graph runs, it takes no lock.
+     */
+    GraphMetrics metrics() const;
+
+    /**
+     * @brief Returns the statistics of the scheduling lock, empty unless built with AT_PROFILE_LOCKS.
+     */
+    std::vector<LockStats> lock_stats() const;
+
+    /**
+     * @brief Attaches an observer receiving the scheduling events of the next runs, or detaches it with nullptr.
+     *
+     * The graph does not own the observer. Change it only while the graph is not executing.
+     */
+    void set_observer(Observer* observer) { _observer = observer; }
+    Observer* observer() const { return _observer; }
+
     /**
      * @brief Checks if the graph contains no tasks.
      * @return true if the graph is empty, false otherwise.
@@ -229,22 +326,49 @@ private:
     std::pair<TraceNodeState, INode*> trace_ready_depend(
         const INode* entryNode,
         const std::unordered_set<const INode*> avoids = std::unordered_set<const INode*>()) const;
-    bool remove_ready_cache(INode* node);
+    void topology_changed() { ++_shape_version; }
+    std::uint32_t compute_width() const;
+    void complete_deferred(INode* node, std::exception_ptr error);
+    void wait_deferred();
     virtual void create_worker(std::uint32_t count);
     std::uint32_t generate_worker_uid() const;
     virtual void reset();
 
-    bool _enable_optimized_threads;             ///< Flag to indicate if optimized threads are used.
-    std::uint32_t _thread_count;                ///< The number of worker threads to use.
-    std::mutex _tasks_mutex;                    ///< Mutex for synchronizing access to tasks.
-    std::atomic_bool _termination_flag{false};  ///< Signal to terminate all threads.
-    std::atomic_bool _executing_flag{false};    ///< Flag to indicate if the graph is executing.
-    std::condition_variable
-        _task_available_condition;           ///< Condition variable for notifying workers of available tasks.
-    std::vector<INode*> _task_pool;          ///< Set of tasks currently in the graph.
-    std::vector<INode*> _ready_tasks_cache;  ///< Ready tasks cache for internal processing.
+    // Configuration and state owned by the thread calling start() and wait().
+    bool _enable_optimized_threads;  ///< Flag to indicate if optimized threads are used.
+    std::uint32_t _thread_count;     ///< The number of worker threads to use.
     std::vector<std::unique_ptr<at::WorkerContext>> _worker_contexts;  ///< Contexts for worker threads.
     StopReason _stop_reason{StopReason::None};                         ///< Reason for stopping execution.
+    WorkerOptions _options;                                            ///< Attributes of the worker threads.
+    bool _profiling{false};                                            ///< Whether the next runs are profiled.
+    bool _profile_pending{false};                                      ///< Profiled run waiting for its report.
+    bool _perf_counters{false};                                        ///< Whether profiled runs read counters.
+    std::uint64_t _profile_origin{0};                                  ///< Trace clock at the start of the run.
+    std::vector<NodeTiming> _node_timings;                             ///< Timings, in the order of `_task_pool`.
+    GraphProfile _profile;                                             ///< Report of the last profiled run.
+    GraphMetricsRecorder _metrics;                                     ///< Counters, see metrics().
+    Observer* _observer{nullptr};                                      ///< Not owned, may be nullptr.
+    std::uint64_t _shape_version{0};                                   ///< Bumped when nodes, edges or profile change.
+    mutable std::uint64_t _width_version{UINT64_MAX};                  ///< `_shape_version` of `_width`.
+    mutable std::uint32_t _width{0};                                   ///< Cached width().
+
+    // Scheduling state, written by workers under `_tasks_mutex`. Kept on its own cache lines so that
+    // taking the lock does not invalidate the flags the workers poll.
+    alignas(cache_line_size) SchedulerMutex _tasks_mutex;  ///< Mutex for synchronizing access to tasks.
+    std::vector<INode*> _task_pool;                         ///< Set of tasks currently in the graph.
+    std::vector<INode*> _ready_tasks_cache;                 ///< Ready tasks cache for internal processing.
+    std::size_t _ready_cursor{0};                           ///< First entry of the cache that may still be ready.
+    std::uint32_t _deferred_in_flight{0};                   ///< Number of async nodes started but not completed yet.
+    std::exception_ptr _deferred_error;                     ///< First error reported by an async node.
+    alignas(cache_line_size) SchedulerCondition
+        _task_available_condition;  ///< Condition variable for notifying workers of available tasks.
+
+    // Read by workers on every iteration, written only on start and termination.
+    alignas(cache_line_size) std::atomic_bool _termination_flag{false};  ///< Signal to terminate all threads.
+    std::atomic_bool _executing_flag{false};  ///< Flag to indicate if the graph is executing.
+
+    // One slot per worker, written only while a Watchdog is attached. Not moved with the graph.
+    ActivityBoard _activity;
 };
 
 template <class Fn, class... Args, std::enable_if_t<std::is_invocable_v<Fn, Args...>, bool> /*= true*/>
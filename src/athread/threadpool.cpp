@@ -17,22 +17,35 @@
 
 #include "threadpool.h"
 
+#include <algorithm>
 #include <memory>
 #include <thread>
 
+#include "diagnostics.h"
+#include "log.h"
+#include "trace.h"
 #include "worker.h"
 
 using namespace at;
 using namespace std;
 
 at::ThreadPool::ThreadPool(std::uint32_t core_thread_count, std::uint32_t max_thread_count,
-                           const std::chrono::nanoseconds& alive_seasonal_time, bool wait_for_start_signal)
+                           const std::chrono::nanoseconds& alive_seasonal_time, bool wait_for_start_signal,
+                           const WorkerOptions& options)
 {
+    validate_worker_options(options);
+
     _core_thread_count = core_thread_count;
     _max_thread_count = max_thread_count;
     _alive_seasonal_time = alive_seasonal_time;
     _wait_for_start_signal = wait_for_start_signal;
     _termination_flag = false;
+    _task_queues.resize(1);
+    set_affinity(options.affinity);
+    _options = options;
+
+    // Calibrates the clock now, not on the first sampled push while the queue lock is held.
+    Trace::now();
 }
 
 at::ThreadPool::~ThreadPool()
@@ -43,9 +56,15 @@ at::ThreadPool::~ThreadPool()
 
 bool at::ThreadPool::push(IRunnable* runnable)
 {
-    if (!executable()) return false;
+    if (!executable())
+    {
+        _metrics.task_rejected();
+        return false;
+    }
 
-    std::lock_guard<std::mutex> lock(_worker_mutex);
+    if (Observer* hook = observer()) hook->on_task_enqueue(IWorker::current_id(), runnable->uid());
+
+    std::lock_guard<SchedulerMutex> lock(_worker_mutex);
 
     clean_complete_workers();
 
@@ -72,22 +91,36 @@ bool at::ThreadPool::push(IRunnable* runnable)
     }
 
     {
-        std::lock_guard<std::mutex> lk{_task_queue_mutex};
-        _task_queue.push(runnable);
+        std::lock_guard<SchedulerMutex> lk{_task_queue_mutex};
+        enqueue_task(runnable);
         _work_available_condition.notify_one();
     }
+    _metrics.task_submitted();
 
     return true;
 }
 
+std::vector<LockStats> ThreadPool::lock_stats() const
+{
+    std::vector<LockStats> stats;
+    collect_lock_stats(stats, _worker_mutex, "pool.workers");
+    collect_lock_stats(stats, _task_queue_mutex, "pool.task_queue");
+    return stats;
+}
+
 void ThreadPool::clear()
 {
-    std::lock_guard<std::mutex> lock(_task_queue_mutex);
-    while (!_task_queue.empty())
+    std::lock_guard<SchedulerMutex> lock(_task_queue_mutex);
+    for (auto& queue : _task_queues)
     {
-        delete _task_queue.front();
-        _task_queue.pop();
+        while (!queue.empty())
+        {
+            delete queue.front().runnable;
+            queue.pop();
+        }
     }
+    _queued_count = 0;
+    _metrics.queue_depth_changed(0);
 }
 
 void at::ThreadPool::start()
@@ -99,7 +132,7 @@ void at::ThreadPool::start()
 
 void at::ThreadPool::wait()
 {
-    std::lock_guard<std::mutex> lock(_worker_mutex);
+    std::lock_guard<SchedulerMutex> lock(_worker_mutex);
 
     clean_complete_workers();
 
@@ -144,23 +177,106 @@ void at::ThreadPool::terminate(bool alsoWait)
 
 bool ThreadPool::empty()
 {
-    std::lock_guard<std::mutex> lock(_task_queue_mutex);
-    return _task_queue.empty();
+    std::lock_guard<SchedulerMutex> lock(_task_queue_mutex);
+    return !has_tasks();
+}
+
+void ThreadPool::set_affinity(const AffinityPolicy& policy)
+{
+    std::lock_guard<SchedulerMutex> lock(_worker_mutex);
+    if (!_worker_contexts.empty()) AT_RUNTIME_ERROR("Cannot change the affinity of a pool that has workers.");
+
+    std::lock_guard<SchedulerMutex> lk{_task_queue_mutex};
+    _options.affinity = policy;
+
+    // Per-node queues only pay off when workers are actually bound to several nodes.
+    std::vector<int> nodes;
+    const CpuTopology& topology = CpuTopology::system();
+    if (policy.enabled() && policy.mode() != AffinityMode::NumaNode && topology.node_count() > 1)
+        nodes = topology.node_ids();
+
+    std::vector<TaskQueue> queues(std::max<std::size_t>(1, nodes.size()));
+    for (auto& queue : _task_queues)
+    {
+        while (!queue.empty())
+        {
+            queues.front().push(queue.front());
+            queue.pop();
+        }
+    }
+    _task_queues = std::move(queues);
+    _queue_nodes = std::move(nodes);
+}
+
+void ThreadPool::enqueue_task(IRunnable* runnable)
+{
+    std::size_t index = _task_queues.size() > 1 ? queue_index_for_node(CpuTopology::system().current_node()) : 0;
+    std::uint32_t period = _latency_sample_period.load(std::memory_order_relaxed);
+    bool sampled = period != 0 && _enqueued_count++ % period == 0;
+    _task_queues[index].push(QueuedTask{runnable, sampled ? Trace::now() : 0});
+    _metrics.queue_depth_changed(++_queued_count);
+    trace_event(TraceEventType::TaskSubmit, runnable->uid(), index);
+}
+
+QueuedTask ThreadPool::dequeue_task(std::size_t preferred_queue)
+{
+    // Own node first, then take work from the other nodes.
+    for (std::size_t i = 0; i < _task_queues.size(); i++)
+    {
+        std::size_t index = (preferred_queue + i) % _task_queues.size();
+        TaskQueue& queue = _task_queues[index];
+        if (!queue.empty())
+        {
+            QueuedTask task = queue.front();
+            queue.pop();
+            _metrics.queue_depth_changed(--_queued_count);
+            if (i != 0)
+            {
+                trace_event(TraceEventType::TaskSteal, task.runnable->uid(), index);
+                if (Observer* hook = observer()) hook->on_steal(IWorker::current_id(), task.runnable->uid());
+            }
+            return task;
+        }
+    }
+    return QueuedTask{nullptr, 0};
+}
+
+bool ThreadPool::has_tasks() const
+{
+    for (const auto& queue : _task_queues)
+        if (!queue.empty()) return true;
+    return false;
+}
+
+std::size_t ThreadPool::queue_index_for_node(int node) const
+{
+    auto it = std::find(_queue_nodes.begin(), _queue_nodes.end(), node);
+    return it == _queue_nodes.end() ? 0 : static_cast<std::size_t>(it - _queue_nodes.begin());
+}
+
+std::size_t ThreadPool::queue_index_for_worker(std::uint32_t worker_id) const
+{
+    return _queue_nodes.empty() ? 0 : queue_index_for_node(_options.affinity.node_for(worker_id));
 }
 
 bool ThreadPool::executable() const { return !_termination_flag.load(); }
 
-std::uint32_t ThreadPool::generate_worker_uid() const { return _worker_contexts.size(); }
+std::uint32_t ThreadPool::generate_worker_uid() const
+{
+    // Reuse the smallest id not taken by a live worker, so ids stay dense when seasonal workers come and go.
+    std::vector<bool> taken(_worker_contexts.size() + 1, false);
+    for (const auto& context : _worker_contexts)
+    {
+        if (context && context->worker->id() < taken.size()) taken[context->worker->id()] = true;
+    }
+    return static_cast<std::uint32_t>(std::find(taken.begin(), taken.end(), false) - taken.begin());
+}
 
 void at::ThreadPool::create_worker(std::uint32_t count)
 {
     for (std::uint32_t i = 0; i < count; i++)
     {
-        std::unique_ptr<WorkerContext> context = std::make_unique<WorkerContext>();
-        context->worker.reset(new ThreadPoolWorker(generate_worker_uid(), this));
-        context->future = context->worker->get_future();
-        context->thread = std::thread(&IWorker::process_tasks, context->worker.get());
-        _worker_contexts.push_back(std::move(context));
+        launch_worker(new ThreadPoolWorker(generate_worker_uid(), this));
     }
 }
 
@@ -168,14 +284,20 @@ void ThreadPool::create_seasonal_worker(std::uint32_t count, const std::chrono::
 {
     for (std::uint32_t i = 0; i < count; i++)
     {
-        std::unique_ptr<WorkerContext> context = std::make_unique<WorkerContext>();
-        context->worker.reset(new ThreadSeasonalWorker(generate_worker_uid(), this, alive_duration));
-        context->future = context->worker->get_future();
-        context->thread = std::thread(&IWorker::process_tasks, context->worker.get());
-        _worker_contexts.push_back(std::move(context));
+        AT_LOG_DEBUG("pool adds seasonal worker {}", generate_worker_uid());
+        launch_worker(new ThreadSeasonalWorker(generate_worker_uid(), this, alive_duration));
     }
 }
 
+void ThreadPool::launch_worker(at::IWorker* worker)
+{
+    std::unique_ptr<WorkerContext> context = std::make_unique<WorkerContext>();
+    context->worker.reset(worker);
+    context->future = context->worker->get_future();
+    context->thread = WorkerThread(context->worker.get(), _options);
+    _worker_contexts.push_back(std::move(context));
+}
+
 void at::ThreadPool::clean_complete_workers()
 {
     auto contextIt = _worker_contexts.begin();
@@ -208,7 +330,10 @@ void ThreadPool::reset()
     _worker_contexts.clear();
 }
 
-ThreadPoolFixed::ThreadPoolFixed(std::uint32_t coreSize) : ThreadPool(coreSize, coreSize, 0s, true) {}
+ThreadPoolFixed::ThreadPoolFixed(std::uint32_t coreSize, const WorkerOptions& options)
+    : ThreadPool(coreSize, coreSize, 0s, true, options)
+{
+}
 
 ThreadPoolFixed::~ThreadPoolFixed() {}
 
@@ -29,14 +29,29 @@
 #include <thread>
 #include <type_traits>
 
+#include "cacheline.h"
+#include "lockprofile.h"
+#include "metrics.h"
 #include "noncopyable.h"
+#include "observer.h"
 #include "runnable.h"
 #include "status.h"
+#include "watchdog.h"
 #include "worker.h"
+#include "workerthread.h"
 
 namespace at
 {
-using TaskQueue = std::queue<IRunnable*>;
+/**
+ * @brief A task waiting in the queue of a pool.
+ */
+struct QueuedTask
+{
+    IRunnable* runnable;
+    std::uint64_t enqueued;  ///< Trace clock time of push() if the latencies of the task are sampled, otherwise 0.
+};
+
+using TaskQueue = std::queue<QueuedTask>;
 
 /**
  * @brief A thread pool that manages a pool of worker threads for executing tasks concurrently.
@@ -60,6 +75,7 @@ class ThreadPool : public at::noncopyable_::noncopyable
     friend class IWorker;
     friend class ThreadPoolWorker;
     friend class ThreadSeasonalWorker;
+    friend class Watchdog;
 
 public:
     /**
@@ -75,10 +91,12 @@ public:
      * @param alive_seasonal_time The duration for which seasonal workers stay alive if idle. Default is 60 seconds.
      * @param wait_for_start_signal A flag indicating whether the pool should wait for a start signal before executing
      * tasks. Default is false.
+     * @param options Attributes of the worker threads: stack size, name, scheduling and affinity.
+     * @throws std::invalid_argument if the options are out of range.
      */
     ThreadPool(std::uint32_t core_thread_count = 2, std::uint32_t max_thread_count = 0,
                const std::chrono::nanoseconds& alive_seasonal_time = std::chrono::seconds(60),
-               bool wait_for_start_signal = false);
+               bool wait_for_start_signal = false, const WorkerOptions& options = WorkerOptions());
 
     /**
      * @brief Destructor for the ThreadPool.
@@ -184,6 +202,71 @@ public:
 
     bool empty();
 
+    /**
+     * @brief Returns a snapshot of the counters, queue depth, worker counts and latency histograms of the pool.
+     *
+     * Does not take any lock of the pool, the values may be a little behind the workers.
+     */
+    PoolMetrics metrics() const { return _metrics.snapshot(); }
+
+    /**
+     * @brief Returns the statistics of the worker and task queue locks, empty unless built with AT_PROFILE_LOCKS.
+     */
+    std::vector<LockStats> lock_stats() const;
+
+    /**
+     * @brief Sets how often the queue wait and execution time of a task are measured.
+     *
+     * Reading the clock three times costs more than the rest of the bookkeeping of a tiny task, so the
+     * latency histograms sample one task out of `period`. The counters always count every task.
+     *
+     * @param period 1 to measure every task, 0 to measure none. Default is 16.
+     */
+    void set_latency_sample_period(std::uint32_t period) { _latency_sample_period.store(period); }
+    std::uint32_t latency_sample_period() const { return _latency_sample_period.load(); }
+
+    /**
+     * @brief Attaches an observer receiving the scheduling events of the pool, or detaches it with nullptr.
+     *
+     * The pool does not own the observer. Detaching does not wait for the workers: each one keeps calling the
+     * observer it loaded at the start of a task until `on_task_end()` of that task. Destroy a detached observer
+     * only once the pool is destroyed or was terminated and waited for.
+     */
+    void set_observer(Observer* observer) { _observer.store(observer, std::memory_order_release); }
+    Observer* observer() const { return _observer.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Counts the cycles, instructions, cache misses and context switches of the tasks into
+     * `PoolMetrics::counters`.
+     *
+     * Workers open their counters on their first counted task, see `PerfCounters`. Costs a few hundred
+     * nanoseconds per task, more when `rdpmc` is not allowed. Off by default.
+     */
+    void set_perf_counters(bool enabled) { _perf_counters.store(enabled, std::memory_order_relaxed); }
+    bool perf_counters() const { return _perf_counters.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Sets how workers are placed on CPUs.
+     *
+     * When the policy binds workers to more than one NUMA node, the pool keeps one task queue per node:
+     * a task goes to the queue of the node the submitting thread runs on, and workers take tasks from
+     * their own node first and from the other nodes only when theirs is empty.
+     *
+     * @param policy The placement policy, applied to workers created from now on.
+     * @throws std::runtime_error if the pool already has workers.
+     */
+    void set_affinity(const AffinityPolicy& policy);
+
+    /**
+     * @brief Returns the placement policy of the workers.
+     */
+    const AffinityPolicy& affinity() const { return _options.affinity; }
+
+    /**
+     * @brief Returns the attributes of the worker threads.
+     */
+    const WorkerOptions& worker_options() const { return _options; }
+
 protected:
     /**
      * @brief Creates a specified number of worker threads.
@@ -215,16 +298,54 @@ protected:
     void reset();
     std::uint32_t generate_worker_uid() const;
 
+    /**
+     * @brief Starts the thread of a new worker and registers its context.
+     */
+    void launch_worker(at::IWorker* worker);
+
+    // The task queue helpers below must be called with `_task_queue_mutex` held.
+    void enqueue_task(IRunnable* runnable);
+    QueuedTask dequeue_task(std::size_t preferred_queue);
+    bool has_tasks() const;
+    std::size_t queue_index_for_node(int node) const;
+    std::size_t queue_index_for_worker(std::uint32_t worker_id) const;
+
+    // The members are grouped by who writes them, each group starting on its own cache line, so that
+    // producers taking `_worker_mutex` do not invalidate the line workers spin on and the flags every
+    // worker reads stay shared in all caches.
+
+    // Configuration, written before workers start.
     std::uint32_t _core_thread_count;
     std::uint32_t _max_thread_count;
     std::chrono::nanoseconds _alive_seasonal_time;
-    at::TaskQueue _task_queue;
-    std::mutex _worker_mutex;
-    std::mutex _task_queue_mutex;
-    std::condition_variable _work_available_condition;
-    std::atomic_bool _termination_flag;
-    std::atomic_bool _wait_for_start_signal;
+    std::vector<int> _queue_nodes;  ///< NUMA node served by each queue when there are several.
+    WorkerOptions _options;
+    std::atomic<std::uint32_t> _latency_sample_period{16};
+    std::atomic<Observer*> _observer{nullptr};
+    std::atomic_bool _perf_counters{false};
+
+    // Producer side: worker management in push().
+    alignas(cache_line_size) SchedulerMutex _worker_mutex;
     std::vector<std::unique_ptr<at::WorkerContext>> _worker_contexts;  ///< Contexts for worker threads.
+
+    // Shared by producers and consumers: the queues and their lock.
+    alignas(cache_line_size) SchedulerMutex _task_queue_mutex;
+    std::vector<at::TaskQueue> _task_queues;  ///< One queue, or one queue per NUMA node of the affinity policy.
+    std::uint64_t _queued_count{0};           ///< Tasks in all the queues.
+    std::uint64_t _enqueued_count{0};         ///< Tasks ever queued, picks the sampled ones.
+
+    // Workers sleep on the condition and producers notify it.
+    alignas(cache_line_size) SchedulerCondition _work_available_condition;
+
+    // Read by every worker on each wake up, written only on start and termination.
+    alignas(cache_line_size) std::atomic_bool _termination_flag;
+    std::atomic_bool _wait_for_start_signal;
+
+    // Sharded per worker, see PoolMetricsRecorder.
+    PoolMetricsRecorder _metrics;
+
+    // One slot per worker, written only while a Watchdog is attached.
+    ActivityBoard _activity;
 };
 
 /**
@@ -243,8 +364,9 @@ public:
      * @brief Constructs a fixed thread pool with the given number of core threads.
      *
      * @param coreSize The number of core threads that should remain active in the pool.
+     * @param options Attributes of the worker threads.
      */
-    explicit ThreadPoolFixed(std::uint32_t coreSize);
+    explicit ThreadPoolFixed(std::uint32_t coreSize, const WorkerOptions& options = WorkerOptions());
 
     /**
      * @brief Destructor.
@@ -0,0 +1,325 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "cacheline.h"
+#include "diagnostics.h"
+#include "noncopyable.h"
+#include "worker.h"
+
+#ifndef _WIN32
+#include <time.h>
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define AT_TRACE_TSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define AT_TRACE_TSC
+#endif
+
+using namespace at;
+
+namespace
+{
+
+std::uint64_t steady_ns()
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                          std::chrono::steady_clock::now().time_since_epoch())
+                                          .count());
+}
+
+// The time stamp counter is read in a few cycles where the steady clock may cost a vDSO call. Events store
+// raw ticks and are converted to nanoseconds when drained. This assumes an invariant TSC, synchronized
+// between cores, which is the case of x86 processors of the last decade.
+inline std::uint64_t read_ticks()
+{
+#ifdef AT_TRACE_TSC
+    return __rdtsc();
+#else
+    return steady_ns();
+#endif
+}
+
+struct Clock
+{
+    std::uint64_t anchor_ticks{0};
+    std::uint64_t anchor_ns{0};
+    double ns_per_tick{1.0};
+
+    std::uint64_t to_ns(std::uint64_t ticks) const
+    {
+        auto delta = static_cast<double>(static_cast<std::int64_t>(ticks - anchor_ticks)) * ns_per_tick;
+        return anchor_ns + static_cast<std::int64_t>(delta);
+    }
+};
+
+const Clock& trace_clock()
+{
+    static const Clock calibrated = []()
+    {
+        Clock c;
+        c.anchor_ns = steady_ns();
+        c.anchor_ticks = read_ticks();
+#ifdef AT_TRACE_TSC
+        std::uint64_t end_ns = c.anchor_ns;
+        while (end_ns - c.anchor_ns < 1000000) end_ns = steady_ns();
+        std::uint64_t end_ticks = read_ticks();
+        if (end_ticks > c.anchor_ticks)
+            c.ns_per_tick = static_cast<double>(end_ns - c.anchor_ns) / static_cast<double>(end_ticks - c.anchor_ticks);
+#endif
+        return c;
+    }();
+    return calibrated;
+}
+
+struct RawEvent
+{
+    std::uint64_t ticks;
+    std::uint64_t task_id;
+    std::uint64_t arg;
+    std::uint32_t worker_id;
+    TraceEventType type;
+};
+
+/**
+ * @brief Single producer, single consumer ring of events. The owning thread pushes, `drain()` pops under
+ * the registry mutex.
+ */
+class TraceBuffer : public at::noncopyable_::noncopyable
+{
+public:
+    TraceBuffer(std::size_t capacity, std::uint32_t thread)
+        : _thread(thread), _mask(capacity - 1), _events(new RawEvent[capacity])
+    {
+    }
+
+    void push(const RawEvent& event)
+    {
+        std::uint64_t head = _head.load(std::memory_order_relaxed);
+        if (head - _cached_tail > _mask)
+        {
+            _cached_tail = _tail.load(std::memory_order_acquire);
+            if (head - _cached_tail > _mask)
+            {
+                // Single writer, no read-modify-write needed.
+                _dropped.store(_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return;
+            }
+        }
+        _events[head & _mask] = event;
+        _head.store(head + 1, std::memory_order_release);
+    }
+
+    std::size_t pop_all(std::vector<TraceEvent>& out, const Clock& clock)
+    {
+        std::uint64_t tail = _tail.load(std::memory_order_relaxed);
+        std::uint64_t head = _head.load(std::memory_order_acquire);
+        for (std::uint64_t i = tail; i != head; i++)
+        {
+            const RawEvent& raw = _events[i & _mask];
+            out.push_back(TraceEvent{clock.to_ns(raw.ticks), raw.task_id, raw.arg, raw.worker_id, _thread, raw.type});
+        }
+        _tail.store(head, std::memory_order_release);
+        return static_cast<std::size_t>(head - tail);
+    }
+
+    bool empty() const { return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_relaxed); }
+
+    std::uint64_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+    void retire() { _retired.store(true, std::memory_order_release); }
+    bool retired() const { return _retired.load(std::memory_order_acquire); }
+
+private:
+    const std::uint32_t _thread;
+    const std::uint64_t _mask;
+    std::unique_ptr<RawEvent[]> _events;
+
+    // Written by the producer.
+    alignas(cache_line_size) std::atomic<std::uint64_t> _head{0};
+    std::uint64_t _cached_tail{0};
+    std::atomic<std::uint64_t> _dropped{0};
+    std::atomic_bool _retired{false};
+
+    // Written by the consumer.
+    alignas(cache_line_size) std::atomic<std::uint64_t> _tail{0};
+};
+
+struct Registry
+{
+    std::mutex mutex;
+    std::vector<std::shared_ptr<TraceBuffer>> buffers;
+    std::uint32_t next_thread{0};
+    std::size_t capacity{Trace::default_capacity};
+    std::uint64_t retired_dropped{0};
+
+    std::mutex collector_mutex;
+    std::condition_variable collector_condition;
+    std::thread collector;
+    bool collector_stop{false};
+};
+
+Registry& registry()
+{
+    // Never destroyed, threads may record events while static objects are torn down.
+    static Registry* instance = new Registry();
+    return *instance;
+}
+
+struct ThreadBuffer
+{
+    std::shared_ptr<TraceBuffer> buffer;
+
+    ~ThreadBuffer()
+    {
+        if (buffer) buffer->retire();
+    }
+};
+
+thread_local ThreadBuffer thread_buffer;
+
+TraceBuffer& buffer_of_this_thread()
+{
+    if (!thread_buffer.buffer)
+    {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        thread_buffer.buffer = std::make_shared<TraceBuffer>(reg.capacity, reg.next_thread++);
+        reg.buffers.push_back(thread_buffer.buffer);
+    }
+    return *thread_buffer.buffer;
+}
+
+}  // namespace
+
+const char* at::trace_event_name(TraceEventType type)
+{
+    switch (type)
+    {
+        case TraceEventType::WorkerStart: return "WorkerStart";
+        case TraceEventType::WorkerExit: return "WorkerExit";
+        case TraceEventType::WorkerPark: return "WorkerPark";
+        case TraceEventType::WorkerWake: return "WorkerWake";
+        case TraceEventType::TaskSubmit: return "TaskSubmit";
+        case TraceEventType::TaskBegin: return "TaskBegin";
+        case TraceEventType::TaskEnd: return "TaskEnd";
+        case TraceEventType::TaskSteal: return "TaskSteal";
+        case TraceEventType::User: return "User";
+    }
+    return "";
+}
+
+void Trace::enable()
+{
+    trace_clock();
+    _enabled.store(true, std::memory_order_relaxed);
+}
+
+void Trace::disable() { _enabled.store(false, std::memory_order_relaxed); }
+
+void Trace::set_buffer_capacity(std::size_t events)
+{
+    if (events == 0) AT_INVALID_ARGUMENT("Trace buffer capacity must be greater than 0.");
+
+    std::size_t capacity = 1;
+    while (capacity < events) capacity <<= 1;
+
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.capacity = capacity;
+}
+
+void Trace::record(TraceEventType type, std::uint64_t task_id, std::uint64_t arg)
+{
+    buffer_of_this_thread().push(RawEvent{read_ticks(), task_id, arg, IWorker::current_id(), type});
+}
+
+std::size_t Trace::drain(std::vector<TraceEvent>& events)
+{
+    const Clock& c = trace_clock();
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+
+    std::size_t count = 0;
+    for (auto& buffer : reg.buffers) count += buffer->pop_all(events, c);
+
+    // The events of exited threads are drained above, their buffers can go.
+    // Partitioned rather than removed, the buffers that go are still read for their drop counts.
+    auto gone = std::stable_partition(reg.buffers.begin(), reg.buffers.end(),
+                                      [](const std::shared_ptr<TraceBuffer>& buffer)
+                                      { return !buffer->retired() || !buffer->empty(); });
+    for (auto it = gone; it != reg.buffers.end(); ++it) reg.retired_dropped += (*it)->dropped();
+    reg.buffers.erase(gone, reg.buffers.end());
+    return count;
+}
+
+void Trace::start_collector(Sink sink, std::chrono::milliseconds period)
+{
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.collector_mutex);
+    if (reg.collector.joinable()) AT_RUNTIME_ERROR("Trace collector is already running.");
+
+    reg.collector_stop = false;
+    reg.collector = std::thread(
+        [&reg, sink = std::move(sink), period]()
+        {
+            std::vector<TraceEvent> events;
+            std::unique_lock<std::mutex> lk(reg.collector_mutex);
+            bool stop = false;
+            while (!stop)
+            {
+                stop = reg.collector_condition.wait_for(lk, period, [&reg]() { return reg.collector_stop; });
+                lk.unlock();
+                events.clear();
+                if (Trace::drain(events) > 0) sink(events);
+                lk.lock();
+            }
+        });
+}
+
+void Trace::stop_collector()
+{
+    Registry& reg = registry();
+    std::thread collector;
+    {
+        std::lock_guard<std::mutex> lock(reg.collector_mutex);
+        if (!reg.collector.joinable()) return;
+        reg.collector_stop = true;
+        collector = std::move(reg.collector);
+    }
+    reg.collector_condition.notify_all();
+    collector.join();
+}
+
+std::uint64_t Trace::dropped()
+{
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    std::uint64_t total = reg.retired_dropped;
+    for (auto& buffer : reg.buffers) total += buffer->dropped();
+    return total;
+}
+
+std::uint64_t Trace::now()
+{
+    const Clock& c = trace_clock();  // Calibrated before the ticks are read.
+    return c.to_ns(read_ticks());
+}
+
+std::uint64_t Trace::thread_cpu_time()
+{
+#if !defined(_WIN32) && defined(CLOCK_THREAD_CPUTIME_ID)
+    timespec time;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) != 0) return 0;
+    return static_cast<std::uint64_t>(time.tv_sec) * 1000000000ull + static_cast<std::uint64_t>(time.tv_nsec);
+#else
+    return 0;
+#endif
+}
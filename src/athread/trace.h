@@ -0,0 +1,159 @@
+//////////////////////////////////////////////////////////////////////////
+// Copyright 2026 Le Xuan Tuan Anh
+//
+// https://github.com/z-pc/athread
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef TRACE_H__
+#define TRACE_H__
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace at
+{
+
+/**
+ * @enum TraceEventType
+ * @brief What a trace event records.
+ */
+enum class TraceEventType : std::uint8_t
+{
+    WorkerStart,  // A worker thread started running its loop.
+    WorkerExit,   // A worker thread left its loop.
+    WorkerPark,   // A worker goes to sleep, waiting for work or for the start signal.
+    WorkerWake,   // A parked worker woke up.
+    TaskSubmit,   // A task was pushed to a pool.
+    TaskBegin,    // A worker starts executing a task.
+    TaskEnd,      // The task returned or threw, `arg` is the CPU time it used in nanoseconds.
+    TaskSteal,    // A worker took a task from the queue of another NUMA node, `arg` is the queue index.
+    User          // Recorded by the application with `trace_event()`.
+};
+
+const char* trace_event_name(TraceEventType type);
+
+/**
+ * @struct TraceEvent
+ * @brief A trace event as returned by `Trace::drain()`.
+ */
+struct TraceEvent
+{
+    std::uint64_t timestamp;  // Nanoseconds on the `std::chrono::steady_clock` time line.
+    std::uint64_t task_id;    // `IRunnable::uid()` of the task, 0 if the event is not about a task.
+    std::uint64_t arg;        // Event specific value.
+    std::uint32_t worker_id;  // `IWorker::current_id()` of the recording thread.
+    std::uint32_t thread;     // Index of the recording thread, in order of its first event.
+    TraceEventType type;
+};
+
+/**
+ * @class Trace
+ * @brief Records scheduler events into lock-free per-thread ring buffers.
+ *
+ * Each thread writes to its own single-producer ring buffer, so recording an event is a timestamp and a few
+ * stores, without locks or shared writes. Events are collected with `drain()`, either on demand or from a
+ * background thread started with `start_collector()`. When a buffer is full, new events of that thread are
+ * dropped and counted in `dropped()` until it is drained.
+ *
+ * Tracing is off until `enable()` is called. Disabled, `trace_event()` costs one relaxed load.
+ */
+class Trace
+{
+public:
+    using Sink = std::function<void(const std::vector<TraceEvent>&)>;
+
+    static constexpr std::size_t default_capacity = 16384;
+
+    /**
+     * @brief Starts recording. The first call calibrates the clock, which takes about a millisecond.
+     */
+    static void enable();
+
+    /**
+     * @brief Stops recording. Events already recorded stay in the buffers until drained.
+     */
+    static void disable();
+
+    static bool enabled() { return _enabled.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Sets the number of events held by the buffers of threads that record their first event later.
+     *
+     * Rounded up to a power of two.
+     */
+    static void set_buffer_capacity(std::size_t events);
+
+    /**
+     * @brief Records an event from the calling thread. Prefer `trace_event()`, which checks `enabled()` first.
+     */
+    static void record(TraceEventType type, std::uint64_t task_id, std::uint64_t arg);
+
+    /**
+     * @brief Moves the recorded events of all threads to `events`.
+     *
+     * Events of one thread are in the order they were recorded, threads follow each other. Safe to call
+     * while other threads record, concurrent calls to `drain()` are serialized.
+     *
+     * @return The number of events appended.
+     */
+    static std::size_t drain(std::vector<TraceEvent>& events);
+
+    /**
+     * @brief Starts a thread calling `drain()` every `period` and passing the events to `sink`.
+     * @throws std::runtime_error if a collector is already running.
+     */
+    static void start_collector(Sink sink, std::chrono::milliseconds period = std::chrono::milliseconds(10));
+
+    /**
+     * @brief Stops the collector thread after a last drain. Does nothing if none is running.
+     */
+    static void stop_collector();
+
+    /**
+     * @brief Returns the number of events dropped because a buffer was full.
+     */
+    static std::uint64_t dropped();
+
+    /**
+     * @brief Returns the current time on the trace clock, in nanoseconds on the steady clock time line.
+     */
+    static std::uint64_t now();
+
+    /**
+     * @brief Returns the CPU time consumed by the calling thread in nanoseconds, 0 where it is not available.
+     *
+     * Unlike `now()` this is a system call on most platforms, a few hundred nanoseconds.
+     */
+    static std::uint64_t thread_cpu_time();
+
+private:
+    inline static std::atomic_bool _enabled{false};
+};
+
+/**
+ * @brief Records an event from the calling thread if tracing is enabled.
+ */
+inline void trace_event(TraceEventType type, std::uint64_t task_id = 0, std::uint64_t arg = 0)
+{
+    if (Trace::enabled()) Trace::record(type, task_id, arg);
+}
+
+}  // namespace at
+
+#endif  // TRACE_H__
@@ -0,0 +1,455 @@
+#include "traceexport.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+#include <set>
+#include <tuple>
+
+#include "diagnostics.h"
+#include "worker.h"
+
+using namespace at;
+
+namespace
+{
+
+enum class SliceKind
+{
+    Task,
+    Idle,
+    Parked
+};
+
+struct Slice
+{
+    std::uint32_t thread;
+    SliceKind kind;
+    std::uint64_t task_id;
+    std::uint64_t begin;
+    std::uint64_t end;
+    std::uint64_t cpu_time;  // Of a task slice, from its TaskEnd event. 0 when unknown.
+};
+
+struct ThreadRow
+{
+    std::uint32_t thread;
+    std::uint32_t worker_id;
+};
+
+/**
+ * @brief Events of all threads turned into intervals. Submissions, steals, wake ups and user events stay
+ * instants.
+ */
+struct Timeline
+{
+    std::vector<ThreadRow> threads;
+    std::vector<Slice> slices;
+    std::vector<TraceEvent> instants;
+    std::set<std::uint64_t> submitted;  // Tasks with both a submission and an execution, linked by a flow.
+    std::uint64_t origin{0};
+};
+
+Timeline build_timeline(const std::vector<TraceEvent>& events)
+{
+    std::vector<TraceEvent> sorted(events);
+    std::stable_sort(sorted.begin(), sorted.end(), [](const TraceEvent& a, const TraceEvent& b)
+                     { return std::tie(a.thread, a.timestamp) < std::tie(b.thread, b.timestamp); });
+
+    Timeline timeline;
+    if (sorted.empty()) return timeline;
+    timeline.origin = UINT64_MAX;
+
+    std::set<std::uint64_t> submitted, executed;
+    bool open = false;
+    Slice current{};
+    auto close = [&](std::uint64_t at)
+    {
+        if (!open) return;
+        current.end = at;
+        timeline.slices.push_back(current);
+        open = false;
+    };
+    auto start = [&](std::uint32_t thread, SliceKind kind, std::uint64_t task_id, std::uint64_t at)
+    {
+        current = Slice{thread, kind, task_id, at, at, 0};
+        open = true;
+    };
+
+    for (std::size_t i = 0; i < sorted.size(); i++)
+    {
+        const TraceEvent& event = sorted[i];
+        timeline.origin = std::min(timeline.origin, event.timestamp);
+
+        if (timeline.threads.empty() || timeline.threads.back().thread != event.thread)
+        {
+            timeline.threads.push_back(ThreadRow{event.thread, invalid_worker_id});
+            open = false;
+        }
+        if (event.worker_id != invalid_worker_id) timeline.threads.back().worker_id = event.worker_id;
+
+        switch (event.type)
+        {
+            case TraceEventType::WorkerStart:
+                start(event.thread, SliceKind::Idle, 0, event.timestamp);
+                break;
+            case TraceEventType::WorkerExit:
+                close(event.timestamp);
+                break;
+            case TraceEventType::WorkerPark:
+                close(event.timestamp);
+                start(event.thread, SliceKind::Parked, 0, event.timestamp);
+                break;
+            case TraceEventType::WorkerWake:
+                close(event.timestamp);
+                start(event.thread, SliceKind::Idle, 0, event.timestamp);
+                timeline.instants.push_back(event);
+                break;
+            case TraceEventType::TaskBegin:
+                close(event.timestamp);
+                start(event.thread, SliceKind::Task, event.task_id, event.timestamp);
+                executed.insert(event.task_id);
+                break;
+            case TraceEventType::TaskEnd:
+                if (open && current.kind == SliceKind::Task) current.cpu_time = event.arg;
+                close(event.timestamp);
+                start(event.thread, SliceKind::Idle, 0, event.timestamp);
+                break;
+            case TraceEventType::TaskSubmit:
+                submitted.insert(event.task_id);
+                timeline.instants.push_back(event);
+                break;
+            default:
+                timeline.instants.push_back(event);
+                break;
+        }
+
+        // The events of a thread may stop anywhere when drained, close the last interval there.
+        bool last_of_thread = i + 1 == sorted.size() || sorted[i + 1].thread != event.thread;
+        if (last_of_thread) close(event.timestamp);
+    }
+
+    std::set_intersection(submitted.begin(), submitted.end(), executed.begin(), executed.end(),
+                          std::inserter(timeline.submitted, timeline.submitted.end()));
+    return timeline;
+}
+
+std::string thread_name(const ThreadRow& row)
+{
+    if (row.worker_id != invalid_worker_id) return "worker " + std::to_string(row.worker_id);
+    return "thread " + std::to_string(row.thread);
+}
+
+std::string slice_name(const Slice& slice, const TraceExportOptions& options)
+{
+    if (slice.kind == SliceKind::Idle) return "idle";
+    if (slice.kind == SliceKind::Parked) return "parked";
+
+    std::string name = options.task_name ? options.task_name(slice.task_id) : std::string();
+    return name.empty() ? "#" + std::to_string(slice.task_id) : name;
+}
+
+const char* instant_name(TraceEventType type)
+{
+    switch (type)
+    {
+        case TraceEventType::TaskSubmit: return "submit";
+        case TraceEventType::TaskSteal: return "steal";
+        case TraceEventType::WorkerWake: return "wake";
+        default: return "user";
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Chrome Trace Event JSON
+
+std::string json_string(const std::string& text)
+{
+    std::string quoted = "\"";
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            quoted += '\\';
+            quoted += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            quoted += escaped;
+        }
+        else
+            quoted += c;
+    }
+    return quoted + "\"";
+}
+
+// Chrome timestamps are microseconds, relative to the first event to keep them short.
+std::string json_time(std::uint64_t ns, std::uint64_t origin)
+{
+    char text[32];
+    std::uint64_t relative = ns - origin;
+    std::snprintf(text, sizeof(text), "%llu.%03llu", static_cast<unsigned long long>(relative / 1000),
+                  static_cast<unsigned long long>(relative % 1000));
+    return text;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Perfetto protobuf, encoded by hand to avoid a dependency on the Perfetto SDK.
+
+class ProtoWriter
+{
+public:
+    void varint(std::uint32_t field, std::uint64_t value)
+    {
+        key(field, 0);
+        raw_varint(value);
+    }
+
+    void fixed64(std::uint32_t field, std::uint64_t value)
+    {
+        key(field, 1);
+        for (int i = 0; i < 8; i++) _bytes += static_cast<char>((value >> (8 * i)) & 0xff);
+    }
+
+    void bytes(std::uint32_t field, const std::string& value)
+    {
+        key(field, 2);
+        raw_varint(value.size());
+        _bytes += value;
+    }
+
+    void message(std::uint32_t field, const ProtoWriter& value) { bytes(field, value._bytes); }
+
+    const std::string& str() const { return _bytes; }
+
+private:
+    void key(std::uint32_t field, std::uint32_t wire_type) { raw_varint((field << 3) | wire_type); }
+
+    void raw_varint(std::uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            _bytes += static_cast<char>((value & 0x7f) | 0x80);
+            value >>= 7;
+        }
+        _bytes += static_cast<char>(value);
+    }
+
+    std::string _bytes;
+};
+
+// Field numbers of perfetto/protos/perfetto/trace/*.proto.
+namespace pb
+{
+constexpr std::uint32_t trace_packet = 1;
+
+constexpr std::uint32_t packet_timestamp = 8;
+constexpr std::uint32_t packet_sequence_id = 10;
+constexpr std::uint32_t packet_track_event = 11;
+constexpr std::uint32_t packet_sequence_flags = 13;
+constexpr std::uint32_t packet_track_descriptor = 60;
+constexpr std::uint64_t seq_incremental_state_cleared = 1;
+
+constexpr std::uint32_t track_uuid = 1;
+constexpr std::uint32_t track_name = 2;
+constexpr std::uint32_t track_process = 3;
+constexpr std::uint32_t track_thread = 4;
+constexpr std::uint32_t process_pid = 1;
+constexpr std::uint32_t process_name = 6;
+constexpr std::uint32_t thread_pid = 1;
+constexpr std::uint32_t thread_tid = 2;
+constexpr std::uint32_t thread_name = 5;
+
+constexpr std::uint32_t event_debug_annotations = 4;
+constexpr std::uint32_t event_type = 9;
+constexpr std::uint32_t event_track_uuid = 11;
+constexpr std::uint32_t event_name = 23;
+constexpr std::uint32_t event_flow_ids = 47;
+constexpr std::uint32_t event_terminating_flow_ids = 48;
+constexpr std::uint64_t type_slice_begin = 1;
+constexpr std::uint64_t type_slice_end = 2;
+constexpr std::uint64_t type_instant = 3;
+
+constexpr std::uint32_t annotation_uint_value = 3;
+constexpr std::uint32_t annotation_name = 10;
+}  // namespace pb
+
+constexpr std::uint64_t pid = 1;
+constexpr std::uint64_t process_uuid = 1;
+
+std::uint64_t thread_uuid(std::uint32_t thread) { return std::uint64_t(thread) + 2; }
+
+ProtoWriter annotation(const char* name, std::uint64_t value)
+{
+    ProtoWriter writer;
+    writer.bytes(pb::annotation_name, name);
+    writer.varint(pb::annotation_uint_value, value);
+    return writer;
+}
+
+struct Packet
+{
+    std::uint64_t timestamp;
+    int rank;  // Ends before instants before begins at the same timestamp.
+    ProtoWriter event;
+};
+
+}  // namespace
+
+void at::write_chrome_trace(std::ostream& out, const std::vector<TraceEvent>& events,
+                            const TraceExportOptions& options)
+{
+    Timeline timeline = build_timeline(events);
+    const std::uint64_t origin = timeline.origin;
+    bool first = true;
+    auto begin_event = [&]()
+    {
+        out << (first ? "\n" : ",\n");
+        first = false;
+    };
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+    begin_event();
+    out << "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":" << pid
+        << ",\"args\":{\"name\":" << json_string(options.process_name) << "}}";
+    for (const auto& row : timeline.threads)
+    {
+        begin_event();
+        out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << pid << ",\"tid\":" << row.thread
+            << ",\"args\":{\"name\":" << json_string(thread_name(row)) << "}}";
+    }
+
+    for (const auto& slice : timeline.slices)
+    {
+        begin_event();
+        out << "{\"ph\":\"X\",\"name\":" << json_string(slice_name(slice, options)) << ",\"cat\":\""
+            << (slice.kind == SliceKind::Task ? "task" : "worker") << "\",\"pid\":" << pid
+            << ",\"tid\":" << slice.thread << ",\"ts\":" << json_time(slice.begin, origin)
+            << ",\"dur\":" << json_time(slice.end, slice.begin);
+        if (slice.kind == SliceKind::Task)
+        {
+            out << ",\"args\":{\"task\":" << slice.task_id;
+            if (slice.cpu_time) out << ",\"cpu_us\":" << json_time(slice.cpu_time, 0);
+            out << "}";
+        }
+        out << "}";
+
+        if (slice.kind == SliceKind::Task && timeline.submitted.count(slice.task_id))
+        {
+            begin_event();
+            out << "{\"ph\":\"f\",\"bp\":\"e\",\"name\":\"submit\",\"cat\":\"flow\",\"id\":" << slice.task_id
+                << ",\"pid\":" << pid << ",\"tid\":" << slice.thread << ",\"ts\":" << json_time(slice.begin, origin)
+                << "}";
+        }
+    }
+
+    for (const auto& instant : timeline.instants)
+    {
+        begin_event();
+        out << "{\"ph\":\"i\",\"s\":\"t\",\"name\":\"" << instant_name(instant.type) << "\",\"pid\":" << pid
+            << ",\"tid\":" << instant.thread << ",\"ts\":" << json_time(instant.timestamp, origin)
+            << ",\"args\":{\"task\":" << instant.task_id << ",\"arg\":" << instant.arg << "}}";
+
+        if (instant.type == TraceEventType::TaskSubmit && timeline.submitted.count(instant.task_id))
+        {
+            begin_event();
+            out << "{\"ph\":\"s\",\"name\":\"submit\",\"cat\":\"flow\",\"id\":" << instant.task_id
+                << ",\"pid\":" << pid << ",\"tid\":" << instant.thread
+                << ",\"ts\":" << json_time(instant.timestamp, origin) << "}";
+        }
+    }
+
+    out << "\n]}\n";
+    if (!out) AT_RUNTIME_ERROR("Failed to write the Chrome trace.");
+}
+
+void at::write_perfetto_trace(std::ostream& out, const std::vector<TraceEvent>& events,
+                              const TraceExportOptions& options)
+{
+    Timeline timeline = build_timeline(events);
+    bool first = true;
+    auto write_packet = [&](ProtoWriter& packet)
+    {
+        packet.varint(pb::packet_sequence_id, 1);
+        if (first) packet.varint(pb::packet_sequence_flags, pb::seq_incremental_state_cleared);
+        first = false;
+
+        ProtoWriter trace;
+        trace.message(pb::trace_packet, packet);
+        out.write(trace.str().data(), static_cast<std::streamsize>(trace.str().size()));
+    };
+
+    {
+        ProtoWriter process;
+        process.varint(pb::process_pid, pid);
+        process.bytes(pb::process_name, options.process_name);
+        ProtoWriter track;
+        track.varint(pb::track_uuid, process_uuid);
+        track.message(pb::track_process, process);
+        ProtoWriter packet;
+        packet.message(pb::packet_track_descriptor, track);
+        write_packet(packet);
+    }
+    for (const auto& row : timeline.threads)
+    {
+        ProtoWriter thread;
+        thread.varint(pb::thread_pid, pid);
+        thread.varint(pb::thread_tid, std::uint64_t(row.thread) + 1);
+        thread.bytes(pb::thread_name, thread_name(row));
+        ProtoWriter track;
+        track.varint(pb::track_uuid, thread_uuid(row.thread));
+        track.bytes(pb::track_name, thread_name(row));
+        track.message(pb::track_thread, thread);
+        ProtoWriter packet;
+        packet.message(pb::packet_track_descriptor, track);
+        write_packet(packet);
+    }
+
+    std::vector<Packet> packets;
+    for (const auto& slice : timeline.slices)
+    {
+        ProtoWriter begin;
+        begin.varint(pb::event_type, pb::type_slice_begin);
+        begin.varint(pb::event_track_uuid, thread_uuid(slice.thread));
+        begin.bytes(pb::event_name, slice_name(slice, options));
+        if (slice.kind == SliceKind::Task)
+        {
+            begin.message(pb::event_debug_annotations, annotation("task", slice.task_id));
+            if (timeline.submitted.count(slice.task_id)) begin.fixed64(pb::event_terminating_flow_ids, slice.task_id);
+        }
+        packets.push_back(Packet{slice.begin, 2, std::move(begin)});
+
+        ProtoWriter end;
+        end.varint(pb::event_type, pb::type_slice_end);
+        end.varint(pb::event_track_uuid, thread_uuid(slice.thread));
+        if (slice.cpu_time) end.message(pb::event_debug_annotations, annotation("cpu_ns", slice.cpu_time));
+        packets.push_back(Packet{slice.end, 0, std::move(end)});
+    }
+    for (const auto& instant : timeline.instants)
+    {
+        ProtoWriter event;
+        event.varint(pb::event_type, pb::type_instant);
+        event.varint(pb::event_track_uuid, thread_uuid(instant.thread));
+        event.bytes(pb::event_name, instant_name(instant.type));
+        event.message(pb::event_debug_annotations, annotation("task", instant.task_id));
+        event.message(pb::event_debug_annotations, annotation("arg", instant.arg));
+        if (instant.type == TraceEventType::TaskSubmit && timeline.submitted.count(instant.task_id))
+            event.fixed64(pb::event_flow_ids, instant.task_id);
+        packets.push_back(Packet{instant.timestamp, 1, std::move(event)});
+    }
+
+    std::stable_sort(packets.begin(), packets.end(), [](const Packet& a, const Packet& b)
+                     { return std::tie(a.timestamp, a.rank) < std::tie(b.timestamp, b.rank); });
+    for (auto& item : packets)
+    {
+        ProtoWriter packet;
+        packet.varint(pb::packet_timestamp, item.timestamp);
+        packet.message(pb::packet_track_event, item.event);
+        write_packet(packet);
+    }
+
+    if (!out) AT_RUNTIME_ERROR("Failed to write the Perfetto trace.");
+}
@@ -0,0 +1,71 @@
+//////////////////////////////////////////////////////////////////////////
+// Copyright 2026 Le Xuan Tuan Anh
+//
+// https://github.com/z-pc/athread
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef TRACEEXPORT_H__
+#define TRACEEXPORT_H__
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "trace.h"
+
+namespace at
+{
+
+/**
+ * @struct TraceExportOptions
+ * @brief Controls how recorded events are shown in a timeline.
+ */
+struct TraceExportOptions
+{
+    std::string process_name{"athread"};
+
+    /**
+     * @brief Returns the name of a task slice from its id. When empty, tasks are named `#<id>`.
+     */
+    std::function<std::string(std::uint64_t)> task_name;
+};
+
+/**
+ * @brief Writes `events` in the Chrome Trace Event JSON format, viewable in `chrome://tracing` and Perfetto.
+ *
+ * Each recording thread is a row. Executed tasks, idle time between tasks and parked intervals are slices, task
+ * slices carry the CPU time the task used (`cpu_us`) so that blocked tasks stand out from busy ones,
+ * steals and wake ups are instant events, and an arrow links the submission of a pool task to its execution.
+ *
+ * @throws std::runtime_error if writing to `out` fails.
+ */
+void write_chrome_trace(std::ostream& out, const std::vector<TraceEvent>& events,
+                        const TraceExportOptions& options = TraceExportOptions());
+
+/**
+ * @brief Writes `events` as a Perfetto protobuf trace with the same content as `write_chrome_trace()`.
+ *
+ * The output is a serialized `perfetto.protos.Trace` made of track descriptors and track events, it opens in
+ * https://ui.perfetto.dev and `trace_processor`. Timestamps are kept on the steady clock time line.
+ *
+ * @throws std::runtime_error if writing to `out` fails.
+ */
+void write_perfetto_trace(std::ostream& out, const std::vector<TraceEvent>& events,
+                          const TraceExportOptions& options = TraceExportOptions());
+
+}  // namespace at
+
+#endif  // TRACEEXPORT_H__
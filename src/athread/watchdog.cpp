@@ -0,0 +1,202 @@
+#include "watchdog.h"
+
+#include <algorithm>
+
+#include "diagnostics.h"
+#include "threadgraph.h"
+#include "threadpool.h"
+#include "trace.h"
+
+using namespace at;
+
+ActivityBoard::~ActivityBoard()
+{
+    for (auto& chunk : _chunks) delete chunk.load(std::memory_order_relaxed);
+}
+
+ActivityBoard::Slot& ActivityBoard::slot(std::uint32_t worker_id)
+{
+    std::atomic<Chunk*>& entry = _chunks[worker_id / chunk_size];
+    Chunk* chunk = entry.load(std::memory_order_acquire);
+    if (!chunk)
+    {
+        // First worker of the chunk, the loser of a race frees its copy.
+        Chunk* created = new Chunk();
+        if (entry.compare_exchange_strong(chunk, created, std::memory_order_acq_rel))
+            chunk = created;
+        else
+            delete created;
+    }
+    return chunk->slots[worker_id % chunk_size];
+}
+
+void ActivityBoard::task_began(std::uint32_t worker_id, std::uint64_t task_id)
+{
+    if (worker_id >= max_workers)
+    {
+        _untracked.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    Slot& s = slot(worker_id);
+    s.task.store(task_id, std::memory_order_relaxed);
+    s.started.store(Trace::now(), std::memory_order_release);
+}
+
+void ActivityBoard::task_ended(std::uint32_t worker_id, bool completed /*= true*/)
+{
+    if (worker_id >= max_workers)
+        _untracked.fetch_sub(1, std::memory_order_relaxed);
+    else
+        slot(worker_id).started.store(0, std::memory_order_relaxed);
+    if (completed) progressed();
+}
+
+void ActivityBoard::progressed() { _last_progress.store(Trace::now(), std::memory_order_relaxed); }
+
+void ActivityBoard::busy(std::vector<Activity>& busy) const
+{
+    for (std::uint32_t c = 0; c < max_chunks; c++)
+    {
+        const Chunk* chunk = _chunks[c].load(std::memory_order_acquire);
+        if (!chunk) continue;
+        for (std::uint32_t i = 0; i < chunk_size; i++)
+        {
+            const Slot& slot = chunk->slots[i];
+            // The start is read again, a task that began in between would be paired with the id of the next one.
+            std::uint64_t started = slot.started.load(std::memory_order_acquire);
+            if (started == 0) continue;
+            std::uint64_t task = slot.task.load(std::memory_order_relaxed);
+            if (slot.started.load(std::memory_order_acquire) != started) continue;
+            busy.push_back({static_cast<std::uint32_t>(c * chunk_size + i), task, started});
+        }
+    }
+}
+
+Watchdog::Watchdog(Handler handler, std::chrono::nanoseconds task_threshold,
+                   std::chrono::nanoseconds progress_timeout /*= std::chrono::nanoseconds(0)*/)
+    : _handler(std::move(handler)),
+      _task_threshold(static_cast<std::uint64_t>(std::max<std::int64_t>(task_threshold.count(), 0))),
+      _progress_timeout(static_cast<std::uint64_t>(std::max<std::int64_t>(progress_timeout.count(), 0)))
+{
+    if (!_handler) AT_INVALID_ARGUMENT("Watchdog needs a handler.");
+}
+
+Watchdog::~Watchdog()
+{
+    stop();
+    std::lock_guard<std::mutex> lock(_entries_mutex);
+    for (auto& entry : _entries) entry.board->unwatch();
+}
+
+void Watchdog::add(const std::string& name, ThreadPool& pool)
+{
+    std::lock_guard<std::mutex> lock(_entries_mutex);
+    Entry entry{name, &pool, nullptr, &pool._activity};
+    entry.board->watch();
+    entry.progress = Trace::now();
+    _entries.push_back(entry);
+}
+
+void Watchdog::add(const std::string& name, ThreadGraph& graph)
+{
+    std::lock_guard<std::mutex> lock(_entries_mutex);
+    Entry entry{name, nullptr, &graph, &graph._activity};
+    entry.board->watch();
+    entry.progress = Trace::now();
+    _entries.push_back(entry);
+}
+
+void Watchdog::remove(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(_entries_mutex);
+    auto named = [&name](const Entry& entry) { return entry.name == name; };
+    for (auto& entry : _entries)
+        if (named(entry)) entry.board->unwatch();
+    _entries.erase(std::remove_if(_entries.begin(), _entries.end(), named), _entries.end());
+}
+
+bool Watchdog::pending(const Entry& entry, const std::vector<ActivityBoard::Activity>& busy) const
+{
+    if (!busy.empty() || entry.board->untracked() > 0) return true;
+    if (entry.pool) return entry.pool->metrics().queue_depth > 0;
+    return entry.graph->metrics().live_workers > 0;
+}
+
+std::size_t Watchdog::check()
+{
+    std::vector<Stall> stalls;
+    {
+        std::lock_guard<std::mutex> lock(_entries_mutex);
+        std::vector<ActivityBoard::Activity> busy;
+        for (auto& entry : _entries)
+        {
+            busy.clear();
+            entry.board->busy(busy);
+            std::uint64_t now = Trace::now();
+
+            if (_task_threshold)
+            {
+                for (const auto& activity : busy)
+                {
+                    std::uint64_t running = now > activity.started ? now - activity.started : 0;
+                    if (activity.worker_id >= entry.reported.size()) entry.reported.resize(activity.worker_id + 1, 0);
+                    std::uint64_t& reported = entry.reported[activity.worker_id];
+                    if (running < _task_threshold || reported == activity.started) continue;
+                    reported = activity.started;
+                    stalls.push_back({StallKind::LongTask, entry.name, activity.worker_id, activity.task_id,
+                                      std::chrono::nanoseconds(running)});
+                }
+            }
+
+            std::uint64_t last_progress = entry.board->last_progress();
+            if (last_progress != entry.last_progress || !pending(entry, busy))
+            {
+                entry.last_progress = last_progress;
+                entry.progress = now;
+                entry.stalled = false;
+            }
+            else if (_progress_timeout && !entry.stalled && now - entry.progress >= _progress_timeout)
+            {
+                entry.stalled = true;
+                stalls.push_back({StallKind::NoProgress, entry.name, invalid_worker_id, 0,
+                                  std::chrono::nanoseconds(now - entry.progress)});
+            }
+        }
+    }
+
+    // Without the lock, the handler may remove entries.
+    for (const auto& stall : stalls) _handler(stall);
+    return stalls.size();
+}
+
+void Watchdog::start(std::chrono::milliseconds period /*= std::chrono::milliseconds(100)*/)
+{
+    std::lock_guard<std::mutex> lock(_thread_mutex);
+    if (_thread.joinable()) AT_RUNTIME_ERROR("Watchdog is already running.");
+
+    _stop = false;
+    _thread = std::thread(
+        [this, period]()
+        {
+            std::unique_lock<std::mutex> lk(_thread_mutex);
+            while (!_stop_condition.wait_for(lk, period, [this]() { return _stop; }))
+            {
+                lk.unlock();
+                check();
+                lk.lock();
+            }
+        });
+}
+
+void Watchdog::stop()
+{
+    std::thread thread;
+    {
+        std::lock_guard<std::mutex> lock(_thread_mutex);
+        if (!_thread.joinable()) return;
+        _stop = true;
+        thread = std::move(_thread);
+    }
+    _stop_condition.notify_all();
+    thread.join();
+}
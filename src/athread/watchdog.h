@@ -0,0 +1,223 @@
+//////////////////////////////////////////////////////////////////////////
+// Copyright 2026 Le Xuan Tuan Anh
+//
+// https://github.com/z-pc/athread
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef WATCHDOG_H__
+#define WATCHDOG_H__
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cacheline.h"
+#include "noncopyable.h"
+
+namespace at
+{
+class ThreadGraph;
+class ThreadPool;
+
+/**
+ * @class ActivityBoard
+ * @brief The task each worker of a pool or a graph is running and since when, read by a `Watchdog`.
+ *
+ * Each worker owns a slot on its own cache line and only writes it while a watchdog is attached, so an unwatched
+ * scheduler pays one relaxed load per task. Slots come in chunks of `chunk_size` allocated by the first worker
+ * using one, so the board follows the number of workers. Workers with an id of `max_workers` or more have no
+ * slot: they are only counted by `untracked()`, which keeps the scheduler pending for the no progress check.
+ */
+class ActivityBoard : public at::noncopyable_::noncopyable
+{
+public:
+    static constexpr std::size_t chunk_size = 64;
+    static constexpr std::size_t max_chunks = 256;
+    static constexpr std::size_t max_workers = chunk_size * max_chunks;
+
+    struct Activity
+    {
+        std::uint32_t worker_id;
+        std::uint64_t task_id;
+        std::uint64_t started;  // Trace clock.
+    };
+
+    ActivityBoard() = default;
+    ~ActivityBoard();
+
+    bool watched() const { return _watchers.load(std::memory_order_relaxed) != 0; }
+    void watch() { _watchers.fetch_add(1, std::memory_order_relaxed); }
+    void unwatch() { _watchers.fetch_sub(1, std::memory_order_relaxed); }
+
+    void task_began(std::uint32_t worker_id, std::uint64_t task_id);
+    /**
+     * @param completed False when the task only handed its work over, an async node waiting for its callback.
+     */
+    void task_ended(std::uint32_t worker_id, bool completed = true);
+
+    /**
+     * @brief Records progress not tied to a worker, the completion of an async node for example.
+     */
+    void progressed();
+
+    /**
+     * @brief Appends the workers currently running a task to `busy`.
+     */
+    void busy(std::vector<Activity>& busy) const;
+
+    /**
+     * @brief Trace clock time of the last completed task, 0 if none completed while watched.
+     */
+    std::uint64_t last_progress() const { return _last_progress.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Number of workers without a slot currently running a task.
+     */
+    std::uint32_t untracked() const { return _untracked.load(std::memory_order_relaxed); }
+
+private:
+    struct alignas(cache_line_size) Slot
+    {
+        std::atomic<std::uint64_t> task{0};
+        std::atomic<std::uint64_t> started{0};  // 0 while idle.
+    };
+
+    struct Chunk
+    {
+        std::array<Slot, chunk_size> slots{};
+    };
+
+    Slot& slot(std::uint32_t worker_id);
+
+    std::array<std::atomic<Chunk*>, max_chunks> _chunks{};
+    alignas(cache_line_size) std::atomic<std::uint64_t> _last_progress{0};
+    std::atomic<std::uint32_t> _watchers{0};
+    std::atomic<std::uint32_t> _untracked{0};
+};
+
+enum class StallKind
+{
+    LongTask,    // A task has been running for longer than the task threshold.
+    NoProgress,  // Work is pending but no task completed for longer than the progress timeout.
+};
+
+/**
+ * @struct Stall
+ * @brief What a `Watchdog` found. `worker_id` and `task_id` are only set for `StallKind::LongTask`.
+ */
+struct Stall
+{
+    StallKind kind;
+    std::string name;  // Name the pool or graph was registered under.
+    std::uint32_t worker_id;
+    std::uint64_t task_id;
+    std::chrono::nanoseconds duration;  // How long the task ran, or how long nothing completed.
+};
+
+/**
+ * @class Watchdog
+ * @brief Samples the workers of pools and graphs and reports tasks running for too long and schedulers that stop
+ * making progress.
+ *
+ * A stuck node otherwise freezes `ThreadGraph::wait()` without a trace. The watchdog only reads the
+ * `ActivityBoard` of the schedulers, it never takes their locks nor interrupts a task: the handler decides what
+ * to do, log the stall, dump a trace or abort the process.
+ *
+ * Each stall is reported once: a long task when it crosses the threshold, a lack of progress when the timeout
+ * expires, and again only after a task completes. A pool has pending work while its queue is not empty or a
+ * worker runs a task, a graph while it has live workers.
+ *
+ * Registered pools and graphs must outlive the watchdog or be removed first.
+ */
+class Watchdog : public at::noncopyable_::noncopyable
+{
+public:
+    using Handler = std::function<void(const Stall&)>;
+
+    /**
+     * @param handler Called from the thread running `check()` for each stall found.
+     * @param task_threshold Reports tasks running for longer, 0 to disable.
+     * @param progress_timeout Reports schedulers with pending work and no completed task for longer, 0 to disable.
+     */
+    Watchdog(Handler handler, std::chrono::nanoseconds task_threshold,
+             std::chrono::nanoseconds progress_timeout = std::chrono::nanoseconds(0));
+    ~Watchdog();
+
+    /**
+     * @brief Registers a pool or a graph, its workers record their tasks from now on.
+     */
+    void add(const std::string& name, ThreadPool& pool);
+    void add(const std::string& name, ThreadGraph& graph);
+
+    /**
+     * @brief Unregisters every pool and graph registered under `name`.
+     */
+    void remove(const std::string& name);
+
+    /**
+     * @brief Samples every registered pool and graph once and calls the handler for the new stalls.
+     * @return The number of stalls reported.
+     */
+    std::size_t check();
+
+    /**
+     * @brief Starts a thread calling `check()` every `period`.
+     * @throws std::runtime_error if the watchdog is already running.
+     */
+    void start(std::chrono::milliseconds period = std::chrono::milliseconds(100));
+
+    /**
+     * @brief Stops the thread started by `start()`. Does nothing if none is running.
+     */
+    void stop();
+
+private:
+    struct Entry
+    {
+        std::string name;
+        ThreadPool* pool;
+        ThreadGraph* graph;
+        ActivityBoard* board;
+        std::vector<std::uint64_t> reported{};  // Start of the reported long task, by worker id.
+        std::uint64_t progress{0};       // Last time the scheduler was seen idle or completing a task.
+        std::uint64_t last_progress{0};  // `ActivityBoard::last_progress()` at the last check.
+        bool stalled{false};             // No progress reported, waiting for the next completion.
+    };
+
+    bool pending(const Entry& entry, const std::vector<ActivityBoard::Activity>& busy) const;
+
+    Handler _handler;
+    std::uint64_t _task_threshold;
+    std::uint64_t _progress_timeout;
+
+    std::mutex _entries_mutex;  // Held while checking, so entries are not removed under the check.
+    std::vector<Entry> _entries;
+
+    std::mutex _thread_mutex;
+    std::condition_variable _stop_condition;
+    std::thread _thread;
+    bool _stop{false};
+};
+
+}  // namespace at
+
+#endif  // WATCHDOG_H__
@@ -1,34 +1,176 @@
 #include "worker.h"
 
 #include "diagnostics.h"
+#include "log.h"
+#include "node.h"
+#include "observer.h"
+#include "perfcounters.h"
 #include "threadgraph.h"
 #include "threadpool.h"
+#include "trace.h"
 
 using namespace at;
 using namespace std;
 
+namespace
+{
+thread_local IWorker* current_worker = nullptr;
+
+// Counts a pool worker as live while its loop runs, including when it leaves with an exception.
+class LiveWorkerScope
+{
+public:
+    LiveWorkerScope(PoolMetricsRecorder& metrics, bool seasonal) : _metrics(metrics), _seasonal(seasonal)
+    {
+        _metrics.worker_started(_seasonal);
+    }
+    ~LiveWorkerScope() { _metrics.worker_exited(_seasonal); }
+
+private:
+    PoolMetricsRecorder& _metrics;
+    bool _seasonal;
+};
+
+// Pairs on_task_begin() with on_task_end(), including when the task throws.
+class ObservedTaskScope
+{
+public:
+    ObservedTaskScope(Observer* hook, std::uint32_t worker_id, std::uint64_t task_id)
+        : _hook(hook), _worker_id(worker_id), _task_id(task_id)
+    {
+        if (_hook) _hook->on_task_begin(_worker_id, _task_id);
+    }
+    ~ObservedTaskScope()
+    {
+        if (_hook) _hook->on_task_end(_worker_id, _task_id);
+    }
+
+private:
+    Observer* _hook;
+    std::uint32_t _worker_id;
+    std::uint64_t _task_id;
+};
+
+// Holds the activity slot of a worker while a watched task runs, including when the task throws.
+class ActivityScope
+{
+public:
+    ActivityScope(ActivityBoard& board, bool watched, std::uint32_t worker_id, std::uint64_t task_id,
+                  bool completes = true)
+        : _board(watched ? &board : nullptr), _worker_id(worker_id), _completes(completes)
+    {
+        if (_board) _board->task_began(_worker_id, task_id);
+    }
+    ~ActivityScope()
+    {
+        if (_board) _board->task_ended(_worker_id, _completes);
+    }
+
+private:
+    ActivityBoard* _board;
+    std::uint32_t _worker_id;
+    bool _completes;  // False for async nodes, completed later by their callback.
+};
+
+// CPU time of the calling thread when tracing, so that TaskEnd events carry the CPU time of their task.
+std::uint64_t traced_cpu_start() { return Trace::enabled() ? Trace::thread_cpu_time() : 0; }
+std::uint64_t cpu_since(std::uint64_t start) { return start ? Trace::thread_cpu_time() - start : 0; }
+}
+
 IWorker::IWorker(std::uint32_t id)
 {
     _id = id;
     _state.store(WorkerState::Delay);
-    AT_LOG("create worker " << id);
 }
 
 // void Worker::set_state(int state) { state_.store(state); }
 
+void IWorker::run()
+{
+    current_worker = this;
+    trace_event(TraceEventType::WorkerStart);
+    AT_LOG_DEBUG("worker {} started", _id);
+    if (Observer* hook = observer()) hook->on_worker_start(_id);
+    process_tasks();
+    if (Observer* hook = observer()) hook->on_worker_stop(_id);
+    AT_LOG_DEBUG("worker {} exits", _id);
+    trace_event(TraceEventType::WorkerExit);
+    current_worker = nullptr;
+}
+
+IWorker* IWorker::current() { return current_worker; }
+
+std::uint32_t IWorker::current_id() { return current_worker ? current_worker->_id : invalid_worker_id; }
+
+ThreadPoolWorker::ThreadPoolWorker(std::uint32_t id, at::ThreadPool* pool) : IWorker(id), _pool(pool)
+{
+    _queue_index = _pool->queue_index_for_worker(id);
+}
+
+Observer* ThreadPoolWorker::observer() const { return _pool->observer(); }
+
 void ThreadPoolWorker::await_start_signal()
 {
-    std::unique_lock<std::mutex> lk{_pool->_task_queue_mutex};
-    AT_LOG("worker " << this->_id << " is waiting for start signal");
-    _pool->_work_available_condition.wait(lk, [&]() { return !_pool->_wait_for_start_signal.load(); });
+    std::unique_lock<SchedulerMutex> lk{_pool->_task_queue_mutex};
+    auto started = [&]() { return !_pool->_wait_for_start_signal.load(); };
+    if (started()) return;
+
+    trace_event(TraceEventType::WorkerPark);
+    if (Observer* hook = _pool->observer()) hook->on_park(_id);
+    _pool->_metrics.worker_parked();
+    _pool->_work_available_condition.wait(lk, started);
+    _pool->_metrics.worker_woke();
+    trace_event(TraceEventType::WorkerWake);
     lk.unlock();
 }
 
+void ThreadPoolWorker::run_task(const QueuedTask& task)
+{
+    IRunnable* runnable = task.runnable;
+    const bool sampled = task.enqueued != 0;
+    std::uint64_t start = sampled ? Trace::now() : 0;
+    std::uint64_t cpu_start = sampled ? Trace::thread_cpu_time() : traced_cpu_start();
+
+    // Pool tasks are owned by the worker running them, nobody else reads their state.
+    Observer* hook = _pool->observer();
+    const bool watched = _pool->_activity.watched();
+    PerfCounters* counters = _pool->perf_counters() ? &PerfCounters::thread() : nullptr;
+    PerfCounts before;
+    if (counters) before = counters->read();
+
+    runnable->advance_state(std::memory_order_relaxed);
+    trace_event(TraceEventType::TaskBegin, runnable->uid());
+    AT_LOG_TRACE("task {} begins", runnable->uid());
+    std::uint64_t cpu_time = 0;
+    {
+        ObservedTaskScope observed(hook, _id, runnable->uid());
+        ActivityScope activity(_pool->_activity, watched, _id, runnable->uid());
+        runnable->execute();
+        cpu_time = cpu_since(cpu_start);
+    }
+    trace_event(TraceEventType::TaskEnd, runnable->uid(), cpu_time);
+    runnable->advance_state(std::memory_order_relaxed);
+    delete runnable;
+
+    if (counters) _pool->_metrics.task_counted(counters->read() - before);
+
+    if (!sampled)
+    {
+        _pool->_metrics.task_completed();
+        return;
+    }
+    std::uint64_t end = Trace::now();
+    _pool->_metrics.task_completed(start > task.enqueued ? start - task.enqueued : 0, end - start, cpu_time);
+}
+
+Observer* GraphWorker::observer() const { return _graph->_observer; }
+
 void at::GraphWorker::process_tasks()
 try
 {
-    if (!_graph) AT_ERROR("ThreadGraph is not initialized.");
+    if (!_graph) AT_RUNTIME_ERROR("ThreadGraph is not initialized.");
 
+    _graph->_metrics.worker_started();
     _state.store(WorkerState::Busy);
     std::pair<at::TraceNodeState, INode*> nextNode(at::TraceNodeState::Pending, nullptr);
 
@@ -37,28 +179,66 @@ try
         {
             if (_graph->_termination_flag.load()) break;
 
-            std::unique_lock<std::mutex> lk{_graph->_tasks_mutex};
-            nextNode = _graph->trace_ready_node(nextNode.second);
+            std::unique_lock<SchedulerMutex> lk{_graph->_tasks_mutex};
+            if (_graph->_termination_flag.load()) break;  // Set while waiting for the lock.
 
-            if (nextNode.second) AT_LOG("worker " << this->_id << " is considering a task: " << nextNode.second->id());
+            nextNode = _graph->trace_ready_node(nextNode.second);
 
             if (nextNode.first == at::TraceNodeState::Ready)
             {
-                nextNode.second->set_state(IRunnable::Executing);
-                _graph->remove_ready_cache(nextNode.second);
+                // Relaxed, the node is only inspected under `_tasks_mutex` until it completes.
+                nextNode.second->advance_state(std::memory_order_relaxed);
+                if (nextNode.second->_deferred) ++_graph->_deferred_in_flight;
+                _graph->_metrics.node_started();
             }
             else if (nextNode.first == at::TraceNodeState::Pending)
             {
+                trace_event(TraceEventType::WorkerPark);
+                if (_graph->_observer) _graph->_observer->on_park(_id);
+                _graph->_metrics.worker_parked();
                 _graph->_task_available_condition.wait(lk);
+                _graph->_metrics.worker_woke();
+                trace_event(TraceEventType::WorkerWake);
             }
         }
 
         if (nextNode.first == at::TraceNodeState::Ready)
         {
-            if (nextNode.second)
+            const bool watched = _graph->_activity.watched();
+            if (nextNode.second && nextNode.second->_deferred)
+            {
+                // An async node is completed by its own completion callback, the worker moves on.
+                try
+                {
+                    if (nextNode.second->_timing) nextNode.second->_timing->begin(_id);
+                    std::uint64_t cpu_start = traced_cpu_start();
+                    trace_event(TraceEventType::TaskBegin, nextNode.second->uid());
+                    {
+                        ObservedTaskScope observed(_graph->_observer, _id, nextNode.second->uid());
+                        ActivityScope activity(_graph->_activity, watched, _id, nextNode.second->uid(), false);
+                        nextNode.second->execute();
+                    }
+                    trace_event(TraceEventType::TaskEnd, nextNode.second->uid(), cpu_since(cpu_start));
+                }
+                catch (...)
+                {
+                    _graph->complete_deferred(nextNode.second, nullptr);
+                    throw;
+                }
+            }
+            else if (nextNode.second)
             {
-                nextNode.second->execute();
-                nextNode.second->set_state(IRunnable::Completed);
+                if (nextNode.second->_timing) nextNode.second->_timing->begin(_id);
+                std::uint64_t cpu_start = traced_cpu_start();
+                trace_event(TraceEventType::TaskBegin, nextNode.second->uid());
+                {
+                    ObservedTaskScope observed(_graph->_observer, _id, nextNode.second->uid());
+                    ActivityScope activity(_graph->_activity, watched, _id, nextNode.second->uid());
+                    nextNode.second->execute();
+                }
+                trace_event(TraceEventType::TaskEnd, nextNode.second->uid(), cpu_since(cpu_start));
+                if (nextNode.second->_timing) nextNode.second->_timing->end();
+                nextNode.second->complete_execution();
 
                 _graph->_task_available_condition.notify_all();
             }
@@ -71,8 +251,8 @@ try
     } while (true);
 
     _graph->_task_available_condition.notify_all();
-    AT_LOG("worker " << this->_id << " is exited");
     _state.store(WorkerState::Completed);
+    _graph->_metrics.worker_exited();
     _done.set_value();
 }
 catch (...)
@@ -80,8 +260,13 @@ catch (...)
     // stop graph execution if an exception occurs
     if (_graph)
     {
-        _graph->_termination_flag.store(true);
+        {
+            // Under the lock, so a worker between tracing and waiting cannot miss the wake up.
+            std::lock_guard<SchedulerMutex> lk{_graph->_tasks_mutex};
+            _graph->_termination_flag.store(true);
+        }
         _graph->_task_available_condition.notify_all();
+        _graph->_metrics.worker_exited();
     }
 
     _done.set_exception(std::current_exception());
@@ -90,37 +275,38 @@ catch (...)
 void at::ThreadSeasonalWorker::process_tasks()
 try
 {
+    LiveWorkerScope live(_pool->_metrics, true);
     _state.store(WorkerState::Delay);
     await_start_signal();
 
-    at::IRunnable* frontElm = nullptr;
+    QueuedTask next{nullptr, 0};
     do
     {
         {
             _state.store(WorkerState::Ready);
-            std::unique_lock<std::mutex> lk{_pool->_task_queue_mutex};
-            _pool->_work_available_condition.wait_for(
-                lk, _alive_duration, [&]() { return _pool->_termination_flag.load() || !_pool->_task_queue.empty(); });
+            std::unique_lock<SchedulerMutex> lk{_pool->_task_queue_mutex};
+            auto has_work = [&]() { return _pool->_termination_flag.load() || _pool->has_tasks(); };
+            if (!has_work())
+            {
+                trace_event(TraceEventType::WorkerPark);
+                if (Observer* hook = _pool->observer()) hook->on_park(_id);
+                _pool->_metrics.worker_parked();
+                _pool->_work_available_condition.wait_for(lk, _alive_duration, has_work);
+                _pool->_metrics.worker_woke();
+                trace_event(TraceEventType::WorkerWake);
+            }
             _state.store(WorkerState::Busy);
 
-            if (_pool->_termination_flag.load() || _pool->_task_queue.empty()) break;
+            if (_pool->_termination_flag.load() || !_pool->has_tasks()) break;
 
-            frontElm = _pool->_task_queue.front();
-            _pool->_task_queue.pop();
+            next = _pool->dequeue_task(_queue_index);
             lk.unlock();
         };
-        if (frontElm)
-        {
-            frontElm->_state.store(IRunnable::Executing);
-            frontElm->execute();
-            frontElm->_state.store(IRunnable::Completed);
-            delete frontElm;
-        }
-        frontElm = nullptr;
+        if (next.runnable) run_task(next);
+        next.runnable = nullptr;
 
     } while (true);
 
-    AT_LOG("s-worker " << this->_id << " is exited");
     _state.store(WorkerState::Completed);
     _done.set_value();
 }
@@ -132,17 +318,26 @@ catch (...)
 void at::ThreadPoolWorker::process_tasks()
 try
 {
+    LiveWorkerScope live(_pool->_metrics, false);
     _state.store(WorkerState::Delay);
     await_start_signal();
 
-    at::IRunnable* frontElm = nullptr;
+    QueuedTask next{nullptr, 0};
     do
     {
         {
             _state.store(WorkerState::Ready);
-            std::unique_lock<std::mutex> lk{_pool->_task_queue_mutex};
-            _pool->_work_available_condition.wait(
-                lk, [&]() { return (_pool->_termination_flag.load() || !_pool->_task_queue.empty()); });
+            std::unique_lock<SchedulerMutex> lk{_pool->_task_queue_mutex};
+            auto has_work = [&]() { return _pool->_termination_flag.load() || _pool->has_tasks(); };
+            if (!has_work())
+            {
+                trace_event(TraceEventType::WorkerPark);
+                if (Observer* hook = _pool->observer()) hook->on_park(_id);
+                _pool->_metrics.worker_parked();
+                _pool->_work_available_condition.wait(lk, has_work);
+                _pool->_metrics.worker_woke();
+                trace_event(TraceEventType::WorkerWake);
+            }
 
             _state.store(WorkerState::Busy);
 
@@ -151,25 +346,17 @@ try
                 lk.unlock();
                 break;
             }
-            frontElm = _pool->_task_queue.front();
-            _pool->_task_queue.pop();
+            next = _pool->dequeue_task(_queue_index);
             lk.unlock();
         }
 
-        if (frontElm)
-        {
-            frontElm->_state.store(IRunnable::Executing);
-            frontElm->execute();
-            frontElm->_state.store(IRunnable::Completed);
-            delete frontElm;
-        }
+        if (next.runnable) run_task(next);
         _state.store(WorkerState::Busy);
 
-        frontElm = nullptr;
+        next.runnable = nullptr;
 
     } while (true);
 
-    AT_LOG("worker " << this->_id << " is exited");
     _state.store(WorkerState::Completed);
     _done.set_value();
 }
@@ -21,18 +21,28 @@
 
 #include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <future>
 #include <memory>
 #include <queue>
 #include <thread>
 
+#include "cacheline.h"
 #include "noncopyable.h"
+#include "workerthread.h"
 
 namespace at
 {
 
+class Observer;
 class ThreadPool;
 class ThreadGraph;
+struct QueuedTask;
+
+/**
+ * @brief Worker id returned when the calling thread is not a worker.
+ */
+constexpr std::uint32_t invalid_worker_id = UINT32_MAX;
 
 /**
  * @enum WorkerState
@@ -93,13 +103,43 @@ public:
     std::future<void> get_future() { return _done.get_future(); }
     std::thread::id thread_id() { return std::this_thread::get_id(); }
     WorkerState state() const { return _state.load(); }
+    std::uint32_t id() const { return _id; }
+
+    /**
+     * @brief Thread entry point. Registers the worker as the current one and processes tasks.
+     */
+    void run();
 
     virtual void process_tasks() = 0;  // Pure virtual function to be implemented by derived classes.
 
+    /**
+     * @brief Returns the worker running on the calling thread.
+     * @return The worker, or nullptr if the calling thread is not a worker.
+     */
+    static IWorker* current();
+
+    /**
+     * @brief Returns the id of the worker running on the calling thread.
+     *
+     * Ids are unique among the live workers of one pool or graph and are reused once a worker exits,
+     * so they stay in `[0, number of workers)`.
+     *
+     * @return The worker id, or `invalid_worker_id` if the calling thread is not a worker.
+     */
+    static std::uint32_t current_id();
+
 protected:
-    std::uint32_t _id;                // A unique identifier for the worker.
-    std::promise<void> _done;         // Promise to signal when the worker has completed its tasks.
-    std::atomic<WorkerState> _state;  // Current state of the worker.
+    /**
+     * @brief Returns the observer of the pool or graph of the worker, nullptr if none is attached.
+     */
+    virtual Observer* observer() const { return nullptr; }
+
+    std::uint32_t _id;         // A unique identifier for the worker.
+    std::promise<void> _done;  // Promise to signal when the worker has completed its tasks.
+
+    // Written by the worker on every task and polled by producers, on its own cache line. The alignment also
+    // keeps workers allocated next to each other from sharing a line.
+    alignas(cache_line_size) std::atomic<WorkerState> _state;  // Current state of the worker.
 };
 
 class ThreadPoolWorker : public IWorker
@@ -112,7 +152,7 @@ public:
      *
      * @param id A unique identifier for the worker.
      */
-    ThreadPoolWorker(std::uint32_t id, at::ThreadPool* pool) : IWorker(id), _pool(pool) {}
+    ThreadPoolWorker(std::uint32_t id, at::ThreadPool* pool);
 
     /**
      * @brief Waits for a start signal to begin task execution.
@@ -133,7 +173,14 @@ public:
     virtual void process_tasks() override;
 
 protected:
-    at::ThreadPool* _pool;  // Reference to the thread pool this worker is associated with.
+    /**
+     * @brief Executes a task taken from the queue, records it in the metrics of the pool and deletes it.
+     */
+    void run_task(const QueuedTask& task);
+    Observer* observer() const override;
+
+    at::ThreadPool* _pool;     // Reference to the thread pool this worker is associated with.
+    std::size_t _queue_index;  // Task queue served first, the one of the worker's NUMA node.
 };
 
 class ThreadSeasonalWorker : public ThreadPoolWorker
@@ -177,13 +224,15 @@ public:
     virtual void process_tasks() override;
 
 protected:
+    Observer* observer() const override;
+
     at::ThreadGraph* _graph;  // Reference to the thread graph this worker is associated with.
 };
 
-struct WorkerContext
+struct alignas(cache_line_size) WorkerContext
 {
     std::unique_ptr<at::IWorker> worker;
-    std::thread thread;
+    at::WorkerThread thread;
     std::future<void> future;
 };
 
@@ -0,0 +1,240 @@
+//////////////////////////////////////////////////////////////////////////
+// Copyright 2026 Le Xuan Tuan Anh
+//
+// https://github.com/z-pc/athread
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef WORKER_LOCAL_H__
+#define WORKER_LOCAL_H__
+
+#include <atomic>
+#include <cstdint>
+
+#include "cacheline.h"
+#include "diagnostics.h"
+#include "noncopyable.h"
+#include "worker.h"
+
+namespace at
+{
+
+/**
+ * @class WorkerLocal
+ * @brief One private instance of `T` per worker of a `ThreadPool` or a `ThreadGraph`.
+ *
+ * Slots are keyed by the id of the worker running the calling task, not by the thread, so an instance
+ * belongs to one pool or one graph run. Every slot sits on its own cache lines, workers update their
+ * slot without atomics or sharing, and the results are merged with `combine()` or `for_each()` once
+ * the run is over.
+ *
+ * Slots are created on first use in chunks and never move, growing the storage does not take a lock.
+ *
+ * Example:
+ * @code
+ *   at::WorkerLocal<long> sum;
+ *   for (auto& row : rows) graph.push([&]() { sum.local() += accumulate(row); });
+ *   graph.start();
+ *   graph.wait();
+ *   long total = sum.combine(std::plus<long>());
+ * @endcode
+ *
+ * @note Worker ids are only unique within one pool or graph. Do not share an instance between
+ *       two pools or graphs running at the same time.
+ * @note `combine()`, `for_each()` and `clear()` must not run concurrently with `local()`.
+ */
+template <class T>
+class WorkerLocal : public at::noncopyable_::noncopyable
+{
+public:
+    /**
+     * @brief Constructs an empty instance.
+     * @param initial The value every slot starts with.
+     */
+    explicit WorkerLocal(const T& initial = T()) : _initial(initial) {}
+
+    /**
+     * @brief Destructor. Releases all slots.
+     */
+    ~WorkerLocal();
+
+    /**
+     * @brief Returns the slot of the worker running the calling task.
+     * @throws std::runtime_error if the caller is not a worker of a pool or a graph.
+     */
+    T& local();
+
+    /**
+     * @brief Returns the slot of the given worker, creating it if needed.
+     */
+    T& at(std::uint32_t worker_id);
+
+    /**
+     * @brief Calls `fn(T&)` for every slot used so far.
+     */
+    template <class Fn>
+    void for_each(Fn&& fn);
+
+    /**
+     * @brief Folds the used slots with `op`.
+     * @return The combined value, or the initial value if no slot was used.
+     */
+    template <class BinaryOp>
+    T combine(BinaryOp op) const;
+
+    /**
+     * @brief Resets every slot to the initial value and marks it unused.
+     */
+    void clear();
+
+    /**
+     * @brief Returns the number of slots used so far.
+     */
+    std::size_t size() const;
+
+private:
+    static constexpr std::uint32_t chunk_slots = 64;
+
+    struct alignas(cache_line_size) Slot
+    {
+        T value;
+        std::atomic_bool used{false};
+    };
+
+    struct Chunk
+    {
+        explicit Chunk(const T& initial)
+        {
+            for (auto& slot : slots) slot.value = initial;
+        }
+
+        Slot slots[chunk_slots];
+        std::atomic<Chunk*> next{nullptr};
+    };
+
+    Slot& slot(std::uint32_t worker_id);
+    Chunk* head() const { return _head.load(std::memory_order_acquire); }
+    static Chunk* next(Chunk* chunk) { return chunk->next.load(std::memory_order_acquire); }
+
+    T _initial;
+    std::atomic<Chunk*> _head{nullptr};
+};
+
+template <class T>
+WorkerLocal<T>::~WorkerLocal()
+{
+    Chunk* chunk = head();
+    while (chunk)
+    {
+        Chunk* following = next(chunk);
+        delete chunk;
+        chunk = following;
+    }
+}
+
+template <class T>
+typename WorkerLocal<T>::Slot& WorkerLocal<T>::slot(std::uint32_t worker_id)
+{
+    std::atomic<Chunk*>* link = &_head;
+    for (std::uint32_t index = worker_id / chunk_slots;; --index)
+    {
+        Chunk* chunk = link->load(std::memory_order_acquire);
+        if (!chunk)
+        {
+            // Another worker may append the same chunk concurrently, only one of them wins.
+            Chunk* created = new Chunk(_initial);
+            if (link->compare_exchange_strong(chunk, created, std::memory_order_acq_rel))
+                chunk = created;
+            else
+                delete created;
+        }
+
+        if (index == 0) return chunk->slots[worker_id % chunk_slots];
+        link = &chunk->next;
+    }
+}
+
+template <class T>
+T& WorkerLocal<T>::local()
+{
+    std::uint32_t worker_id = IWorker::current_id();
+    if (worker_id == invalid_worker_id) AT_RUNTIME_ERROR("WorkerLocal::local() must be called from a worker.");
+    return at(worker_id);
+}
+
+template <class T>
+T& WorkerLocal<T>::at(std::uint32_t worker_id)
+{
+    Slot& s = slot(worker_id);
+    if (!s.used.load(std::memory_order_relaxed)) s.used.store(true, std::memory_order_relaxed);
+    return s.value;
+}
+
+template <class T>
+template <class Fn>
+void WorkerLocal<T>::for_each(Fn&& fn)
+{
+    for (Chunk* chunk = head(); chunk; chunk = next(chunk))
+    {
+        for (auto& s : chunk->slots)
+            if (s.used.load(std::memory_order_relaxed)) fn(s.value);
+    }
+}
+
+template <class T>
+template <class BinaryOp>
+T WorkerLocal<T>::combine(BinaryOp op) const
+{
+    bool first = true;
+    T result = _initial;
+    for (Chunk* chunk = head(); chunk; chunk = next(chunk))
+    {
+        for (const auto& s : chunk->slots)
+        {
+            if (!s.used.load(std::memory_order_relaxed)) continue;
+            result = first ? s.value : op(result, s.value);
+            first = false;
+        }
+    }
+    return result;
+}
+
+template <class T>
+void WorkerLocal<T>::clear()
+{
+    for (Chunk* chunk = head(); chunk; chunk = next(chunk))
+    {
+        for (auto& s : chunk->slots)
+        {
+            s.value = _initial;
+            s.used.store(false, std::memory_order_relaxed);
+        }
+    }
+}
+
+template <class T>
+std::size_t WorkerLocal<T>::size() const
+{
+    std::size_t count = 0;
+    for (Chunk* chunk = head(); chunk; chunk = next(chunk))
+    {
+        for (const auto& s : chunk->slots)
+            if (s.used.load(std::memory_order_relaxed)) ++count;
+    }
+    return count;
+}
+
+}  // namespace at
+
+#endif  // WORKER_LOCAL_H__
@@ -0,0 +1,209 @@
+#include "workerthread.h"
+
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <memory>
+
+#include "diagnostics.h"
+#include "worker.h"
+
+#if !defined(_WIN32)
+#include <limits.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+
+using namespace at;
+
+namespace
+{
+
+#if !defined(_WIN32)
+
+constexpr std::size_t max_thread_name = 15;
+
+struct StartContext
+{
+    IWorker* worker;
+    std::string name;
+    int policy;  // Non real-time policy set by the thread itself, SCHED_OTHER to keep the inherited one.
+    int nice;
+};
+
+void* start_worker(void* arg)
+{
+    std::unique_ptr<StartContext> context(static_cast<StartContext*>(arg));
+
+#ifdef __linux__
+    if (!context->name.empty()) pthread_setname_np(pthread_self(), context->name.c_str());
+    if (context->policy != SCHED_OTHER)
+    {
+        sched_param param{};
+        pthread_setschedparam(pthread_self(), context->policy, &param);
+    }
+    if (context->nice != 0) setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), context->nice);
+#elif defined(__APPLE__)
+    if (!context->name.empty()) pthread_setname_np(context->name.c_str());
+#endif
+
+    context->worker->run();
+    return nullptr;
+}
+
+int native_policy(SchedPolicy policy)
+{
+    switch (policy)
+    {
+    case SchedPolicy::Fifo: return SCHED_FIFO;
+    case SchedPolicy::RoundRobin: return SCHED_RR;
+#ifdef __linux__
+    case SchedPolicy::Batch: return SCHED_BATCH;
+    case SchedPolicy::Idle: return SCHED_IDLE;
+#else
+    case SchedPolicy::Batch:
+    case SchedPolicy::Idle:
+#endif
+    case SchedPolicy::Default: break;
+    }
+    return SCHED_OTHER;
+}
+
+bool realtime(SchedPolicy policy) { return policy == SchedPolicy::Fifo || policy == SchedPolicy::RoundRobin; }
+
+// Owns a pthread_attr_t for the duration of a thread creation.
+class ThreadAttributes
+{
+public:
+    ThreadAttributes() { pthread_attr_init(&_attr); }
+    ~ThreadAttributes() { pthread_attr_destroy(&_attr); }
+    pthread_attr_t* get() { return &_attr; }
+
+private:
+    pthread_attr_t _attr;
+};
+
+[[noreturn]] void throw_thread_error(const char* what, int error)
+{
+    AT_RUNTIME_ERROR("Cannot create worker thread: " << what << ": " << std::strerror(error));
+}
+
+#endif
+
+}  // namespace
+
+void at::validate_worker_options(const WorkerOptions& options)
+{
+#if !defined(_WIN32)
+    if (options.stack_size != 0 && options.stack_size < static_cast<std::size_t>(PTHREAD_STACK_MIN))
+        AT_INVALID_ARGUMENT("Stack size must be 0 or at least PTHREAD_STACK_MIN bytes.");
+
+    if (realtime(options.sched_policy))
+    {
+        int policy = native_policy(options.sched_policy);
+        if (options.priority < sched_get_priority_min(policy) || options.priority > sched_get_priority_max(policy))
+            AT_INVALID_ARGUMENT("Priority is out of range for the scheduling policy.");
+    }
+#endif
+
+    if (options.nice < -20 || options.nice > 19) AT_INVALID_ARGUMENT("Nice value must be in [-20, 19].");
+}
+
+WorkerThread::WorkerThread(IWorker* worker, const WorkerOptions& options)
+{
+#if defined(_WIN32)
+    _thread = std::thread(&IWorker::run, worker);
+#else
+    ThreadAttributes attributes;
+
+    if (options.stack_size != 0)
+    {
+        // Round up to whole pages, some implementations reject other sizes.
+        std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        std::size_t size = (options.stack_size + page - 1) / page * page;
+        if (int error = pthread_attr_setstacksize(attributes.get(), size)) throw_thread_error("stack size", error);
+    }
+
+    // Thread attributes only accept the real-time policies, the others are set when the thread starts.
+    if (realtime(options.sched_policy))
+    {
+        sched_param param{};
+        param.sched_priority = options.priority;
+        if (int error = pthread_attr_setinheritsched(attributes.get(), PTHREAD_EXPLICIT_SCHED))
+            throw_thread_error("scheduling", error);
+        if (int error = pthread_attr_setschedpolicy(attributes.get(), native_policy(options.sched_policy)))
+            throw_thread_error("scheduling policy", error);
+        if (int error = pthread_attr_setschedparam(attributes.get(), &param)) throw_thread_error("priority", error);
+    }
+
+    std::string name;
+    if (!options.name_prefix.empty())
+        name = (options.name_prefix + std::to_string(worker->id())).substr(0, max_thread_name);
+
+    int start_policy = realtime(options.sched_policy) ? SCHED_OTHER : native_policy(options.sched_policy);
+    auto context = std::make_unique<StartContext>(StartContext{worker, name, start_policy, options.nice});
+    if (int error = pthread_create(&_handle, attributes.get(), &start_worker, context.get()))
+        throw_thread_error("pthread_create", error);
+    context.release();
+    _joinable = true;
+
+    if (options.affinity.enabled()) apply_affinity(_handle, options.affinity.cpus_for(worker->id()));
+#endif
+}
+
+WorkerThread::WorkerThread(WorkerThread&& other) noexcept
+{
+#if defined(_WIN32)
+    _thread = std::move(other._thread);
+#else
+    _handle = other._handle;
+    _joinable = other._joinable;
+    other._joinable = false;
+#endif
+}
+
+WorkerThread& WorkerThread::operator=(WorkerThread&& other) noexcept
+{
+    if (this != &other)
+    {
+        if (joinable()) std::terminate();
+#if defined(_WIN32)
+        _thread = std::move(other._thread);
+#else
+        _handle = other._handle;
+        _joinable = other._joinable;
+        other._joinable = false;
+#endif
+    }
+    return *this;
+}
+
+WorkerThread::~WorkerThread()
+{
+    if (joinable()) std::terminate();
+}
+
+bool WorkerThread::joinable() const
+{
+#if defined(_WIN32)
+    return _thread.joinable();
+#else
+    return _joinable;
+#endif
+}
+
+void WorkerThread::join()
+{
+#if defined(_WIN32)
+    _thread.join();
+#else
+    if (!_joinable) AT_RUNTIME_ERROR("Worker thread is not joinable.");
+    if (int error = pthread_join(_handle, nullptr)) AT_RUNTIME_ERROR("pthread_join: " << std::strerror(error));
+    _joinable = false;
+#endif
+}
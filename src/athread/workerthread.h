@@ -0,0 +1,137 @@
+//////////////////////////////////////////////////////////////////////////
+// Copyright 2026 Le Xuan Tuan Anh
+//
+// https://github.com/z-pc/athread
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef WORKER_THREAD_H__
+#define WORKER_THREAD_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "affinity.h"
+#include "noncopyable.h"
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif
+
+namespace at
+{
+
+class IWorker;
+
+/**
+ * @enum SchedPolicy
+ * @brief Scheduling policy of worker threads.
+ *
+ * - `Default`: the normal time-sharing policy (`SCHED_OTHER`).
+ * - `Fifo`: real-time first-in first-out (`SCHED_FIFO`), uses `priority`.
+ * - `RoundRobin`: real-time round robin (`SCHED_RR`), uses `priority`.
+ * - `Batch`: time-sharing for CPU-bound batch work (`SCHED_BATCH`, Linux only).
+ * - `Idle`: runs only when nothing else wants the CPU (`SCHED_IDLE`, Linux only).
+ */
+enum class SchedPolicy
+{
+    Default,
+    Fifo,
+    RoundRobin,
+    Batch,
+    Idle
+};
+
+/**
+ * @struct WorkerOptions
+ * @brief Attributes of the threads created for the workers of a pool or a graph.
+ *
+ * The default stack of most platforms is 8 MB of address space per thread; pools with many seasonal workers
+ * should use a smaller one. Names longer than 15 characters are truncated, the limit of Linux.
+ *
+ * Example:
+ * @code
+ *   at::WorkerOptions options;
+ *   options.stack_size = 256 * 1024;
+ *   options.name_prefix = "decoder-";
+ *   at::ThreadPool pool(4, 1000, std::chrono::seconds(60), false, options);
+ * @endcode
+ */
+struct WorkerOptions
+{
+    std::size_t stack_size{0};                       ///< Stack size in bytes, 0 keeps the platform default.
+    std::string name_prefix;                         ///< Threads are named `<name_prefix><worker id>`.
+    SchedPolicy sched_policy{SchedPolicy::Default};  ///< Scheduling policy of the threads.
+    int priority{0};                                 ///< Static priority for `Fifo` and `RoundRobin`.
+    int nice{0};                                     ///< Nice value for the time-sharing policies, 0 inherits.
+    AffinityPolicy affinity;                         ///< Placement of the threads on CPUs.
+};
+
+/**
+ * @brief Checks that the options can be applied on this platform.
+ * @throws std::invalid_argument if the stack size, the priority or the nice value is out of range.
+ */
+void validate_worker_options(const WorkerOptions& options);
+
+/**
+ * @class WorkerThread
+ * @brief Thread running a worker, created with the attributes of a `WorkerOptions`.
+ *
+ * On POSIX systems the thread is created with `pthread_create`: the stack size and the real-time policies with
+ * their priority are set on the thread attributes, so they are in effect before the first task runs. The name,
+ * the `Batch` and `Idle` policies and the nice value are set by the thread itself when it starts and the CPU
+ * affinity right after creation; these are best effort. Elsewhere the options are ignored and a plain
+ * `std::thread` is used.
+ */
+class WorkerThread : public at::noncopyable_::noncopyable
+{
+public:
+    WorkerThread() {}
+
+    /**
+     * @brief Starts a thread running `worker->run()`.
+     *
+     * @param worker The worker to run, must outlive the thread.
+     * @param options Attributes of the thread.
+     * @throws std::runtime_error if the thread cannot be created with these attributes, for example a real-time
+     * policy without the privilege to use it.
+     */
+    WorkerThread(IWorker* worker, const WorkerOptions& options);
+
+    WorkerThread(WorkerThread&& other) noexcept;
+    WorkerThread& operator=(WorkerThread&& other) noexcept;
+
+    /**
+     * @brief Destructor. Like `std::thread`, calls `std::terminate()` if the thread is still joinable.
+     */
+    ~WorkerThread();
+
+    bool joinable() const;
+    void join();
+
+private:
+#if defined(_WIN32)
+    std::thread _thread;
+#else
+    pthread_t _handle{};
+    bool _joinable{false};
+#endif
+};
+
+}  // namespace at
+
+#endif  // WORKER_THREAD_H__
@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include "athread/athread.h"
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+using namespace at;
+
+namespace
+{
+
+// Two nodes, one socket each, two cores per socket and two hardware threads per core.
+// Siblings are numbered like Linux does on most x86 machines: cpu n and n + 8 share a core.
+CpuTopology two_node_topology()
+{
+    std::vector<CpuInfo> cpus;
+    for (int cpu = 0; cpu < 16; cpu++)
+    {
+        int physical = cpu % 8;
+        cpus.push_back(CpuInfo{cpu, physical / 4, physical % 4, physical / 4});
+    }
+    return CpuTopology(cpus);
+}
+
+}  // namespace
+
+TEST(Affinity, TopologyNodes)
+{
+    CpuTopology topology = two_node_topology();
+
+    EXPECT_EQ(topology.node_count(), 2u);
+    EXPECT_EQ(topology.node_ids(), (std::vector<int>{0, 1}));
+    EXPECT_EQ(topology.node_of(5), 1);
+    EXPECT_EQ(topology.node_of(9), 0);
+    EXPECT_EQ(topology.node_of(42), -1);
+    EXPECT_EQ(topology.cpus_of_node(1), (std::vector<int>{4, 5, 6, 7, 12, 13, 14, 15}));
+}
+
+TEST(Affinity, CompactFillsCoresThenNodes)
+{
+    CpuTopology topology = two_node_topology();
+    AffinityPolicy policy = AffinityPolicy::compact();
+
+    std::vector<int> placement;
+    for (std::uint32_t id = 0; id < 16; id++) placement.push_back(policy.cpus_for(id, topology).front());
+
+    EXPECT_EQ(placement, (std::vector<int>{0, 8, 1, 9, 2, 10, 3, 11, 4, 12, 5, 13, 6, 14, 7, 15}));
+    EXPECT_EQ(policy.node_for(7, topology), 0);
+    EXPECT_EQ(policy.node_for(8, topology), 1);
+    EXPECT_EQ(policy.cpus_for(16, topology), (std::vector<int>{0}));
+}
+
+TEST(Affinity, ScatterAlternatesNodesAndAvoidsSiblings)
+{
+    CpuTopology topology = two_node_topology();
+    AffinityPolicy policy = AffinityPolicy::scatter();
+
+    std::vector<int> placement;
+    for (std::uint32_t id = 0; id < 16; id++) placement.push_back(policy.cpus_for(id, topology).front());
+
+    EXPECT_EQ(placement, (std::vector<int>{0, 4, 1, 5, 2, 6, 3, 7, 8, 12, 9, 13, 10, 14, 11, 15}));
+    EXPECT_EQ(policy.node_for(0, topology), 0);
+    EXPECT_EQ(policy.node_for(1, topology), 1);
+}
+
+TEST(Affinity, ExplicitAndNumaNode)
+{
+    CpuTopology topology = two_node_topology();
+
+    AffinityPolicy explicit_policy = AffinityPolicy::cpus({3, 6});
+    EXPECT_EQ(explicit_policy.mode(), AffinityMode::Explicit);
+    EXPECT_EQ(explicit_policy.cpus_for(0, topology), (std::vector<int>{3}));
+    EXPECT_EQ(explicit_policy.cpus_for(1, topology), (std::vector<int>{6}));
+    EXPECT_EQ(explicit_policy.cpus_for(2, topology), (std::vector<int>{3}));
+    EXPECT_EQ(explicit_policy.node_for(1, topology), 1);
+
+    AffinityPolicy node_policy = AffinityPolicy::numa_node(1);
+    EXPECT_EQ(node_policy.cpus_for(0, topology), topology.cpus_of_node(1));
+    EXPECT_EQ(node_policy.node_for(3, topology), 1);
+
+    AffinityPolicy none;
+    EXPECT_FALSE(none.enabled());
+    EXPECT_TRUE(none.cpus_for(0, topology).empty());
+    EXPECT_EQ(none.node_for(0, topology), -1);
+
+    EXPECT_THROW(AffinityPolicy::cpus({}), std::invalid_argument);
+    EXPECT_THROW(AffinityPolicy::numa_node(-1), std::invalid_argument);
+}
+
+#ifdef __linux__
+TEST(Affinity, PoolWorkersRunOnTheirCpu)
+{
+    const int cpu = CpuTopology::system().cpus().front().cpu;
+
+    ThreadPool pool(2, 2);
+    pool.set_affinity(AffinityPolicy::cpus({cpu}));
+
+    std::mutex mutex;
+    std::set<int> seen;
+    parallel_for(pool, 0, 64,
+                 [&](int)
+                 {
+                     std::lock_guard<std::mutex> lock(mutex);
+                     seen.insert(sched_getcpu());
+                 });
+
+    EXPECT_EQ(seen, (std::set<int>{cpu}));
+    EXPECT_THROW(pool.set_affinity(AffinityPolicy::compact()), std::runtime_error);
+}
+
+TEST(Affinity, GraphWorkersRunOnTheirCpu)
+{
+    const int cpu = CpuTopology::system().cpus().front().cpu;
+
+    ThreadGraph graph(2, false);
+    graph.set_affinity(AffinityPolicy::cpus({cpu}));
+
+    std::mutex mutex;
+    std::set<int> seen;
+    for (int i = 0; i < 16; i++)
+        graph.push(
+            [&]()
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                seen.insert(sched_getcpu());
+            });
+
+    graph.start();
+    graph.wait();
+
+    EXPECT_EQ(seen, (std::set<int>{cpu}));
+}
+#endif
+
+TEST(Affinity, PoolRunsAllTasksWithScatter)
+{
+    ThreadPool pool(4, 4);
+    pool.set_affinity(AffinityPolicy::scatter());
+
+    std::atomic_int count{0};
+    parallel_for(pool, 0, 1000, [&count](int) { count++; });
+
+    EXPECT_EQ(count.load(), 1000);
+    EXPECT_TRUE(pool.empty());
+}
@@ -1,6 +1,13 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
 #include <numeric>
+#include <set>
+#include <string>
+#include <thread>
 
 #include "athread/athread.h"
 
@@ -439,6 +446,151 @@ TEST(ThreadGraph, MoveConstructor)
     EXPECT_TRUE(graph2.task_at(0).state() == Task::COMPLETED || graph2.task_at(1).state() == Task::COMPLETED);
 }
 
+namespace
+{
+// Records, when executed, whether all predecessors had completed and how many were still pending.
+class CheckingNode : public INode
+{
+public:
+    std::atomic_bool predecessors_completed{false};
+    std::atomic<std::uint32_t> pending_at_execute{UINT32_MAX};
+
+protected:
+    void execute() override
+    {
+        bool completed = true;
+        for (const INode* predecessor : predecessors()) completed = completed && predecessor->state() == Completed;
+        predecessors_completed = completed;
+        pending_at_execute = pending();
+    }
+};
+}  // namespace
+
+TEST(ThreadGraph, PendingCountAndEpochAcrossRuns)
+{
+    ThreadGraph graph(3, false);
+    auto* a = new CheckingNode();
+    auto* b = new CheckingNode();
+    auto* c = new CheckingNode();
+    auto* d = new CheckingNode();
+    Task ta = graph.push(a);
+    Task tb = graph.push(b);
+    Task tc = graph.push(c);
+    Task td = graph.push(d);
+    tb.depend(ta);
+    tc.depend(ta);
+    td.depend({tb, tc});
+
+    for (std::uint32_t run = 1; run <= 3; run++)
+    {
+        graph.start();
+        graph.wait();
+
+        for (CheckingNode* node : {a, b, c, d})
+        {
+            EXPECT_TRUE(node->predecessors_completed);
+            EXPECT_EQ(node->pending_at_execute.load(), 0u);
+            EXPECT_EQ(node->state(), INode::Completed);
+            EXPECT_EQ(node->epoch(), run);
+        }
+    }
+}
+
+TEST(ThreadGraph, TaskIdsAndLabels)
+{
+    ThreadGraph graph;
+    Task t1 = graph.push([]() {});
+    Task t2 = graph.push([]() {}).set_label("decode");
+    Task t3 = graph.push([]() {}).set_label(std::string("de") + "code");
+
+    EXPECT_GT(t1.uid(), 0u);
+    EXPECT_LT(t1.uid(), t2.uid());
+    EXPECT_LT(t2.uid(), t3.uid());
+
+    EXPECT_EQ(t1.label(), nullptr);
+    EXPECT_STREQ(t2.label(), "decode");
+    EXPECT_EQ(t2.label(), t3.label());  // Interned once.
+
+    NodeHolder<void (*)()> node([]() {});
+    EXPECT_EQ(node.id(), "#" + std::to_string(node.uid()));
+    node.set_label("load");
+    EXPECT_EQ(node.id(), "load");
+}
+
+TEST(ThreadGraph, TaskIdsAreUniqueAcrossThreads)
+{
+    std::vector<std::vector<std::uint64_t>> ids(4);
+    std::vector<std::thread> threads;
+    for (auto& list : ids)
+    {
+        threads.emplace_back(
+            [&list]()
+            {
+                for (int i = 0; i < 5000; i++)
+                {
+                    NodeHolder<void (*)()> node([]() {});
+                    list.push_back(node.uid());
+                }
+            });
+    }
+    for (auto& thread : threads) thread.join();
+
+    std::set<std::uint64_t> all;
+    for (const auto& list : ids)
+    {
+        EXPECT_TRUE(std::is_sorted(list.begin(), list.end()));
+        all.insert(list.begin(), list.end());
+    }
+    EXPECT_EQ(all.size(), 20000u);
+}
+
+TEST(ThreadGraph, WidthLimitsWorkers)
+{
+    ThreadGraph graph(8);
+    std::mutex mutex;
+    std::set<std::uint32_t> workers;
+    auto record = [&]()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        workers.insert(IWorker::current_id());
+    };
+
+    Task previous = graph.push(record);
+    for (int i = 1; i < 50; i++) previous = graph.push(record).depend(previous);
+    graph.freeze();
+    EXPECT_EQ(graph.width(), 1u);
+    graph.start();
+    graph.wait();
+    EXPECT_EQ(workers.size(), 1u);
+
+    // Edges and nodes added after freeze() are taken into account.
+    Task head = graph.task_at(0);
+    std::vector<Task> fan;
+    for (int i = 0; i < 5; i++) fan.push_back(graph.push(record).depend(head));
+    EXPECT_EQ(graph.width(), 6u);  // The five new nodes and the second node of the chain.
+    graph.erase(fan[4]);
+    EXPECT_EQ(graph.width(), 5u);
+    fan[0].erase_depend(head);
+    EXPECT_EQ(graph.width(), 4u);
+}
+
+TEST(ThreadGraph, WidthUsesMeasuredTimes)
+{
+    // With equal costs C shares a level with E, F and G; measured, C ends long before A does.
+    ThreadGraph graph(8);
+    auto a = graph.push([]() { std::this_thread::sleep_for(std::chrono::milliseconds(10)); });
+    auto b = graph.push([]() {});
+    auto c = graph.push([]() {}).depend(b);
+    graph.push([]() {}).depend(c);
+    for (int i = 0; i < 3; i++) graph.push([]() {}).depend(a);
+    EXPECT_EQ(graph.width(), 4u);
+
+    graph.set_profiling(true);
+    graph.start();
+    graph.wait();
+    EXPECT_EQ(graph.width(), 3u);
+}
+
 TEST(Executor, StartGraphAsync)
 {
     ThreadGraph graph;
@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+#include "athread/athread.h"
+
+using namespace at;
+using namespace std::chrono_literals;
+
+namespace
+{
+void sleep_ms(int ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+}  // namespace
+
+TEST(GraphProfile, DisabledByDefault)
+{
+    ThreadGraph graph(2);
+    graph.push([]() {});
+    graph.start();
+    graph.wait();
+
+    EXPECT_FALSE(graph.profiling());
+    EXPECT_TRUE(graph.profile().nodes.empty());
+}
+
+TEST(GraphProfile, MeasuresNodesAndCriticalPath)
+{
+    ThreadGraph graph(2, false);
+    graph.set_profiling(true);
+
+    // a -> b -> c is the critical path, d runs beside it.
+    auto a = graph.push([]() { sleep_ms(4); });
+    auto b = graph.push([]() { sleep_ms(4); });
+    auto c = graph.push([]() { sleep_ms(4); });
+    auto d = graph.push([]() { sleep_ms(2); });
+    a.set_label("a");
+    b.depend(a);
+    c.depend(b);
+    d.depend(a);
+
+    graph.start();
+    graph.wait();
+
+    const GraphProfile& profile = graph.profile();
+    ASSERT_EQ(profile.nodes.size(), 4u);
+    EXPECT_EQ(profile.worker_count, 2u);
+    for (const auto& node : profile.nodes)
+    {
+        EXPECT_TRUE(node.executed);
+        EXPECT_LT(node.worker, 2u);
+        EXPECT_GE(node.queue_wait().count(), 0);
+        EXPECT_GE(node.wall_time(), 2ms);
+        EXPECT_LE(node.end, profile.makespan);
+    }
+    EXPECT_STREQ(profile.nodes[0].label, "a");
+
+    // b and d are ready when a ends.
+    EXPECT_EQ(profile.nodes[1].ready, profile.nodes[0].end);
+    EXPECT_EQ(profile.nodes[3].ready, profile.nodes[0].end);
+
+    std::vector<std::uint64_t> path{a.uid(), b.uid(), c.uid()};
+    EXPECT_EQ(profile.critical_path, path);
+    EXPECT_GE(profile.span, 12ms);
+    EXPECT_GE(profile.work, 14ms);
+    EXPECT_GE(profile.makespan, profile.span);
+    EXPECT_GT(profile.parallelism(), 1.0);
+    EXPECT_LE(profile.scheduler_overhead, profile.queue_wait);
+
+    std::ostringstream report;
+    profile.write_report(report);
+    EXPECT_NE(report.str().find("critical path"), std::string::npos);
+    EXPECT_NE(report.str().find("  a on worker"), std::string::npos);
+}
+
+TEST(GraphProfile, SeparatesCpuFromWallTime)
+{
+    ThreadGraph graph(1, false);
+    graph.set_profiling(true);
+    auto blocked = graph.push([]() { sleep_ms(5); });
+    auto busy = graph.push(
+        []()
+        {
+            // Spins on the CPU clock, not the wall clock, so that preemption does not shorten the work.
+            std::uint64_t start = Trace::thread_cpu_time();
+            if (start == 0) return;
+            while (Trace::thread_cpu_time() - start < 3000000)
+            {
+            }
+        });
+    busy.depend(blocked);
+    graph.start();
+    graph.wait();
+    if (Trace::thread_cpu_time() == 0) GTEST_SKIP() << "no thread CPU clock";
+
+    const GraphProfile& profile = graph.profile();
+    EXPECT_LT(profile.nodes[0].cpu_time, 2ms);
+    EXPECT_GE(profile.nodes[0].off_cpu_time(), 3ms);
+    EXPECT_GE(profile.nodes[1].cpu_time, 3ms);
+    EXPECT_EQ(profile.cpu_time, profile.nodes[0].cpu_time + profile.nodes[1].cpu_time);
+    EXPECT_EQ(graph.metrics().last_cpu_time, static_cast<std::uint64_t>(profile.cpu_time.count()));
+
+    std::ostringstream report;
+    profile.write_report(report);
+    EXPECT_NE(report.str().find("cpu time"), std::string::npos);
+}
+
+TEST(GraphProfile, EachRunReplacesTheReport)
+{
+    ThreadGraph graph(1);
+    graph.set_profiling(true);
+    auto a = graph.push([]() { sleep_ms(1); });
+
+    graph.start();
+    graph.wait();
+    ASSERT_EQ(graph.profile().nodes.size(), 1u);
+
+    auto b = graph.push([]() { sleep_ms(1); });
+    graph.start();
+    graph.wait();
+    ASSERT_EQ(graph.profile().nodes.size(), 2u);
+    EXPECT_EQ(graph.profile().nodes[0].uid, a.uid());
+    EXPECT_EQ(graph.profile().nodes[1].uid, b.uid());
+    EXPECT_TRUE(graph.profile().nodes[1].executed);
+    EXPECT_GT(graph.profile().work, graph.profile().nodes[0].wall_time());  // Counts the new node too.
+
+    // Turning profiling off keeps the last report.
+    graph.set_profiling(false);
+    graph.start();
+    graph.wait();
+    EXPECT_EQ(graph.profile().nodes.size(), 2u);
+}
@@ -0,0 +1,238 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "athread/athread.h"
+
+using namespace at;
+using namespace std::chrono_literals;
+
+namespace
+{
+// a -> {b, c} -> d, plus e on its own.
+void build_diamond(ThreadGraph& graph)
+{
+    auto a = graph.push([]() {}).set_label("a");
+    auto b = graph.push([]() {}).set_label("b").depend(a);
+    auto c = graph.push([]() {}).set_label("c").depend(a);
+    graph.push([]() {}).set_label("d").depend({b, c});
+    graph.push([]() {});
+}
+
+std::string read_file(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void write_file(const std::string& path, const std::string& content)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << content;
+}
+
+void set_id(std::string& content, std::size_t offset, std::uint32_t id)
+{
+    std::memcpy(&content[offset], &id, sizeof(id));
+}
+}  // namespace
+
+TEST(GraphSnapshot, SaveAndOpen)
+{
+    ThreadGraph graph(4);
+    build_diamond(graph);
+    std::string path = "test_graph_snapshot_open.atg";
+    GraphSnapshot::save(graph, path, {1us, 2us, 3us, 4us, 5us});
+
+    GraphSnapshot snapshot(path);
+    ASSERT_TRUE(snapshot.is_open());
+    EXPECT_EQ(snapshot.node_count(), 5u);
+    EXPECT_EQ(snapshot.edge_count(), 4u);
+    EXPECT_EQ(snapshot.width(), graph.width());
+    EXPECT_EQ(snapshot.label(0), "a");
+    EXPECT_EQ(snapshot.label(3), "d");
+    EXPECT_EQ(snapshot.label(4), "");
+    EXPECT_EQ(snapshot.cost(2), 3us);
+
+    auto ids = [](GraphSnapshot::Ids range) { return std::vector<std::uint32_t>(range.begin(), range.end()); };
+    EXPECT_EQ(ids(snapshot.successors(0)), (std::vector<std::uint32_t>{1, 2}));
+    EXPECT_EQ(ids(snapshot.predecessors(3)), (std::vector<std::uint32_t>{1, 2}));
+    EXPECT_EQ(snapshot.predecessors(0).size(), 0u);
+    EXPECT_EQ(snapshot.successors(4).size(), 0u);
+
+    snapshot.close();
+    EXPECT_FALSE(snapshot.is_open());
+    EXPECT_EQ(snapshot.node_count(), 0u);
+    std::remove(path.c_str());
+
+    EXPECT_THROW(GraphSnapshot::save(graph, path, {1us}), std::invalid_argument);
+    EXPECT_THROW(GraphSnapshot::save(graph, "missing_directory/graph.atg"), std::runtime_error);
+}
+
+TEST(GraphSnapshot, CostsFromTheProfile)
+{
+    ThreadGraph graph(2);
+    graph.set_profiling(true);
+    auto a = graph.push([]() { std::this_thread::sleep_for(2ms); });
+    graph.push([]() {}).depend(a);
+    graph.start();
+    graph.wait();
+
+    std::string path = "test_graph_snapshot_profile.atg";
+    GraphSnapshot::save(graph, path);
+    GraphSnapshot snapshot(path);
+    EXPECT_GE(snapshot.cost(0), 2ms);
+    EXPECT_LT(snapshot.cost(1), 2ms);
+    std::remove(path.c_str());
+}
+
+TEST(GraphSnapshot, RestoreRunsInDependencyOrder)
+{
+    std::string path = "test_graph_snapshot_restore.atg";
+    std::uint32_t width = 0;
+    {
+        ThreadGraph graph(4);
+        build_diamond(graph);
+        width = graph.width();
+        GraphSnapshot::save(graph, path);
+    }
+
+    GraphSnapshot snapshot(path);
+    ThreadGraph graph(4);
+    std::mutex mutex;
+    std::vector<std::uint32_t> order;
+    std::vector<Task> tasks = snapshot.restore(graph,
+                                               [&](std::uint32_t id, std::string_view)
+                                               {
+                                                   return [&, id]()
+                                                   {
+                                                       std::lock_guard<std::mutex> lock(mutex);
+                                                       order.push_back(id);
+                                                   };
+                                               });
+    snapshot.close();  // The graph keeps no reference to the mapping.
+
+    ASSERT_EQ(tasks.size(), 5u);
+    EXPECT_EQ(graph.task_size(), 5u);
+    EXPECT_STREQ(tasks[3].label(), "d");
+    EXPECT_EQ(tasks[4].label(), nullptr);
+    EXPECT_EQ(tasks[0].successors_size(), 2u);
+    EXPECT_EQ(tasks[3].predecessor_at(0), tasks[1]);
+    EXPECT_EQ(tasks[3].predecessor_at(1), tasks[2]);
+    EXPECT_EQ(graph.width(), width);
+
+    graph.start();
+    graph.wait();
+    ASSERT_EQ(order.size(), 5u);
+    auto position = [&order](std::uint32_t id) { return std::find(order.begin(), order.end(), id) - order.begin(); };
+    EXPECT_LT(position(0), position(1));
+    EXPECT_LT(position(0), position(2));
+    EXPECT_LT(position(1), position(3));
+    EXPECT_LT(position(2), position(3));
+    std::remove(path.c_str());
+}
+
+TEST(GraphSnapshot, RestoreNodesAfterExistingOnes)
+{
+    std::string path = "test_graph_snapshot_nodes.atg";
+    {
+        ThreadGraph graph(2);
+        auto a = graph.push([]() {});
+        graph.push([]() {}).depend(a);
+        GraphSnapshot::save(graph, path);
+    }
+
+    ThreadGraph graph(2);
+    graph.push([]() {});
+    std::atomic_int runs{0};
+    GraphSnapshot snapshot(path);
+    auto tasks = snapshot.restore(graph,
+                                  [&runs](std::uint32_t, std::string_view) -> INode*
+                                  { return new NodeHolder<std::function<void()>>([&runs]() { runs++; }); });
+    ASSERT_EQ(tasks.size(), 2u);
+    EXPECT_EQ(graph.task_size(), 3u);
+    EXPECT_EQ(graph.task_at(1), tasks[0]);
+    EXPECT_EQ(tasks[1].predecessor_at(0), tasks[0]);
+
+    graph.start();
+    graph.wait();
+    EXPECT_EQ(runs, 2);
+    std::remove(path.c_str());
+}
+
+TEST(GraphSnapshot, RejectsInvalidFiles)
+{
+    ThreadGraph graph(2);
+    build_diamond(graph);
+    std::string path = "test_graph_snapshot_invalid.atg";
+    GraphSnapshot::save(graph, path);
+    std::string content = read_file(path);
+
+    GraphSnapshot snapshot;
+    EXPECT_THROW(snapshot.restore(graph, [](std::uint32_t, std::string_view) { return []() {}; }),
+                 std::runtime_error);
+    EXPECT_THROW(snapshot.open("missing_graph_snapshot.atg"), std::runtime_error);
+
+    write_file(path, content.substr(0, content.size() - 1));
+    EXPECT_THROW(snapshot.open(path), std::runtime_error);
+    EXPECT_FALSE(snapshot.is_open());
+
+    std::string bad_magic = content;
+    bad_magic[0] = 'X';
+    write_file(path, bad_magic);
+    EXPECT_THROW(snapshot.open(path), std::runtime_error);
+
+    // The first successor id is the first word after the successor offsets.
+    std::string bad_id = content;
+    std::size_t successor_ids = 48 + 8 * 6 + 4 * 4 + 8 * 6;
+    set_id(bad_id, successor_ids, 9);
+    write_file(path, bad_id);
+    EXPECT_THROW(snapshot.open(path), std::runtime_error);
+
+    // In range, but the successors of a no longer mirror the predecessors.
+    std::string mismatch = content;
+    set_id(mismatch, successor_ids, 3);
+    write_file(path, mismatch);
+    EXPECT_THROW(snapshot.open(path), std::runtime_error);
+
+    write_file(path, content);
+    snapshot.open(path);
+    EXPECT_EQ(snapshot.node_count(), 5u);
+    std::remove(path.c_str());
+}
+
+TEST(GraphSnapshot, RejectsCycles)
+{
+    ThreadGraph graph(2);
+    auto a = graph.push([]() {});
+    auto b = graph.push([]() {}).depend(a);
+    graph.push([]() {}).depend(b);
+    std::string path = "test_graph_snapshot_cycle.atg";
+    GraphSnapshot::save(graph, path);
+    std::string content = read_file(path);
+
+    // Same degrees, edges a -> c and b -> b: the lists mirror each other but b waits on itself.
+    std::size_t predecessor_ids = 48 + 8 * 4;
+    std::size_t successor_ids = predecessor_ids + 8 + 8 * 4;
+    set_id(content, predecessor_ids, 1);
+    set_id(content, predecessor_ids + 4, 0);
+    set_id(content, successor_ids, 2);
+    set_id(content, successor_ids + 4, 1);
+    write_file(path, content);
+
+    GraphSnapshot snapshot;
+    EXPECT_THROW(snapshot.open(path), std::runtime_error);
+    EXPECT_FALSE(snapshot.is_open());
+    std::remove(path.c_str());
+}
@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "athread/athread.h"
+
+using namespace at;
+
+class TempFile
+{
+public:
+    TempFile()
+    {
+        char path[] = "/tmp/athread_io_XXXXXX";
+        fd = ::mkstemp(path);
+        name = path;
+    }
+    ~TempFile()
+    {
+        ::close(fd);
+        ::unlink(name.c_str());
+    }
+
+    int fd;
+    std::string name;
+};
+
+class IoBackendTest : public ::testing::TestWithParam<IoBackend>
+{
+protected:
+    void SetUp() override
+    {
+        if (GetParam() == IoBackend::Uring && !IoContext::uring_available()) GTEST_SKIP() << "io_uring unavailable";
+    }
+};
+
+TEST_P(IoBackendTest, FutureRoundTrip)
+{
+    IoContext io(8, GetParam());
+    TempFile file;
+    ASSERT_GE(file.fd, 0);
+
+    const std::string text = "hello athread";
+    EXPECT_EQ(io.write(file.fd, text.data(), text.size(), 4).get(), text.size());
+
+    std::string back(text.size(), '\0');
+    EXPECT_EQ(io.read(file.fd, &back[0], back.size(), 4).get(), text.size());
+    EXPECT_EQ(back, text);
+}
+
+TEST_P(IoBackendTest, ManyRequestsInFlight)
+{
+    IoContext io(4, GetParam());
+    TempFile file;
+    ASSERT_GE(file.fd, 0);
+
+    const int count = 64;
+    std::vector<std::uint32_t> values(count);
+    std::atomic<int> completed{0};
+    for (int i = 0; i < count; i++)
+    {
+        values[i] = i * 7;
+        io.write(file.fd, &values[i], sizeof(values[i]), i * sizeof(std::uint32_t),
+                 [&completed](long result)
+                 {
+                     if (result == sizeof(std::uint32_t)) ++completed;
+                 });
+    }
+    while (io.in_flight() > 0) std::this_thread::yield();
+    EXPECT_EQ(completed.load(), count);
+
+    std::vector<std::uint32_t> back(count);
+    EXPECT_EQ(io.read(file.fd, back.data(), count * sizeof(std::uint32_t), 0).get(), count * sizeof(std::uint32_t));
+    EXPECT_EQ(back, values);
+}
+
+TEST_P(IoBackendTest, FutureReportsError)
+{
+    IoContext io(8, GetParam());
+    char buffer[16];
+    EXPECT_THROW(io.read(-1, buffer, sizeof(buffer), 0).get(), std::system_error);
+}
+
+TEST_P(IoBackendTest, GraphNodesCompleteAsynchronously)
+{
+    IoContext io(8, GetParam());
+    TempFile file;
+    ASSERT_GE(file.fd, 0);
+
+    const std::string text = "async graph node";
+    std::string back(text.size(), '\0');
+    std::string processed;
+
+    ThreadGraph graph(1);
+    auto store = graph.emplace<IoWriteNode>(io, file.fd, text.data(), text.size(), 0);
+    auto load = graph.emplace<IoReadNode>(io, file.fd, &back[0], back.size(), 0);
+    auto process = graph.push([&back, &processed]() { processed = back + "!"; });
+    load.depend(store);
+    process.depend(load);
+
+    graph.start();
+    graph.wait();
+
+    EXPECT_EQ(processed, text + "!");
+    EXPECT_EQ(load.state(), Task::COMPLETED);
+}
+
+TEST_P(IoBackendTest, FailedNodeStopsGraph)
+{
+    IoContext io(8, GetParam());
+    char buffer[16];
+    bool executed = false;
+
+    ThreadGraph graph(1);
+    auto load = graph.emplace<IoReadNode>(io, -1, buffer, sizeof(buffer), 0);
+    auto process = graph.push([&executed]() { executed = true; });
+    process.depend(load);
+
+    graph.start();
+    EXPECT_THROW(graph.wait(), std::runtime_error);
+    EXPECT_FALSE(executed);
+    EXPECT_EQ(graph.stop_reason(), StopReason::Error);
+}
+
+INSTANTIATE_TEST_SUITE_P(IoContext, IoBackendTest, ::testing::Values(IoBackend::Threads, IoBackend::Uring));
+
+TEST(IoContext, FailedUringSubmissionIsTakenBack)
+{
+    if (!IoContext::uring_available()) GTEST_SKIP() << "io_uring unavailable";
+    TempFile file;
+    ASSERT_GE(file.fd, 0);
+    const std::string text = "submitted once";
+    std::atomic_int callbacks{0};
+    {
+        IoContext io(4, IoBackend::Uring);
+        IoContext::fail_uring_submissions(ENXIO, 1);
+        EXPECT_THROW(io.write(file.fd, text.data(), text.size(), 0, [&callbacks](long) { callbacks++; }),
+                     std::runtime_error);
+        EXPECT_EQ(io.in_flight(), 0u);
+
+        // The next enter submits only the new request, the failed one is gone from the ring.
+        std::string back(text.size(), '\0');
+        EXPECT_EQ(io.read(file.fd, &back[0], back.size(), 0).get(), 0u);
+        EXPECT_EQ(io.write(file.fd, text.data(), text.size(), 0).get(), text.size());
+    }
+    EXPECT_EQ(callbacks, 0);
+}
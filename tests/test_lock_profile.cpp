@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include "athread/athread.h"
+
+using namespace at;
+using namespace std::chrono_literals;
+
+TEST(ProfiledMutex, CountsContentionAndTimes)
+{
+    ProfiledMutex mutex;
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex);
+        std::this_thread::sleep_for(2ms);
+    }
+    EXPECT_TRUE(mutex.try_lock());
+    mutex.unlock();
+
+    std::atomic_bool held{false};
+    std::thread owner(
+        [&]()
+        {
+            std::lock_guard<ProfiledMutex> lock(mutex);
+            held = true;
+            std::this_thread::sleep_for(20ms);
+        });
+    while (!held) std::this_thread::yield();
+    EXPECT_FALSE(mutex.try_lock());
+    mutex.lock();
+    mutex.unlock();
+    owner.join();
+
+    LockStats stats = mutex.stats("test");
+    EXPECT_EQ(stats.name, "test");
+    EXPECT_EQ(stats.acquisitions, 4u);
+    EXPECT_EQ(stats.contended, 1u);
+    EXPECT_DOUBLE_EQ(stats.contention(), 0.25);
+    EXPECT_EQ(stats.wait_time.count(), 1u);
+    EXPECT_GE(stats.wait_time.max(), 1000000u);
+    EXPECT_EQ(stats.hold_time.count(), 4u);
+    EXPECT_GE(stats.hold_time.max(), 20000000u);
+}
+
+TEST(ProfiledMutex, WaitsOnConditionVariableAny)
+{
+    ProfiledMutex mutex;
+    std::condition_variable_any condition;
+    bool ready = false;
+    std::thread notifier;
+    {
+        // Locked before the notifier starts, so it can only set the flag once the wait released the lock.
+        std::unique_lock<ProfiledMutex> lock(mutex);
+        notifier = std::thread(
+            [&]()
+            {
+                std::lock_guard<ProfiledMutex> lock(mutex);
+                ready = true;
+                condition.notify_one();
+            });
+        condition.wait(lock, [&]() { return ready; });
+    }
+    notifier.join();
+
+    LockStats stats = mutex.stats("condition");
+    EXPECT_GE(stats.acquisitions, 3u);  // The wait, the notifier and the wake up.
+    EXPECT_EQ(stats.hold_time.count(), stats.acquisitions);
+}
+
+TEST(LockReport, PoolLocks)
+{
+    ThreadPool pool(2, 2);
+    for (int i = 0; i < 100; i++) pool.push([]() {});
+    while (pool.metrics().completed < 100) std::this_thread::sleep_for(1ms);
+
+    std::vector<LockStats> stats = pool.lock_stats();
+#ifdef AT_PROFILE_LOCKS
+    ASSERT_EQ(stats.size(), 2u);
+    EXPECT_EQ(stats[0].name, "pool.workers");
+    EXPECT_GE(stats[0].acquisitions, 100u);
+    EXPECT_EQ(stats[1].name, "pool.task_queue");
+    EXPECT_GE(stats[1].acquisitions, 200u);  // Every task is pushed and taken under the lock.
+#else
+    EXPECT_TRUE(stats.empty());
+    EXPECT_TRUE(ThreadGraph(1).lock_stats().empty());
+    ProfiledMutex mutex;
+    mutex.lock();
+    mutex.unlock();
+    stats.push_back(mutex.stats("pool.task_queue"));
+#endif
+
+    std::ostringstream out;
+    write_lock_report(out, stats);
+    std::string text = out.str();
+    EXPECT_EQ(text.compare(0, 4, "lock"), 0);
+    EXPECT_NE(text.find("\npool.task_queue "), std::string::npos);
+    EXPECT_NE(text.find('%'), std::string::npos);
+}
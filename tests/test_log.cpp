@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+
+// Everything from debug up is compiled in this file, whatever the build sets.
+#undef AT_LOG_LEVEL
+#define AT_LOG_LEVEL 1
+
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "athread/athread.h"
+
+using namespace at;
+
+namespace
+{
+std::vector<LogRecord> drain_all()
+{
+    std::vector<LogRecord> records;
+    Log::drain(records);
+    return records;
+}
+
+int counted = 0;
+int count() { return ++counted; }
+
+enum class Color
+{
+    Red = 2
+};
+}  // namespace
+
+TEST(Log, FilteredStatementsAreNotEvaluated)
+{
+    drain_all();
+    AT_LOG_TRACE("never {}", count());
+    EXPECT_EQ(counted, 0);
+    EXPECT_TRUE(drain_all().empty());
+
+    AT_LOG_DEBUG("once {}", count());
+    EXPECT_EQ(counted, 1);
+    EXPECT_EQ(drain_all().size(), 1u);
+}
+
+TEST(Log, FormatsWhenWritten)
+{
+    drain_all();
+    const char* name = "pool";
+    AT_LOG_INFO("{} has {} workers, {} busy, load {} {} {}", name, 4u, -1, 0.5, true, Color::Red);
+    AT_LOG_WARN("no arguments {}");
+
+    std::vector<LogRecord> records = drain_all();
+    ASSERT_EQ(records.size(), 2u);
+    EXPECT_EQ(records[0].level, LogLevel::Info);
+    EXPECT_EQ(records[0].arg_count, 6u);
+    EXPECT_EQ(records[0].worker_id, invalid_worker_id);
+    EXPECT_EQ(records[0].text(), "pool has 4 workers, -1 busy, load 0.5 true 2");
+    EXPECT_EQ(records[1].text(), "no arguments {}");
+
+    std::ostringstream out;
+    Log::write(out, records[1]);
+    EXPECT_EQ(out.str().rfind("WARN test_log.cpp:", 0), 0u) << out.str();
+    EXPECT_NE(out.str().find(" no arguments {}\n"), std::string::npos);
+}
+
+TEST(Log, FlushesOtherThreadsAndWorkers)
+{
+    drain_all();
+    std::thread([]() { AT_LOG_DEBUG("from a thread"); }).join();
+
+    ThreadPool pool(1, 1);
+    std::atomic_bool done{false};
+    pool.push(
+        [&done]()
+        {
+            AT_LOG_DEBUG("from a worker");
+            done = true;
+        });
+    while (!done) std::this_thread::yield();
+
+    std::ostringstream out;
+    EXPECT_GE(Log::flush(out), 2u);  // The library logs too when built with a lower level.
+    EXPECT_NE(out.str().find("from a thread"), std::string::npos);
+    EXPECT_NE(out.str().find("[worker 0] from a worker"), std::string::npos);
+    pool.terminate(true);
+    Log::flush(out);
+    EXPECT_EQ(Log::flush(out), 0u);
+}
@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "athread/athread.h"
+
+using namespace at;
+using namespace std::chrono_literals;
+
+namespace
+{
+bool contains(const std::string& text, const std::string& part) { return text.find(part) != std::string::npos; }
+
+std::size_t count(const std::string& text, const std::string& part)
+{
+    std::size_t n = 0;
+    for (auto pos = text.find(part); pos != std::string::npos; pos = text.find(part, pos + 1)) n++;
+    return n;
+}
+}  // namespace
+
+TEST(GraphMetrics, CountsRunsAndNodes)
+{
+    ThreadGraph graph(2, false);
+    graph.set_profiling(true);
+    auto a = graph.push([]() { std::this_thread::sleep_for(1ms); });
+    graph.push([]() {}).depend(a);
+    graph.push([]() {}).depend(a);
+
+    graph.start();
+    graph.wait();
+    graph.start();
+    graph.wait();
+
+    GraphMetrics metrics = graph.metrics();
+    EXPECT_EQ(metrics.runs, 2u);
+    EXPECT_EQ(metrics.failed_runs, 0u);
+    EXPECT_EQ(metrics.nodes_started, 6u);
+    EXPECT_EQ(metrics.node_count, 3u);
+    EXPECT_EQ(metrics.live_workers, 0u);
+    EXPECT_EQ(metrics.idle_workers, 0u);
+    EXPECT_FALSE(metrics.executing);
+    EXPECT_GE(metrics.last_makespan, 1000000u);
+    EXPECT_GE(metrics.last_work, metrics.last_span);
+
+    graph.push([]() { throw std::runtime_error("boom"); });
+    graph.start();
+    EXPECT_THROW(graph.wait(), std::runtime_error);
+    EXPECT_EQ(graph.metrics().failed_runs, 1u);
+}
+
+TEST(MetricsExporter, PrometheusText)
+{
+    ThreadPool pool(1, 1);
+    pool.set_latency_sample_period(1);
+    for (int i = 0; i < 10; i++) pool.push([]() {});
+    while (pool.metrics().completed < 10) std::this_thread::sleep_for(1ms);
+
+    ThreadGraph graph(1);
+    graph.push([]() {});
+    graph.start();
+    graph.wait();
+
+    MetricsExporter exporter;
+    exporter.add("io \"main\"", pool);
+    exporter.add("build", graph);
+    std::string text = exporter.render();
+
+    EXPECT_TRUE(contains(text, "# TYPE athread_pool_tasks_submitted_total counter\n"));
+    EXPECT_TRUE(contains(text, "athread_pool_tasks_submitted_total{pool=\"io \\\"main\\\"\"} 10\n"));
+    EXPECT_TRUE(contains(text, "athread_pool_tasks_completed_total{pool=\"io \\\"main\\\"\"} 10\n"));
+    EXPECT_TRUE(contains(text, "# TYPE athread_pool_queue_wait_seconds histogram\n"));
+    EXPECT_TRUE(contains(text, "athread_pool_execution_seconds_bucket{pool=\"io \\\"main\\\"\",le=\"+Inf\"} 10\n"));
+    EXPECT_TRUE(contains(text, "athread_pool_execution_seconds_count{pool=\"io \\\"main\\\"\"} 10\n"));
+    EXPECT_TRUE(contains(text, "athread_graph_runs_total{graph=\"build\"} 1\n"));
+    EXPECT_TRUE(contains(text, "athread_graph_executing{graph=\"build\"} 0\n"));
+    EXPECT_FALSE(contains(text, "# EOF"));
+
+    // One declaration per family, every sample line ends with a value.
+    EXPECT_EQ(count(text, "# TYPE athread_pool_workers_live "), 1u);
+    std::istringstream lines(text);
+    for (std::string line; std::getline(lines, line);)
+    {
+        ASSERT_FALSE(line.empty());
+        if (line[0] != '#')
+        {
+            EXPECT_TRUE(isdigit(static_cast<unsigned char>(line.back()))) << line;
+        }
+    }
+
+    exporter.remove("build");
+    EXPECT_FALSE(contains(exporter.render(), "athread_graph_"));
+}
+
+TEST(MetricsExporter, OpenMetricsText)
+{
+    ThreadPool pool(1, 1);
+    MetricsExporter exporter(MetricsFormat::OpenMetrics, "app");
+    exporter.add("default", pool);
+    std::string text = exporter.render();
+
+    EXPECT_TRUE(contains(text, "# TYPE app_pool_tasks_submitted counter\n"));
+    EXPECT_TRUE(contains(text, "app_pool_tasks_submitted_total{pool=\"default\"} 0\n"));
+    EXPECT_TRUE(contains(text, "# TYPE app_pool_workers_live gauge\n"));
+    ASSERT_GE(text.size(), 6u);
+    EXPECT_EQ(text.substr(text.size() - 6), "# EOF\n");
+}
+
+TEST(MetricsExporter, FileAndCallback)
+{
+    ThreadPool pool(1, 1);
+    MetricsExporter exporter;
+    exporter.add("default", pool);
+
+    std::string path = "test_metrics_export.prom";
+    exporter.write_file(path);
+    std::ifstream in(path);
+    std::stringstream content;
+    content << in.rdbuf();
+    EXPECT_TRUE(contains(content.str(), "athread_pool_workers_live{pool=\"default\"}"));
+    std::remove(path.c_str());
+    EXPECT_THROW(exporter.write_file("missing_directory/metrics.prom"), std::runtime_error);
+
+    std::atomic_int calls{0};
+    exporter.start([&calls](const std::string& text) { calls += contains(text, "athread_pool_") ? 1 : 0; }, 1ms);
+    EXPECT_THROW(exporter.start([](const std::string&) {}), std::runtime_error);
+    std::this_thread::sleep_for(20ms);
+    exporter.stop();
+    EXPECT_GE(calls.load(), 2);
+    exporter.stop();
+}
@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+
+#include "athread/athread.h"
+
+using namespace at;
+using namespace std::chrono_literals;
+
+namespace
+{
+class CountingObserver : public Observer
+{
+public:
+    void on_worker_start(std::uint32_t) override { worker_starts++; }
+    void on_worker_stop(std::uint32_t) override { worker_stops++; }
+    void on_task_enqueue(std::uint32_t worker_id, std::uint64_t) override
+    {
+        enqueues++;
+        if (worker_id == invalid_worker_id) external_enqueues++;
+    }
+    void on_task_begin(std::uint32_t worker_id, std::uint64_t task_id) override
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        workers.insert(worker_id);
+        running.insert(task_id);
+    }
+    void on_task_end(std::uint32_t, std::uint64_t task_id) override
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (running.erase(task_id)) ends++;
+    }
+    void on_park(std::uint32_t) override { parks++; }
+    void on_steal(std::uint32_t, std::uint64_t) override { steals++; }
+
+    std::atomic_int worker_starts{0};
+    std::atomic_int worker_stops{0};
+    std::atomic_int enqueues{0};
+    std::atomic_int external_enqueues{0};
+    std::atomic_int ends{0};
+    std::atomic_int parks{0};
+    std::atomic_int steals{0};
+
+    std::mutex mutex;
+    std::set<std::uint32_t> workers;
+    std::set<std::uint64_t> running;
+};
+}  // namespace
+
+TEST(Observer, ReceivesPoolEvents)
+{
+    CountingObserver observer;
+    ThreadPool pool(2, 2, std::chrono::seconds(60), true);
+    pool.set_observer(&observer);
+    EXPECT_EQ(pool.observer(), &observer);
+
+    std::atomic_int done{0};
+    for (int i = 0; i < 20; i++) pool.push([&done]() { done++; });
+    pool.start();
+    while (done < 20) std::this_thread::sleep_for(1ms);
+
+    pool.terminate(true);
+    EXPECT_EQ(observer.worker_starts, 2);
+    EXPECT_EQ(observer.worker_stops, 2);
+    EXPECT_EQ(observer.enqueues, 20);
+    EXPECT_EQ(observer.external_enqueues, 20);
+    EXPECT_EQ(observer.ends, 20);
+    EXPECT_TRUE(observer.running.empty());
+    EXPECT_GE(observer.parks, 2);  // Both workers wait for the start signal.
+    EXPECT_EQ(observer.steals, 0);
+    for (auto worker : observer.workers) EXPECT_LT(worker, 2u);
+}
+
+TEST(Observer, ReceivesGraphEvents)
+{
+    CountingObserver observer;
+    ThreadGraph graph(2, false);
+    graph.set_observer(&observer);
+
+    auto a = graph.push([]() {});
+    for (int i = 0; i < 4; i++) graph.push([]() {}).depend(a);
+    graph.start();
+    graph.wait();
+
+    EXPECT_EQ(observer.worker_starts, 2);
+    EXPECT_EQ(observer.worker_stops, 2);
+    EXPECT_EQ(observer.ends, 5);
+    EXPECT_EQ(observer.enqueues, 0);
+
+    // Detached, the next run reports nothing.
+    graph.set_observer(nullptr);
+    graph.start();
+    graph.wait();
+    EXPECT_EQ(observer.ends, 5);
+    EXPECT_EQ(observer.worker_starts, 2);
+}
+
+TEST(Observer, ThrowingTaskEnds)
+{
+    CountingObserver observer;
+    ThreadGraph graph(1, false);
+    graph.set_observer(&observer);
+    graph.push([]() { throw std::runtime_error("boom"); });
+    graph.start();
+    EXPECT_THROW(graph.wait(), std::runtime_error);
+
+    EXPECT_EQ(observer.ends, 1);
+    EXPECT_TRUE(observer.running.empty());
+}
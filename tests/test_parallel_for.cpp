@@ -0,0 +1,185 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "athread/athread.h"
+
+using namespace at;
+
+class TempPath
+{
+public:
+    explicit TempPath(const std::string& content)
+    {
+        char buffer[] = "/tmp/athread_mapped_XXXXXX";
+        int fd = ::mkstemp(buffer);
+        ::close(fd);
+        path = buffer;
+        std::ofstream(path, std::ios::binary) << content;
+    }
+    ~TempPath() { ::unlink(path.c_str()); }
+
+    std::string path;
+};
+
+static std::string length_prefixed(const std::vector<std::string>& records)
+{
+    std::string data;
+    for (const auto& record : records)
+    {
+        std::uint32_t size = static_cast<std::uint32_t>(record.size());
+        for (int i = 0; i < 4; i++) data.push_back(static_cast<char>((size >> (8 * i)) & 0xff));
+        data += record;
+    }
+    return data;
+}
+
+TEST(ParallelFor, VisitsEveryIndexOnce)
+{
+    ThreadPool pool(4, 4);
+    std::vector<std::atomic<int>> visits(1000);
+
+    parallel_for(pool, 0, 1000, [&visits](int i) { ++visits[i]; }, 37);
+
+    for (auto& v : visits) EXPECT_EQ(v.load(), 1);
+}
+
+TEST(ParallelFor, EmptyRange)
+{
+    ThreadPool pool(2, 2);
+    bool called = false;
+    parallel_for(pool, 5, 5, [&called](int) { called = true; });
+    EXPECT_FALSE(called);
+}
+
+TEST(ParallelFor, RethrowsFirstException)
+{
+    ThreadPool pool(2, 2);
+    std::atomic<int> visited{0};
+    EXPECT_THROW(parallel_for(
+                     pool, 0, 100,
+                     [&visited](int i)
+                     {
+                         ++visited;
+                         if (i == 42) throw std::logic_error("boom");
+                     },
+                     10),
+                 std::logic_error);
+}
+
+TEST(ParallelFor, RejectedByTerminatedPool)
+{
+    ThreadPool pool(2, 2);
+    pool.terminate(false);
+    EXPECT_THROW(parallel_for(pool, 0, 10, [](int) {}), std::runtime_error);
+    pool.wait();
+}
+
+TEST(MappedFile, MapsContent)
+{
+    TempPath file("hello\nworld\n");
+    MappedFile mapped(file.path);
+    ASSERT_TRUE(mapped.is_open());
+    EXPECT_EQ(mapped.view(), "hello\nworld\n");
+    EXPECT_EQ(mapped.view(6, 100), "world\n");
+
+    MappedFile moved(std::move(mapped));
+    EXPECT_FALSE(mapped.is_open());
+    EXPECT_EQ(moved.size(), 12u);
+}
+
+TEST(MappedFile, EmptyFile)
+{
+    TempPath file("");
+    MappedFile mapped(file.path);
+    EXPECT_TRUE(mapped.is_open());
+    EXPECT_EQ(mapped.size(), 0u);
+    EXPECT_TRUE(partition_records(mapped, 16, RecordFormat::Newline).empty());
+}
+
+TEST(MappedFile, MissingFileThrows) { EXPECT_THROW(MappedFile("/nonexistent/athread"), std::runtime_error); }
+
+TEST(PartitionRecords, NewlineChunksEndOnRecordBoundaries)
+{
+    std::string data;
+    for (int i = 0; i < 200; i++) data += "line " + std::to_string(i) + "\n";
+    data += "last line without newline";
+
+    auto chunks = partition_records(data, 64, RecordFormat::Newline);
+    ASSERT_GT(chunks.size(), 1u);
+
+    std::size_t expected_offset = 0;
+    for (std::size_t i = 0; i < chunks.size(); i++)
+    {
+        EXPECT_EQ(chunks[i].offset, expected_offset);
+        if (i + 1 < chunks.size())
+        {
+            EXPECT_GE(chunks[i].size, 64u);
+            EXPECT_EQ(data[chunks[i].offset + chunks[i].size - 1], '\n');
+        }
+        expected_offset += chunks[i].size;
+    }
+    EXPECT_EQ(expected_offset, data.size());
+}
+
+TEST(PartitionRecords, LengthPrefixedRecords)
+{
+    std::vector<std::string> records;
+    for (int i = 0; i < 50; i++) records.push_back(std::string(i % 7 + 1, 'a' + i % 26));
+    std::string data = length_prefixed(records);
+
+    auto chunks = partition_records(data, 32, RecordFormat::LengthPrefixed);
+    std::vector<std::string> back;
+    for (const auto& chunk : chunks)
+    {
+        for_each_record(std::string_view(data).substr(chunk.offset, chunk.size), RecordFormat::LengthPrefixed,
+                        [&back](std::string_view record) { back.emplace_back(record); });
+    }
+    EXPECT_EQ(back, records);
+}
+
+TEST(PartitionRecords, TruncatedLengthPrefixedRecordThrows)
+{
+    std::string data = length_prefixed({"abcdef"});
+    data.pop_back();
+    EXPECT_THROW(partition_records(data, 32, RecordFormat::LengthPrefixed), std::runtime_error);
+}
+
+TEST(ParallelFor, MappedFileLines)
+{
+    std::string content;
+    long expected = 0;
+    for (int i = 0; i < 5000; i++)
+    {
+        content += std::to_string(i) + "\n";
+        expected += i;
+    }
+    TempPath file(content);
+    MappedFile mapped(file.path);
+
+    ThreadPool pool(4, 4);
+    std::atomic<long> sum{0};
+    std::atomic<int> lines{0};
+    parallel_for(pool, mapped, 1024, RecordFormat::Newline,
+                 [&sum, &lines](std::string_view chunk)
+                 {
+                     long local = 0;
+                     for_each_record(chunk, RecordFormat::Newline,
+                                     [&local, &lines](std::string_view line)
+                                     {
+                                         local += std::stol(std::string(line));
+                                         ++lines;
+                                     });
+                     sum += local;
+                 });
+
+    EXPECT_EQ(lines.load(), 5000);
+    EXPECT_EQ(sum.load(), expected);
+}
@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+#include "athread/athread.h"
+
+using namespace at;
+using namespace std::chrono_literals;
+
+namespace
+{
+// Some work for the counters, kept from being optimized away.
+std::uint64_t spin(int rounds)
+{
+    volatile std::uint64_t sum = 0;
+    for (int i = 0; i < rounds; i++) sum = sum + static_cast<std::uint64_t>(i) * 7;
+    return sum;
+}
+}  // namespace
+
+TEST(PerfCounts, Arithmetic)
+{
+    PerfCounts before;
+    before.values = {100, 200, 5, 1};
+    before.valid = 0b1011;
+    PerfCounts after = before;
+    after.values = {400, 800, 9, 3};
+
+    PerfCounts delta = after - before;
+    EXPECT_EQ(delta.cycles(), 300u);
+    EXPECT_EQ(delta.instructions(), 600u);
+    EXPECT_FALSE(delta.has(PerfEvent::CacheMisses));
+    EXPECT_EQ(delta.cache_misses(), 0u);
+    EXPECT_EQ(delta.context_switches(), 2u);
+    EXPECT_DOUBLE_EQ(delta.ipc(), 2.0);
+
+    PerfCounts sum;
+    sum += delta;
+    sum += delta;
+    EXPECT_EQ(sum.cycles(), 600u);
+    EXPECT_EQ(sum.valid, delta.valid);
+    EXPECT_DOUBLE_EQ(PerfCounts().ipc(), 0.0);
+}
+
+TEST(PerfCounters, ReadsTheCallingThread)
+{
+    PerfCounters& counters = PerfCounters::thread();
+    EXPECT_EQ(&counters, &PerfCounters::thread());
+    EXPECT_EQ(PerfCounters::opened(), &counters);
+
+    // Whatever the system provides, reads never fail and only available events are valid.
+    PerfCounts before = counters.read();
+    spin(100000);
+    PerfCounts after = counters.read();
+    EXPECT_EQ(before.valid & ~counters.available(), 0u);
+    PerfCounts delta = after - before;
+    if (delta.has(PerfEvent::Instructions))
+    {
+        EXPECT_GE(delta.instructions(), 100000u);
+    }
+
+    std::thread([]() { EXPECT_EQ(PerfCounters::opened(), nullptr); }).join();
+}
+
+TEST(PerfCounters, GraphProfileReport)
+{
+    ThreadGraph graph(2, false);
+    graph.set_profiling(true);
+    graph.set_perf_counters(true);
+    auto a = graph.push([]() { spin(100000); });
+    graph.push([]() { spin(100000); }).depend(a);
+    graph.start();
+    graph.wait();
+
+    const GraphProfile& profile = graph.profile();
+    EXPECT_TRUE(profile.perf_counters);
+    for (const auto& node : profile.nodes) EXPECT_EQ(node.counters.valid, profile.counters.valid);
+
+    std::ostringstream report;
+    profile.write_report(report);
+    EXPECT_NE(report.str().find("perf counters"), std::string::npos);
+    if (!profile.counters.valid)
+    {
+        EXPECT_NE(report.str().find("unavailable"), std::string::npos);
+    }
+}
+
+TEST(PerfCounters, PoolMetrics)
+{
+    ThreadPool pool(1, 1);
+    EXPECT_FALSE(pool.perf_counters());
+    pool.set_perf_counters(true);
+    for (int i = 0; i < 4; i++) pool.push([]() { spin(10000); });
+    while (pool.metrics().completed < 4) std::this_thread::sleep_for(1ms);
+
+    PoolMetrics metrics = pool.metrics();
+    if (metrics.counters.has(PerfEvent::Instructions))
+    {
+        EXPECT_GE(metrics.counters.instructions(), 40000u);
+    }
+
+    MetricsExporter exporter;
+    exporter.add("p", pool);
+    std::string text = exporter.render();
+    EXPECT_EQ(text.find("athread_pool_context_switches_total") != std::string::npos,
+              metrics.counters.has(PerfEvent::ContextSwitches));
+}
@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+
+#include "athread/athread.h"
+
+using namespace at;
+using namespace std::chrono_literals;
+
+namespace
+{
+// Polls `condition` for up to two seconds.
+bool eventually(const std::function<bool()>& condition)
+{
+    auto deadline = std::chrono::steady_clock::now() + 2s;
+    while (!condition())
+    {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(1ms);
+    }
+    return true;
+}
+}  // namespace
+
+TEST(LatencyHistogram, BucketsBoundTheRelativeError)
+{
+    std::size_t previous = 0;
+    for (std::uint64_t value = 0; value < (std::uint64_t(1) << 40); value = value * 5 / 4 + 1)
+    {
+        std::size_t bucket = LatencyHistogram::bucket_of(value);
+        ASSERT_LT(bucket, LatencyHistogram::bucket_count);
+        EXPECT_GE(bucket, previous);
+        EXPECT_GE(LatencyHistogram::bucket_upper_bound(bucket), value);
+        EXPECT_LE(LatencyHistogram::bucket_upper_bound(bucket), value + value / 8);
+        if (bucket > 0)
+        {
+            EXPECT_LT(LatencyHistogram::bucket_upper_bound(bucket - 1), value);
+        }
+        previous = bucket;
+    }
+    EXPECT_EQ(LatencyHistogram::bucket_of(UINT64_MAX), LatencyHistogram::bucket_count - 1);
+}
+
+TEST(LatencyHistogram, Percentiles)
+{
+    LatencyHistogram histogram;
+    for (std::uint64_t value = 1; value <= 1000; value++) histogram.record(value);
+
+    HistogramSnapshot snapshot;
+    histogram.add_to(snapshot);
+    EXPECT_EQ(snapshot.count(), 1000u);
+    EXPECT_EQ(snapshot.max(), 1000u);
+    EXPECT_DOUBLE_EQ(snapshot.mean(), 500.5);
+    EXPECT_GE(snapshot.percentile(50), 500u);
+    EXPECT_LE(snapshot.percentile(50), 563u);
+    EXPECT_GE(snapshot.percentile(99), 990u);
+    EXPECT_EQ(snapshot.percentile(100), 1000u);
+    EXPECT_EQ(HistogramSnapshot().percentile(50), 0u);
+
+    HistogramSnapshot merged;
+    merged.merge(snapshot);
+    merged.merge(snapshot);
+    EXPECT_EQ(merged.count(), 2000u);
+    EXPECT_EQ(merged.percentile(50), snapshot.percentile(50));
+}
+
+TEST(PoolMetrics, CountsTasksAndRecordsLatencies)
+{
+    // Held until both workers exist, push() only adds a worker when none is ready.
+    ThreadPool pool(2, 2, std::chrono::seconds(60), true);
+    pool.set_latency_sample_period(1);
+    constexpr int tasks = 200;
+    for (int i = 0; i < tasks; i++) pool.push([]() { std::this_thread::sleep_for(10us); });
+    ASSERT_TRUE(eventually([&]() { return pool.metrics().live_workers == 2; }));
+    pool.start();
+
+    ASSERT_TRUE(eventually([&]() { return pool.metrics().completed == tasks; }));
+    PoolMetrics metrics = pool.metrics();
+    EXPECT_EQ(metrics.submitted, static_cast<std::uint64_t>(tasks));
+    EXPECT_EQ(metrics.rejected, 0u);
+    EXPECT_EQ(metrics.queue_depth, 0u);
+    EXPECT_GE(metrics.max_queue_depth, 1u);
+    EXPECT_EQ(metrics.live_workers, 2u);
+    EXPECT_EQ(metrics.seasonal_workers, 0u);
+    EXPECT_EQ(metrics.queue_wait.count(), static_cast<std::uint64_t>(tasks));
+    EXPECT_EQ(metrics.execution_time.count(), static_cast<std::uint64_t>(tasks));
+    EXPECT_GE(metrics.execution_time.percentile(50), 10000u);
+    EXPECT_EQ(metrics.cpu_time.count(), static_cast<std::uint64_t>(tasks));
+    EXPECT_LE(metrics.cpu_time.sum(), metrics.execution_time.sum());
+
+    ASSERT_TRUE(eventually([&]() { return pool.metrics().idle_workers == 2; }));
+
+    pool.terminate(false);
+    EXPECT_FALSE(pool.push([]() {}));
+    pool.wait();
+    metrics = pool.metrics();
+    EXPECT_EQ(metrics.rejected, 1u);
+    EXPECT_EQ(metrics.live_workers, 0u);
+    EXPECT_EQ(metrics.idle_workers, 0u);
+}
+
+TEST(PoolMetrics, QueueDepthBeforeStart)
+{
+    ThreadPool pool(2, 2, std::chrono::seconds(60), true);
+    pool.set_latency_sample_period(1);
+    std::atomic_int done{0};
+    for (int i = 0; i < 10; i++) pool.push([&done]() { done++; });
+
+    EXPECT_EQ(pool.metrics().queue_depth, 10u);
+    EXPECT_EQ(pool.metrics().max_queue_depth, 10u);
+    EXPECT_TRUE(eventually([&]() { return pool.metrics().idle_workers == 2; }));
+
+    pool.start();
+    ASSERT_TRUE(eventually([&]() { return pool.metrics().completed == 10; }));
+    EXPECT_EQ(pool.metrics().queue_depth, 0u);
+    EXPECT_EQ(pool.metrics().max_queue_depth, 10u);
+    EXPECT_GE(pool.metrics().queue_wait.max(), 1u);
+}
+
+TEST(PoolMetrics, SampledLatencies)
+{
+    ThreadPool pool(1, 1, std::chrono::seconds(60), true);
+    EXPECT_EQ(pool.latency_sample_period(), 16u);
+    for (int i = 0; i < 64; i++) pool.push([]() {});
+    pool.set_latency_sample_period(0);
+    for (int i = 0; i < 64; i++) pool.push([]() {});
+
+    pool.start();
+    ASSERT_TRUE(eventually([&]() { return pool.metrics().completed == 128; }));
+    EXPECT_EQ(pool.metrics().queue_wait.count(), 4u);
+    EXPECT_EQ(pool.metrics().execution_time.count(), 4u);
+}
+
+TEST(PoolMetrics, SeasonalWorkers)
+{
+    ThreadPool pool(1, 3, 20ms);
+    std::atomic_bool release{false};
+    for (int i = 0; i < 3; i++)
+    {
+        pool.push(
+            [&release]()
+            {
+                while (!release.load()) std::this_thread::sleep_for(1ms);
+            });
+        // Let the new worker pick the task, so the next push needs another worker.
+        ASSERT_TRUE(eventually([&]() { return pool.metrics().queue_depth == 0; }));
+    }
+
+    EXPECT_EQ(pool.metrics().live_workers, 3u);
+    EXPECT_EQ(pool.metrics().seasonal_workers, 2u);
+
+    release = true;
+    EXPECT_TRUE(eventually([&]() { return pool.metrics().seasonal_workers == 0; }));
+    EXPECT_EQ(pool.metrics().live_workers, 1u);
+}
@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+#include "athread/athread.h"
+
+using namespace at;
+using namespace std::chrono_literals;
+
+TEST(ScheduleSimulator, Chain)
+{
+    ThreadGraph graph(4);
+    auto a = graph.push([]() {});
+    auto b = graph.push([]() {}).depend(a);
+    auto c = graph.push([]() {}).depend(b);
+
+    ScheduleSimulator simulator(graph);
+    simulator.set_cost(a, 10us);
+    simulator.set_cost(b, 20us);
+    simulator.set_cost(c, 30us);
+    SimulatedSchedule schedule = simulator.run(4);
+
+    EXPECT_EQ(schedule.profile.makespan, 60us);
+    EXPECT_EQ(schedule.profile.work, 60us);
+    EXPECT_EQ(schedule.profile.span, 60us);
+    EXPECT_EQ(schedule.profile.worker_count, 1u);  // Capped at the width of the graph, as start() does.
+    EXPECT_EQ(schedule.profile.critical_path, (std::vector<std::uint64_t>{a.uid(), b.uid(), c.uid()}));
+    EXPECT_DOUBLE_EQ(schedule.utilization(), 1.0);
+
+    graph.set_optimized_threads(false);
+    EXPECT_DOUBLE_EQ(ScheduleSimulator(graph).run(4).utilization(), 0.25);
+
+    // The worker finishing a node goes on with its successor.
+    EXPECT_EQ(schedule.profile.nodes[1].worker, schedule.profile.nodes[0].worker);
+    EXPECT_EQ(schedule.profile.nodes[2].worker, schedule.profile.nodes[0].worker);
+    EXPECT_DOUBLE_EQ(schedule.utilization(schedule.profile.nodes[0].worker), 1.0);
+}
+
+TEST(ScheduleSimulator, FanOutAndThreadCount)
+{
+    ThreadGraph graph(8);
+    auto root = graph.push([]() {});
+    for (int i = 0; i < 4; i++) graph.push([]() {}).depend(root);
+
+    ScheduleSimulator simulator(graph);
+    simulator.set_default_cost(100us);
+    simulator.set_cost(root, 10us);
+
+    EXPECT_EQ(simulator.run(1).profile.makespan, 410us);
+    EXPECT_EQ(simulator.run(2).profile.makespan, 210us);
+    EXPECT_EQ(simulator.run(4).profile.makespan, 110us);
+    EXPECT_EQ(simulator.suggest_thread_count(8), 4u);
+    EXPECT_EQ(simulator.suggest_thread_count(8, 1.0), 2u);
+
+    simulator.set_dispatch_overhead(1us);
+    EXPECT_EQ(simulator.run(4).profile.makespan, 112us);
+
+    EXPECT_THROW(simulator.run(0), std::invalid_argument);
+    ThreadGraph other(1);
+    auto foreign = other.push([]() {});
+    EXPECT_THROW(simulator.set_cost(foreign, 1us), std::invalid_argument);
+    EXPECT_THROW(simulator.set_cost(root, -1us), std::invalid_argument);
+}
+
+TEST(ScheduleSimulator, CostsFromProfile)
+{
+    ThreadGraph graph(2);
+    graph.set_profiling(true);
+    auto a = graph.push([]() { std::this_thread::sleep_for(2ms); });
+    graph.push([]() { std::this_thread::sleep_for(1ms); }).depend(a);
+    graph.push([]() { std::this_thread::sleep_for(1ms); }).depend(a);
+    graph.start();
+    graph.wait();
+
+    ScheduleSimulator simulator(graph);
+    EXPECT_EQ(simulator.set_costs(graph.profile()), 3u);
+    SimulatedSchedule serial = simulator.run(1);
+    EXPECT_EQ(serial.profile.makespan, graph.profile().work);
+    EXPECT_DOUBLE_EQ(serial.utilization(), 1.0);
+
+    SimulatedSchedule parallel = simulator.run(2);
+    EXPECT_EQ(parallel.profile.makespan, graph.profile().span);
+    EXPECT_EQ(parallel.profile.critical_path.size(), 2u);
+    EXPECT_EQ(simulator.run(2).profile.makespan, parallel.profile.makespan);  // Deterministic.
+}
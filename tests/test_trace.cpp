@@ -0,0 +1,288 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "athread/athread.h"
+
+using namespace at;
+
+namespace
+{
+std::vector<TraceEvent> drain_all()
+{
+    std::vector<TraceEvent> events;
+    Trace::drain(events);
+    return events;
+}
+
+std::size_t count_of(const std::vector<TraceEvent>& events, TraceEventType type)
+{
+    std::size_t count = 0;
+    for (const auto& event : events)
+        if (event.type == type) count++;
+    return count;
+}
+}  // namespace
+
+TEST(Trace, DisabledRecordsNothing)
+{
+    Trace::disable();
+    drain_all();
+
+    trace_event(TraceEventType::User, 1, 2);
+    EXPECT_TRUE(drain_all().empty());
+}
+
+TEST(Trace, PoolWorkersRecordTasksInOrder)
+{
+    Trace::enable();
+    drain_all();
+
+    constexpr int tasks = 100;
+    {
+        // Held until start(), so that no worker is idle during the pushes and both are created.
+        ThreadPool pool(2, 2, std::chrono::seconds(60), true);
+        std::atomic_int remaining{tasks};
+        for (int i = 0; i < tasks; i++) pool.push([&remaining]() { remaining--; });
+        pool.start();
+        while (remaining.load() != 0) std::this_thread::yield();
+        pool.terminate(true);
+    }
+    Trace::disable();
+
+    auto events = drain_all();
+    EXPECT_EQ(count_of(events, TraceEventType::TaskSubmit), static_cast<std::size_t>(tasks));
+    EXPECT_EQ(count_of(events, TraceEventType::TaskBegin), static_cast<std::size_t>(tasks));
+    EXPECT_EQ(count_of(events, TraceEventType::TaskEnd), static_cast<std::size_t>(tasks));
+    EXPECT_EQ(count_of(events, TraceEventType::WorkerStart), 2u);
+    EXPECT_EQ(count_of(events, TraceEventType::WorkerExit), 2u);
+
+    // Per thread: timestamps never go back and every task ends after it began, on the same worker.
+    std::map<std::uint32_t, std::uint64_t> last_timestamp;
+    std::map<std::uint64_t, TraceEvent> begun;
+    for (const auto& event : events)
+    {
+        EXPECT_GE(event.timestamp, last_timestamp[event.thread]);
+        last_timestamp[event.thread] = event.timestamp;
+
+        if (event.type == TraceEventType::TaskBegin)
+        {
+            EXPECT_NE(event.worker_id, invalid_worker_id);
+            begun[event.task_id] = event;
+        }
+        else if (event.type == TraceEventType::TaskEnd)
+        {
+            ASSERT_EQ(begun.count(event.task_id), 1u);
+            EXPECT_EQ(begun[event.task_id].worker_id, event.worker_id);
+            EXPECT_LE(begun[event.task_id].timestamp, event.timestamp);
+        }
+    }
+}
+
+TEST(Trace, GraphTasksAreRecordedWithTheirIds)
+{
+    ThreadGraph graph(2, false);
+    std::set<std::uint64_t> ids;
+    for (int i = 0; i < 10; i++) ids.insert(graph.push([]() {}).uid());
+
+    Trace::enable();
+    drain_all();
+    graph.start();
+    graph.wait();
+    Trace::disable();
+
+    std::set<std::uint64_t> traced;
+    for (const auto& event : drain_all())
+        if (event.type == TraceEventType::TaskBegin) traced.insert(event.task_id);
+    EXPECT_EQ(traced, ids);
+}
+
+TEST(Trace, TaskEndCarriesCpuTime)
+{
+    ThreadPool pool(1, 1);
+    Trace::enable();
+    drain_all();
+    std::atomic_bool done{false};
+    pool.push(
+        [&done]()
+        {
+            auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(2);
+            while (std::chrono::steady_clock::now() < until)
+            {
+            }
+            done = true;
+        });
+    while (!done) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    pool.terminate(true);
+    Trace::disable();
+
+    std::size_t ends = 0;
+    for (const auto& event : drain_all())
+    {
+        if (event.type != TraceEventType::TaskEnd) continue;
+        ends++;
+        if (Trace::thread_cpu_time() != 0)
+        {
+            EXPECT_GT(event.arg, 100000u);
+        }
+    }
+    EXPECT_EQ(ends, 1u);
+}
+
+TEST(Trace, FullBufferDropsEvents)
+{
+    Trace::enable();
+    drain_all();
+    Trace::set_buffer_capacity(6);  // Rounded to 8.
+    std::uint64_t dropped = Trace::dropped();
+
+    std::thread([]() { for (int i = 0; i < 100; i++) trace_event(TraceEventType::User, 0, i); }).join();
+    Trace::set_buffer_capacity(Trace::default_capacity);
+    Trace::disable();
+
+    auto events = drain_all();
+    ASSERT_EQ(events.size(), 8u);
+    for (std::uint64_t i = 0; i < events.size(); i++) EXPECT_EQ(events[i].arg, i);
+    EXPECT_EQ(Trace::dropped() - dropped, 92u);
+}
+
+TEST(Trace, DrainAfterTracingThreadExits)
+{
+    Trace::enable();
+    drain_all();
+
+    // The buffer of the exited thread is released by the drain, the live one registered after it is kept.
+    std::thread([]() { trace_event(TraceEventType::User, 1, 0); }).join();
+    std::atomic_bool recorded{false};
+    std::atomic_bool release{false};
+    std::thread live(
+        [&]()
+        {
+            trace_event(TraceEventType::User, 2, 0);
+            recorded = true;
+            while (!release) std::this_thread::yield();
+        });
+    while (!recorded) std::this_thread::yield();
+
+    auto events = drain_all();
+    EXPECT_EQ(count_of(events, TraceEventType::User), 2u);
+    EXPECT_TRUE(drain_all().empty());
+
+    release = true;
+    live.join();
+    Trace::disable();
+    drain_all();
+}
+
+TEST(Trace, CollectorDeliversEvents)
+{
+    Trace::enable();
+    drain_all();
+
+    std::mutex mutex;
+    std::vector<TraceEvent> collected;
+    Trace::start_collector(
+        [&](const std::vector<TraceEvent>& events)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            collected.insert(collected.end(), events.begin(), events.end());
+        },
+        std::chrono::milliseconds(1));
+    EXPECT_THROW(Trace::start_collector([](const std::vector<TraceEvent>&) {}), std::runtime_error);
+
+    std::thread([]() { for (int i = 0; i < 50; i++) trace_event(TraceEventType::User, i); }).join();
+    Trace::stop_collector();
+    Trace::disable();
+
+    EXPECT_EQ(count_of(collected, TraceEventType::User), 50u);
+}
+
+namespace
+{
+// A pool worker (thread 1) parks, wakes and runs a task submitted by thread 0, which is stolen. The task runs
+// for 1000 ns and uses 400 ns of CPU.
+std::vector<TraceEvent> sample_events()
+{
+    return {
+        {1000, 7, 0, invalid_worker_id, 0, TraceEventType::TaskSubmit},
+        {500, 0, 0, 3, 1, TraceEventType::WorkerStart},
+        {600, 0, 0, 3, 1, TraceEventType::WorkerPark},
+        {1100, 0, 0, 3, 1, TraceEventType::WorkerWake},
+        {1200, 7, 1, 3, 1, TraceEventType::TaskSteal},
+        {1300, 7, 0, 3, 1, TraceEventType::TaskBegin},
+        {2300, 7, 400, 3, 1, TraceEventType::TaskEnd},
+        {2500, 0, 0, 3, 1, TraceEventType::WorkerExit},
+    };
+}
+
+std::size_t occurrences(const std::string& text, const std::string& pattern)
+{
+    std::size_t count = 0;
+    for (auto pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + 1)) count++;
+    return count;
+}
+
+std::uint64_t read_varint(const std::string& bytes, std::size_t& pos)
+{
+    std::uint64_t value = 0;
+    for (int shift = 0; pos < bytes.size(); shift += 7)
+    {
+        auto byte = static_cast<unsigned char>(bytes[pos++]);
+        value |= std::uint64_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) break;
+    }
+    return value;
+}
+}  // namespace
+
+TEST(TraceExport, ChromeTraceHasSlicesInstantsAndFlows)
+{
+    TraceExportOptions options;
+    options.task_name = [](std::uint64_t id) { return id == 7 ? std::string("decode \"frame\"") : std::string(); };
+
+    std::ostringstream out;
+    write_chrome_trace(out, sample_events(), options);
+    std::string json = out.str();
+
+    EXPECT_EQ(occurrences(json, "\"ph\":\"X\""), 5u);  // idle, parked, idle, task, idle
+    EXPECT_NE(json.find("\"name\":\"parked\",\"cat\":\"worker\",\"pid\":1,\"tid\":1,\"ts\":0.100,\"dur\":0.500"),
+              std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"decode \\\"frame\\\"\",\"cat\":\"task\",\"pid\":1,\"tid\":1,\"ts\":0.800,"
+                        "\"dur\":1.000,\"args\":{\"task\":7,\"cpu_us\":0.400}"),
+              std::string::npos);
+    EXPECT_NE(json.find("\"args\":{\"name\":\"worker 3\"}"), std::string::npos);
+    EXPECT_NE(json.find("\"args\":{\"name\":\"thread 0\"}"), std::string::npos);
+    EXPECT_EQ(occurrences(json, "\"name\":\"steal\""), 1u);
+    EXPECT_EQ(occurrences(json, "\"name\":\"wake\""), 1u);
+    EXPECT_EQ(occurrences(json, "\"ph\":\"s\""), 1u);
+    EXPECT_EQ(occurrences(json, "\"ph\":\"f\""), 1u);
+}
+
+TEST(TraceExport, PerfettoTraceIsASequenceOfPackets)
+{
+    std::ostringstream out;
+    write_perfetto_trace(out, sample_events());
+    std::string bytes = out.str();
+
+    // Trace { repeated TracePacket packet = 1; }: 3 track descriptors, 5 slices begin and end, 3 instants.
+    std::size_t packets = 0;
+    std::size_t pos = 0;
+    while (pos < bytes.size())
+    {
+        ASSERT_EQ(read_varint(bytes, pos), (1u << 3) | 2u);
+        pos += read_varint(bytes, pos);
+        packets++;
+    }
+    EXPECT_EQ(pos, bytes.size());
+    EXPECT_EQ(packets, 3u + 10u + 3u);
+    EXPECT_NE(bytes.find("worker 3"), std::string::npos);
+    EXPECT_NE(bytes.find("parked"), std::string::npos);
+    EXPECT_NE(bytes.find("cpu_ns"), std::string::npos);
+}
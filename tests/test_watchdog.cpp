@@ -0,0 +1,140 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "athread/athread.h"
+
+using namespace at;
+using namespace std::chrono_literals;
+
+namespace
+{
+struct Recorder
+{
+    void operator()(const Stall& stall)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stalls.push_back(stall);
+    }
+
+    std::size_t count(StallKind kind)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::size_t n = 0;
+        for (const auto& stall : stalls) n += stall.kind == kind ? 1 : 0;
+        return n;
+    }
+
+    std::mutex mutex;
+    std::vector<Stall> stalls;
+};
+}  // namespace
+
+TEST(Watchdog, ReportsLongPoolTaskOnce)
+{
+    Recorder recorder;
+    Watchdog watchdog([&recorder](const Stall& stall) { recorder(stall); }, 20ms);
+    ThreadPool pool(1, 1);
+    watchdog.add("io", pool);
+
+    std::atomic_bool release{false};
+    std::atomic_bool running{false};
+    pool.push(
+        [&]()
+        {
+            running = true;
+            while (!release) std::this_thread::sleep_for(1ms);
+        });
+    while (!running) std::this_thread::sleep_for(1ms);
+
+    EXPECT_EQ(watchdog.check(), 0u);
+    std::this_thread::sleep_for(30ms);
+    EXPECT_EQ(watchdog.check(), 1u);
+    EXPECT_EQ(watchdog.check(), 0u);  // Already reported.
+    ASSERT_EQ(recorder.stalls.size(), 1u);
+    EXPECT_EQ(recorder.stalls[0].kind, StallKind::LongTask);
+    EXPECT_EQ(recorder.stalls[0].name, "io");
+    EXPECT_EQ(recorder.stalls[0].worker_id, 0u);
+    EXPECT_GE(recorder.stalls[0].duration, 20ms);
+
+    release = true;
+    while (pool.metrics().completed < 1) std::this_thread::sleep_for(1ms);
+    EXPECT_EQ(watchdog.check(), 0u);
+}
+
+TEST(Watchdog, ReportsStuckGraph)
+{
+    Recorder recorder;
+    Watchdog watchdog([&recorder](const Stall& stall) { recorder(stall); }, 0ns, 20ms);
+    ThreadGraph graph(2, false);
+    watchdog.add("build", graph);
+    EXPECT_EQ(watchdog.check(), 0u);
+
+    std::atomic_bool release{false};
+    auto a = graph.push([]() {});
+    graph.push(
+             [&release]()
+             {
+                 while (!release) std::this_thread::sleep_for(1ms);
+             })
+        .depend(a);
+    graph.start();
+    watchdog.start(2ms);
+
+    auto deadline = std::chrono::steady_clock::now() + 2s;
+    while (recorder.count(StallKind::NoProgress) == 0 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(1ms);
+    EXPECT_EQ(recorder.count(StallKind::NoProgress), 1u);
+    EXPECT_EQ(recorder.count(StallKind::LongTask), 0u);  // Disabled.
+
+    release = true;
+    graph.wait();
+    watchdog.stop();
+    EXPECT_EQ(watchdog.check(), 0u);  // Idle graphs never stall.
+
+    watchdog.remove("build");
+    EXPECT_THROW(Watchdog(Watchdog::Handler(), 1s), std::invalid_argument);
+}
+
+TEST(Watchdog, ThrowingNodeReleasesItsWorker)
+{
+    Recorder recorder;
+    Watchdog watchdog([&recorder](const Stall& stall) { recorder(stall); }, 5ms, 5ms);
+    ThreadGraph graph(1, false);
+    watchdog.add("build", graph);
+
+    graph.push([]() { throw std::runtime_error("boom"); });
+    graph.start();
+    EXPECT_THROW(graph.wait(), std::runtime_error);
+
+    std::this_thread::sleep_for(10ms);
+    EXPECT_EQ(watchdog.check(), 0u);  // Neither a long task nor a lack of progress.
+    EXPECT_TRUE(recorder.stalls.empty());
+}
+
+TEST(ActivityBoard, TracksWorkersBeyondTheFirstChunk)
+{
+    ActivityBoard board;
+    board.task_began(200, 7);
+    board.task_began(ActivityBoard::max_workers, 8);
+
+    std::vector<ActivityBoard::Activity> busy;
+    board.busy(busy);
+    ASSERT_EQ(busy.size(), 1u);
+    EXPECT_EQ(busy[0].worker_id, 200u);
+    EXPECT_EQ(busy[0].task_id, 7u);
+    EXPECT_EQ(board.untracked(), 1u);  // No slot, but still counted.
+
+    board.task_ended(200);
+    board.task_ended(ActivityBoard::max_workers);
+    busy.clear();
+    board.busy(busy);
+    EXPECT_TRUE(busy.empty());
+    EXPECT_EQ(board.untracked(), 0u);
+    EXPECT_NE(board.last_progress(), 0u);
+}
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include "athread/athread.h"
+
+using namespace at;
+
+TEST(WorkerLocal, GraphReduction)
+{
+    ThreadGraph graph(4, false);
+    WorkerLocal<long> sum(0);
+
+    for (int i = 1; i <= 100; i++) graph.push([i, &sum]() { sum.local() += i; });
+
+    graph.start();
+    graph.wait();
+
+    EXPECT_EQ(sum.combine(std::plus<long>()), 5050);
+    EXPECT_GE(sum.size(), 1u);
+    EXPECT_LE(sum.size(), 4u);
+}
+
+TEST(WorkerLocal, PoolReductionWithScratchBuffers)
+{
+    ThreadPool pool(3, 3);
+    WorkerLocal<std::vector<int>> seen;
+
+    parallel_for(pool, 0, 1000, [&seen](int i) { seen.local().push_back(i); }, 10);
+
+    std::vector<int> all;
+    seen.for_each([&all](std::vector<int>& part) { all.insert(all.end(), part.begin(), part.end()); });
+    std::sort(all.begin(), all.end());
+
+    ASSERT_EQ(all.size(), 1000u);
+    for (int i = 0; i < 1000; i++) EXPECT_EQ(all[i], i);
+}
+
+TEST(WorkerLocal, EmptyCombineReturnsInitial)
+{
+    WorkerLocal<int> value(7);
+    EXPECT_EQ(value.combine(std::plus<int>()), 7);
+    EXPECT_EQ(value.size(), 0u);
+}
+
+TEST(WorkerLocal, LocalOutsideWorkerThrows)
+{
+    WorkerLocal<int> value;
+    EXPECT_EQ(IWorker::current_id(), invalid_worker_id);
+    EXPECT_THROW(value.local(), std::runtime_error);
+}
+
+TEST(WorkerLocal, SlotsBeyondFirstChunk)
+{
+    WorkerLocal<int> value(0);
+    value.at(3) = 1;
+    value.at(200) = 2;
+    EXPECT_EQ(value.size(), 2u);
+    EXPECT_EQ(value.combine(std::plus<int>()), 3);
+
+    value.clear();
+    EXPECT_EQ(value.size(), 0u);
+    EXPECT_EQ(value.at(200), 0);
+}
+
+TEST(WorkerLocal, PoolWorkerIdsAreDense)
+{
+    ThreadPool pool(2, 4);
+    std::mutex mutex;
+    std::set<std::uint32_t> ids;
+
+    parallel_for(pool, 0, 200,
+                 [&](int)
+                 {
+                     std::lock_guard<std::mutex> lk(mutex);
+                     ids.insert(IWorker::current_id());
+                 });
+
+    ASSERT_FALSE(ids.empty());
+    EXPECT_LT(*ids.rbegin(), 4u);
+}
@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include "athread/athread.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace at;
+
+TEST(WorkerOptions, RejectsOutOfRangeValues)
+{
+    WorkerOptions tiny_stack;
+    tiny_stack.stack_size = 16;
+    EXPECT_THROW(ThreadPool(1, 1, std::chrono::seconds(1), false, tiny_stack), std::invalid_argument);
+
+    WorkerOptions bad_nice;
+    bad_nice.nice = 40;
+    EXPECT_THROW(ThreadGraph(1, true, bad_nice), std::invalid_argument);
+
+    WorkerOptions bad_priority;
+    bad_priority.sched_policy = SchedPolicy::Fifo;
+    bad_priority.priority = 1000;
+    EXPECT_THROW(ThreadPoolFixed(1, bad_priority), std::invalid_argument);
+}
+
+#ifdef __linux__
+TEST(WorkerOptions, PoolThreadsHaveNameAndStackSize)
+{
+    WorkerOptions options;
+    options.stack_size = 256 * 1024;
+    options.name_prefix = "pool-";
+
+    ThreadPool pool(2, 2, std::chrono::seconds(60), false, options);
+
+    std::mutex mutex;
+    std::set<std::string> names;
+    std::atomic<std::size_t> stack_size{0};
+    parallel_for(pool, 0, 32,
+                 [&](int)
+                 {
+                     char name[16] = {};
+                     pthread_getname_np(pthread_self(), name, sizeof(name));
+
+                     pthread_attr_t attr;
+                     std::size_t size = 0;
+                     pthread_getattr_np(pthread_self(), &attr);
+                     pthread_attr_getstacksize(&attr, &size);
+                     pthread_attr_destroy(&attr);
+                     stack_size = size;
+
+                     std::lock_guard<std::mutex> lock(mutex);
+                     names.insert(name);
+                 });
+
+    for (const auto& name : names) EXPECT_TRUE(name == "pool-0" || name == "pool-1") << name;
+    EXPECT_GE(stack_size.load(), options.stack_size);
+    EXPECT_LT(stack_size.load(), 1024u * 1024u);
+}
+
+TEST(WorkerOptions, GraphThreadsUseSchedulingPolicyAndNice)
+{
+    WorkerOptions options;
+    options.name_prefix = "a-very-long-graph-prefix-";
+    options.sched_policy = SchedPolicy::Batch;
+    options.nice = 5;
+
+    ThreadGraph graph(2, false, options);
+
+    std::atomic_int policy{-1};
+    std::atomic_int nice{0};
+    std::string name(16, '\0');
+    graph.push(
+        [&]()
+        {
+            policy = sched_getscheduler(0);
+            nice = getpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)));
+            pthread_getname_np(pthread_self(), &name[0], name.size());
+        });
+
+    graph.start();
+    graph.wait();
+
+    EXPECT_EQ(policy.load(), SCHED_BATCH);
+    EXPECT_EQ(nice.load(), 5);
+    EXPECT_EQ(std::string(name.c_str()), "a-very-long-gra");
+}
+#endif